@@ -12,13 +12,35 @@
 
 AnimItem::AnimItem() : QGraphicsRectItem(),
 	currentParamWidget( NULL ),
-	currentFilterWidget( NULL )
+	currentFilterWidget( NULL ),
+	waveform( NULL ),
+	waveformResolved( false )
 {
 	setRect( 0, 0, 10, 10 );
 	setPen( QPen( QColor("silver") ) );
 	setBrush( QBrush( QColor(255,255,200) ) );
 	
 	reset();
+	
+	connect( WaveformCollection::getGlobalInstance(), SIGNAL(waveformReady(QString)), this, SLOT(waveformReady(QString)) );
+}
+
+
+
+AnimItem::~AnimItem()
+{
+	if ( waveform )
+		WaveformCollection::getGlobalInstance()->releaseWaveform( waveform );
+}
+
+
+
+void AnimItem::waveformReady( QString fileName )
+{
+	if ( fileName == waveformSource ) {
+		waveformResolved = false;
+		update();
+	}
 }
 
 
@@ -339,6 +361,8 @@ void AnimItem::paint( QPainter *painter, const QStyleOptionGraphicsItem *option,
 	
 	if ( !currentParam )
 		return;
+	
+	drawWaveform( painter );
 
 	int i, j, w = rect().width(), h = rect().height();
 	QPen pen;
@@ -383,3 +407,56 @@ void AnimItem::paint( QPainter *painter, const QStyleOptionGraphicsItem *option,
 		}
 	}
 }
+
+
+
+void AnimItem::drawWaveform( QPainter *painter )
+{
+	Clip *clip = currentFilterWidget ? currentFilterWidget->getClip() : NULL;
+	if ( !clip || !clip->getProfile().hasAudio() )
+		return;
+	
+	if ( clip->sourcePath() != waveformSource ) {
+		if ( waveform )
+			WaveformCollection::getGlobalInstance()->releaseWaveform( waveform );
+		waveform = NULL;
+		waveformSource = clip->sourcePath();
+		waveformResolved = false;
+	}
+	// not on every paint, getWaveform looks for the cache file
+	if ( !waveformResolved ) {
+		int status, progress;
+		waveformResolved = true;
+		if ( !waveform )
+			waveform = WaveformCollection::getGlobalInstance()->getWaveform( clip->getSource(), status, progress );
+	}
+	if ( !waveform )
+		return;
+	
+	QSharedPointer<Filter> f = currentFilterWidget->getFilter();
+	int w = rect().width(), h = rect().height();
+	if ( w < 1 || f->getLength() <= 0 )
+		return;
+	
+	// source duration covered by one pixel
+	double speed = qAbs( clip->getSpeed() );
+	double d = f->getLength() * speed / w;
+	double offset = (f->getPosition() + f->getPositionOffset() - clip->position()) * speed;
+	double end = clip->start() + (clip->length() * speed);
+	double half = h / 2.0;
+	
+	QVector<QLineF> peaks;
+	WaveformPeak p;
+	for ( int x = 0; x < w; ++x ) {
+		double pts = offset + x * d;
+		if ( clip->getSpeed() < 0 )
+			pts = end - pts - d;
+		else
+			pts += clip->start();
+		if ( waveform->getPeak( pts, d, p ) )
+			peaks.append( QLineF( x, half - p.max * half / 32767.0 + BORDER, x, half - p.min * half / 32767.0 + BORDER ) );
+	}
+	
+	painter->setPen( QColor(200,200,160) );
+	painter->drawLines( peaks );
+}
@@ -3,6 +3,7 @@
 
 #include "engine/parameter.h"
 #include "engine/clip.h"
+#include "engine/waveformcollection.h"
 #include "gui/filter/filterwidget.h"
 #include "keyitem.h"
 
@@ -13,6 +14,7 @@ class AnimItem : public QObject, public QGraphicsRectItem
 	Q_OBJECT
 public:
 	AnimItem();
+	~AnimItem();
 	
 	void itemSelected( KeyItem *it );
 	void itemMove( KeyItem *it, QPointF mouse, QPointF startPos, QPointF startMouse );
@@ -34,15 +36,21 @@ private:
 	void reset();
 	void sendValue( double val );
 	void propagateConstant( int index );
+	void drawWaveform( QPainter *painter );
 	
 	Parameter *currentParam;
 	ParameterWidget *currentParamWidget;
 	FilterWidget *currentFilterWidget;
 	QList<KeyItem*> keys;
 	int currentKeyIndex;
+	Waveform *waveform;
+	// the waveform of this source was asked, it is asked again when built
+	QString waveformSource;
+	bool waveformResolved;
 	
 private slots:
 	void keyValueChanged( Parameter *p, QVariant val );
+	void waveformReady( QString fileName );
 	
 signals:
 	void ovdValueChanged(ParameterWidget *exclude);
@@ -17,6 +17,7 @@ public:
 	FilterWidget( QWidget *parent, Clip *c, QSharedPointer<Filter> f );
 	~FilterWidget();
 	QSharedPointer<Filter> getFilter() { return filter; }
+	Clip* getClip() { return clip; }
 	void setAnimActive( Parameter *p );
 	
 private slots:
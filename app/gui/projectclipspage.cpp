@@ -8,7 +8,9 @@
 
 #include "input/input_ff.h"
 #include "input/input_image.h"
+#include "input/mediaio.h"
 #include "engine/thumbnailer.h"
+#include "engine/proxycollection.h"
 #include "gui/projectclipspage.h"
 #include "gui/profiledialog.h"
 #include "gui/filtersdialog.h"
@@ -28,6 +30,11 @@ ProjectSourcesPage::ProjectSourcesPage( Sampler *samp )
 
 	connect( openClipToolButton, SIGNAL(clicked()), this, SIGNAL(openSourcesBtnClicked()) );
 	connect( openBlankToolButton, SIGNAL(clicked()), this, SIGNAL(openBlankBtnClicked()) );
+
+	connect( &proxyTimer, SIGNAL(timeout()), this, SLOT(updateProxyStatus()) );
+	connect( ProxyCollection::getGlobalInstance(), SIGNAL(proxyReady(QString)), this, SLOT(updateProxyStatus()) );
+	connect( &ioTimer, SIGNAL(timeout()), this, SLOT(updateProxyStatus()) );
+	ioTimer.start( 5000 );
 }
 
 
@@ -107,6 +114,11 @@ void ProjectSourcesPage::sourceItemMenu( const QPoint &pos )
 	QMenu menu;
 	menu.addAction( tr("Source properties"), this, SLOT(showSourceProperties()) );
 	menu.addAction( tr("Filters..."), this, SLOT(showSourceFilters()) );
+	if ( item->getSource()->getType() == InputBase::FFMPEG && item->getProfile().hasVideo() ) {
+		QAction *proxy = menu.addAction( tr("Use proxy"), this, SLOT(toggleProxy()) );
+		proxy->setCheckable( true );
+		proxy->setChecked( item->getSource()->getUseProxy() );
+	}
 	menu.exec( QCursor::pos() );
 }
 
@@ -138,8 +150,78 @@ void ProjectSourcesPage::showSourceFilters()
 
 
 
+void ProjectSourcesPage::toggleProxy()
+{
+	SourceListItem *item = (SourceListItem*)sourceListWidget->currentItem();
+	if ( !item )
+		return;
+
+	Source *source = item->getSource();
+	source->setUseProxy( !source->getUseProxy() );
+	if ( source->getUseProxy() )
+		ProxyCollection::getGlobalInstance()->requestProxy( source );
+	updateProxyStatus();
+}
+
+
+
+void ProjectSourcesPage::updateProxyStatus()
+{
+	bool pending = false;
+
+	for ( int i = 0; i < sourceListWidget->count(); ++i ) {
+		SourceListItem *it = (SourceListItem*)sourceListWidget->item( i );
+		QString status;
+		if ( it->getSource()->getUseProxy() ) {
+			int progress = 0;
+			switch ( ProxyCollection::getGlobalInstance()->getStatus( it->getFileName(), progress ) ) {
+				case ProxyCollection::PROXYENQUEUED:
+					status = tr("proxy: enqueued...");
+					pending = true;
+					break;
+				case ProxyCollection::PROXYINPROGRESS:
+					status = QString(tr("proxy: %1%")).arg( progress );
+					pending = true;
+					break;
+				case ProxyCollection::PROXYREADY:
+					status = tr("proxy");
+					break;
+				case ProxyCollection::PROXYERROR:
+					status = tr("proxy: an error occured.");
+					break;
+			}
+		}
+		QString io = ioStatus( it->getFileName() );
+		if ( !io.isEmpty() )
+			status = status.isEmpty() ? io : status + "\n" + io;
+		it->setStatus( status );
+	}
+
+	if ( pending && !proxyTimer.isActive() )
+		proxyTimer.start( 2000 );
+	else if ( !pending )
+		proxyTimer.stop();
+}
+
+
+
+// shown once the inputs of the source had to wait for the disk
+QString ProjectSourcesPage::ioStatus( QString fileName )
+{
+	MediaIOStats s = MediaIOPool::getGlobalInstance()->getStats( fileName );
+	if ( s.stallTime <= 0 )
+		return "";
+	return QString(tr("disk: %1 MB read, %2 ms waited")).arg( s.bytesRead / (1024 * 1024) ).arg( s.stallTime / 1000 );
+}
+
+
+
 void ProjectSourcesPage::addSource( QPixmap pix, Source *src )
 {
 	SourceListItem *it = new SourceListItem( pix, src );
 	sourceListWidget->addItem( it );
+	if ( src->getUseProxy() ) {
+		ProxyCollection::getGlobalInstance()->requestProxy( src );
+		updateProxyStatus();
+	}
 }
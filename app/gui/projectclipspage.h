@@ -6,6 +6,7 @@
 #include <QFileInfo>
 #include <QTime>
 #include <QMimeData>
+#include <QTimer>
 
 #include "ui_projectclipspage.h"
 
@@ -31,13 +32,15 @@ public:
 		secs %= 60;
 		hours = mins / 60;
 		mins %= 60;
-		setText( QFileInfo( source->getFileName() ).fileName() + "\n" + QTime( hours, mins, secs ).toString("hh:mm:ss") );
+		baseText = QFileInfo( source->getFileName() ).fileName() + "\n" + QTime( hours, mins, secs ).toString("hh:mm:ss");
+		setText( baseText );
 		setIcon( pix );
 		currentPts = inPoint = 0;
 		outPoint = inPoint + ( p.getStreamDuration() / 2 );
 	}
 
 	const QString & getFileName() { return source->getFileName(); }
+	void setStatus( QString s ) { setText( s.isEmpty() ? baseText : baseText + "\n" + s ); }
 	const Profile & getProfile() { return source->getProfile(); }
 	void setInPoint( QImage img, double d ) { inPoint = d; inThumb = img; }
 	void setOutPoint( QImage img, double d ) { outPoint = d; outThumb = img; }
@@ -51,6 +54,7 @@ public:
 	
 private:
 	Source *source;
+	QString baseText;
 	double inPoint, outPoint;
 	double currentPts;
 	QImage inThumb, outThumb;
@@ -82,6 +86,8 @@ private slots:
 	void sourceItemActivated( QListWidgetItem *item, QListWidgetItem *prev );
 	void showSourceProperties();
 	void showSourceFilters();
+	void toggleProxy();
+	void updateProxyStatus();
 
 signals:
 	void sourceActivated();
@@ -91,5 +97,10 @@ signals:
 private:
 	Sampler *sampler;
 	SourceListItem *activeSource;
+	QTimer proxyTimer;
+	// refreshes the disk read statistics
+	QTimer ioTimer;
+
+	QString ioStatus( QString fileName );
 };
 #endif // PROJECTCLIPSPAGE_H
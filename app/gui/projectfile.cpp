@@ -1,4 +1,5 @@
 #include "projectfile.h"
+#include "engine/proxycollection.h"
 
 
 
@@ -239,6 +240,10 @@ void ProjectFile::readSource( QDomElement &element )
 	else {
 		source = new Source( (InputBase::InputType)type, name, prof );
 	}
+	if ( element.hasAttribute( "proxy" ) )
+		source->setUseProxy( element.attribute( "proxy" ).toInt() > 0 );
+	else
+		source->setUseProxy( ProxyCollection::needsProxy( source ) );
 	sourcesList.append( source );
 
 	for ( int i = 0; i < nodes.count(); ++i ) {
@@ -365,6 +370,7 @@ void ProjectFile::writeSource( QDomNode &parent, Source *source )
 	
 	Profile prof = source->getProfile();
 	n1.setAttribute( "type", QString::number( source->getType() ) );
+	n1.setAttribute( "proxy", QString::number( source->getUseProxy() ) );
 	n1.setAttribute( "duration", QString::number( prof.getStreamDuration(), 'e', 17 ) );
 	n1.setAttribute( "startTime", QString::number( prof.getStreamStartTime(), 'e', 17 ) );
 	if ( prof.hasVideo() ) {
@@ -1,8 +1,10 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QShortcut>
+#include <QDockWidget>
 
 #include "engine/util.h"
+#include "engine/proxycollection.h"
 #include "gui/topwindow.h"
 #include "renderingdialog.h"
 #include "projectprofiledialog.h"
@@ -105,6 +107,7 @@ TopWindow::TopWindow()
 	connect( vw, SIGNAL(wheelSeek(int)), sampler, SLOT(wheelSeek(int)) );
 	connect( vw, SIGNAL(newSharedContext(QGLWidget*)), sampler, SLOT(setSharedContext(QGLWidget*)) );
 	connect( vw, SIGNAL(newFencesContext(QGLWidget*)), sampler, SLOT(setFencesContext(QGLWidget*)) );
+	connect( vw, SIGNAL(sizeChanged(QSize)), sampler, SLOT(setPreviewSize(QSize)) );
 	connect( vw, SIGNAL(newThumbContext(QGLWidget*)), this, SLOT(setThumbContext(QGLWidget*)) );
 	connect( sampler->getMetronom(), SIGNAL(newFrame(Frame*)), vw, SLOT(showFrame(Frame*)) );
 	connect( sampler->getMetronom(), SIGNAL(currentFramePts(double)), this, SLOT(currentFramePts(double)) );
@@ -117,6 +120,17 @@ TopWindow::TopWindow()
 	connect( sampler->getMetronom(), SIGNAL(osdTimer(bool)), vw, SLOT(showOSDTimer(bool)) );
 	connect( this, SIGNAL(startOSDTimer(bool)), vw, SLOT(showOSDTimer(bool)) );
 
+	QDockWidget *scopesDock = new QDockWidget( tr("Video scopes"), this );
+	scopesDock->setObjectName( "scopesDock" );
+	ScopesWidget *scopes = new ScopesWidget();
+	scopesDock->setWidget( scopes );
+	addDockWidget( Qt::RightDockWidgetArea, scopesDock );
+	scopesDock->hide();
+	menuPlayer->addAction( scopesDock->toggleViewAction() );
+	connect( scopesDock, SIGNAL(visibilityChanged(bool)), vw, SLOT(showScopes(bool)) );
+	connect( scopes, SIGNAL(modeSelected(int)), vw, SLOT(setScopesMode(int)) );
+	connect( vw->getScopes(), SIGNAL(newResult(const ScopesResult&)), scopes, SLOT(setResult(const ScopesResult&)) );
+
 	connect( clipsToolButton, SIGNAL(clicked()), this, SLOT(showProjectClipsPage()) );
 	connect( fxToolButton, SIGNAL(clicked()), this, SLOT(showFxPage()) );
 	connect( fxSettingsToolButton, SIGNAL(clicked()), this, SLOT(showFxSettingsPage()) );
@@ -193,6 +207,10 @@ TopWindow::TopWindow()
 	openSourcesCurrentDir = appConfig.value("openSourcesCurrentDir").toString();
 	openProjectCurrentDir = appConfig.value("openProjectCurrentDir").toString();
 	appConfig.endGroup();
+	appConfig.beginGroup("Video");
+	GLDeinterlace::setEnabled( appConfig.value("gpuDeinterlace", true).toBool() );
+	Composer::setPlaybackQuality( appConfig.value("draftPlayback", false).toBool() ? GLFilter::DRAFTQUALITY : GLFilter::FULLQUALITY );
+	appConfig.endGroup();
 	
 	QDir dir = QDir::home();
 	dir.cd(MACHINTRUC_DIR);
@@ -452,9 +470,10 @@ void TopWindow::renderDialog()
 void TopWindow::renderStart( double startPts, QSize out )
 {
 	sampler->setOutputResize(out);
+	// inputs opened by the seek must not use proxies
+	sampler->setRenderMode( true );
 	timelineSeek( startPts );
 	vw->clear();
-	sampler->getMetronom()->setRenderMode( true );
 	playPause( true );
 	emit timelineReadyForEncode();
 }
@@ -462,7 +481,7 @@ void TopWindow::renderStart( double startPts, QSize out )
 void TopWindow::renderFinished( double pts )
 {
 	timelineSeek( pts );
-	sampler->getMetronom()->setRenderMode( false );
+	sampler->setRenderMode( false );
 	sampler->setOutputResize(QSize(0, 0));
 	timelineSeek( pts );
 }
@@ -955,6 +974,7 @@ void TopWindow::thumbResultReady( ThumbRequest result )
 	else {
 		if ( !result.thumb.isNull() ) {
 			Source *source = new Source( (InputBase::InputType)result.inputType, result.filePath, result.profile );
+			source->setUseProxy( ProxyCollection::needsProxy( source ) );
 			sourcePage->addSource( QPixmap::fromImage( result.thumb ), source );
 		}
 		else
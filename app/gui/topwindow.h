@@ -17,6 +17,7 @@
 #include "engine/thumbnailer.h"
 #include "engine/composer.h"
 #include "videoout/videowidget.h"
+#include "videoout/scopeswidget.h"
 #include "timeline/timeline.h"
 #include "animation/animeditor.h"
 #include "projectfile.h"
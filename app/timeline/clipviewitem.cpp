@@ -19,6 +19,7 @@ ClipViewItem::ClipViewItem( Clip *c, double scale ) : AbstractViewItem(),
 	moveResize( 0 ),
 	firstMove( true ),
 	multiMove( false ),
+	waveform( NULL ),
 	transition( NULL )
 {
 	setData( DATAITEMTYPE, TYPECLIP );
@@ -79,6 +80,8 @@ ClipViewItem::ClipViewItem( Clip *c, double scale ) : AbstractViewItem(),
 
 ClipViewItem::~ClipViewItem()
 {
+	if ( waveform )
+		WaveformCollection::getGlobalInstance()->releaseWaveform( waveform );
 	/*if ( transition ) {
 		delete transition;
 	}*/
@@ -177,6 +180,10 @@ void ClipViewItem::paint( QPainter *painter, const QStyleOptionGraphicsItem *opt
 			painter->drawImage( ir, startThumb );
 	}
 	
+	// draw waveform
+	if ( clip->getProfile().hasAudio() && w > 1 )
+		drawWaveform( painter, inside, option->exposedRect );
+	
 	// draw title
 	painter->setPen( QColor(0,0,0,0) );
 	if (selected == 2) {
@@ -197,6 +204,52 @@ void ClipViewItem::paint( QPainter *painter, const QStyleOptionGraphicsItem *opt
 
 
 
+void ClipViewItem::drawWaveform( QPainter *painter, const QRectF &inside, const QRectF &exposed )
+{
+	if ( waveform && waveform->getSourceName() != clip->sourcePath() ) {
+		WaveformCollection::getGlobalInstance()->releaseWaveform( waveform );
+		waveform = NULL;
+	}
+	if ( !waveform ) {
+		int status, progress;
+		// Timeline repaints when the background job is done
+		waveform = WaveformCollection::getGlobalInstance()->getWaveform( clip->getSource(), status, progress );
+		if ( !waveform )
+			return;
+	}
+
+	// source duration covered by one pixel
+	double speed = qAbs( clip->getSpeed() );
+	double d = scaleFactor * speed;
+	double end = clip->start() + (clip->length() * speed);
+	qreal half = inside.height() / 2.0;
+	qreal mid = inside.y() + half;
+	int x0 = qMax( inside.left(), exposed.left() );
+	int x1 = qMin( inside.right(), exposed.right() );
+	
+	QVector<QLineF> peaks, rms;
+	WaveformPeak p;
+	for ( int x = x0; x <= x1; ++x ) {
+		double pts = (x - inside.x()) * d;
+		if ( clip->getSpeed() < 0 )
+			pts = end - pts - d;
+		else
+			pts += clip->start();
+		if ( !waveform->getPeak( pts, d, p ) )
+			continue;
+		peaks.append( QLineF( x, mid - p.max * half / 32767.0, x, mid - p.min * half / 32767.0 ) );
+		qreal r = p.rms * half / 32767.0;
+		rms.append( QLineF( x, mid - r, x, mid + r ) );
+	}
+	
+	painter->setPen( QColor(255,255,255,90) );
+	painter->drawLines( peaks );
+	painter->setPen( QColor(255,255,255,160) );
+	painter->drawLines( rms );
+}
+
+
+
 void ClipViewItem::setSelected( int i )
 {
 	selected = i;
@@ -5,6 +5,7 @@
 
 #include "engine/clip.h"
 #include "engine/thumbnailer.h"
+#include "engine/waveformcollection.h"
 #include "transitionviewitem.h"
 
 
@@ -35,7 +36,9 @@ protected:
 	void dragEnterEvent( QGraphicsSceneDragDropEvent *event );
 	void dropEvent( QGraphicsSceneDragDropEvent *event );
 
-private:	
+private:
+	void drawWaveform( QPainter *painter, const QRectF &inside, const QRectF &exposed );
+
 	QString filename;
 	QPen normalPen, selectionPen, currentPen;
 	QBrush normalBrush, selectionBrush, currentBrush;
@@ -50,6 +53,7 @@ private:
 	bool multiMove;
 	
 	QImage startThumb, endThumb;
+	Waveform *waveform;
 	
 	TransitionViewItem *transition;
 	
@@ -61,6 +61,8 @@ Timeline::Timeline( TopWindow *parent ) : QGraphicsScene(),
 	zoomAnim->setEasingCurve( QEasingCurve::InOutSine );
 	
 	mouseScenePosition = QPointF( -1, -1 );
+	
+	connect( WaveformCollection::getGlobalInstance(), SIGNAL(waveformReady(QString)), this, SLOT(waveformReady(QString)) );
 }
 
 
@@ -1596,6 +1598,20 @@ void Timeline::thumbResultReady( ThumbRequest result )
 
 
 
+void Timeline::waveformReady( QString fileName )
+{
+	for ( int i = 0; i < tracks.count(); ++i ) {
+		QList<QGraphicsItem*> list = tracks[i]->childItems();
+		for ( int j = 0; j < list.count(); ++j ) {
+			QGraphicsItem *it = list.at( j );
+			if ( it->data( DATAITEMTYPE ).toInt() == TYPECLIP && ((ClipViewItem*)it)->getClip()->sourcePath() == fileName )
+				it->update();
+		}
+	}
+}
+
+
+
 void Timeline::updateStabilize(Clip *clip, Filter *f, bool stop)
 {
 	if (stop) {
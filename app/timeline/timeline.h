@@ -141,6 +141,7 @@ protected:
 	
 private slots:
 	void slotUpdateAfterEdit();
+	void waveformReady( QString fileName );
 	
 private:
 	void updateAfterEdit(bool doFrame, bool doLength);
@@ -18,24 +18,32 @@ SOURCES = \
 	engine/filter.cpp \
 	engine/filtercollection.cpp \
 	engine/stabilizecollection.cpp \
+	engine/waveformcollection.cpp \
+	engine/proxycollection.cpp \
 	engine/profile.cpp \
 	engine/frame.cpp \
 	engine/source.cpp \
 	engine/cut.cpp \
 	engine/clip.cpp \
 	engine/sampler.cpp \
+	engine/audiomixdown.cpp \
 	engine/scene.cpp \
 	engine/composer.cpp \
 	engine/track.cpp \
 	engine/metronom.cpp \
+	engine/playbackcontroller.cpp \
 	engine/glresource.cpp \
 	engine/movitchain.cpp \
 	engine/transition.cpp \
 	engine/thumbnailer.cpp \
 	engine/playbackbuffer.cpp \
+	engine/composedframecache.cpp \
+	engine/shadercache.cpp \
 	\
+	input/mediaio.cpp \
 	input/ffdecoder.cpp \
 	input/input_ff.cpp \
+	input/framecache.cpp \
 	input/input_image.cpp \
 	input/input_blank.cpp \
 	\
@@ -52,6 +60,8 @@ SOURCES = \
 	vfx/glfrostedglass.cpp \
 	vfx/glhardcut.cpp \
 	vfx/gloverlay.cpp \
+	vfx/glcompositor.cpp \
+	vfx/glgeometry.cpp \
 	vfx/glsaturation.cpp \
 	vfx/glvignette.cpp \
 	vfx/glblur.cpp \
@@ -60,6 +70,7 @@ SOURCES = \
 	vfx/glwater.cpp \
 	vfx/glliftgammagain.cpp \
 	vfx/glresize.cpp \
+	vfx/glpreviewscale.cpp \
 	vfx/glpadding.cpp \
 	vfx/glcrop.cpp \
 	vfx/glblurmask.cpp \
@@ -75,11 +86,13 @@ SOURCES = \
 	vfx/glborder.cpp \
 	vfx/glbackgroundcolor.cpp \
 	vfx/glorientation.cpp \
+	vfx/gldeinterlace.cpp \
 	vfx/glwhitebalance.cpp \
 	vfx/gldefish.cpp \
 	vfx/glfiber.cpp \
 	vfx/glnoise.cpp \
 	vfx/gltext.cpp \
+	vfx/gltextatlas.cpp \
 	vfx/glcustom.cpp \
 	vfx/gldenoise.cpp \
 	vfx/glstabilize.cpp \
@@ -91,13 +104,17 @@ SOURCES = \
 	vfx/gldistort.cpp \
 	vfx/glhanddrawing.cpp \
 	\
-	videoout/videowidget.cpp
+	videoout/videowidget.cpp \
+	videoout/videoscopes.cpp \
+	videoout/scopeswidget.cpp
 
 HEADERS = \
 	engine/bufferpool.h \
 	engine/filter.h \
 	engine/filtercollection.h \
 	engine/stabilizecollection.h \
+	engine/waveformcollection.h \
+	engine/proxycollection.h \
 	engine/profile.h \
 	engine/frame.h \
 	engine/source.h \
@@ -105,18 +122,24 @@ HEADERS = \
 	engine/clip.h \
 	engine/scene.h \
 	engine/sampler.h \
+	engine/audiomixdown.h \
 	engine/composer.h \
 	engine/track.h \
 	engine/metronom.h \
+	engine/playbackcontroller.h \
 	engine/glresource.h \
 	engine/movitchain.h \
 	engine/transition.h \
 	engine/thumbnailer.h \
 	engine/playbackbuffer.h \
+	engine/composedframecache.h \
+	engine/shadercache.h \
 	\
 	input/input.h \
+	input/mediaio.h \
 	input/ffdecoder.h \
 	input/input_ff.h \
+	input/framecache.h \
 	input/input_image.h \
 	input/input_blank.h \
 	\
@@ -141,6 +164,8 @@ HEADERS = \
 	vfx/glfrostedglass.h \
 	vfx/glhardcut.h \
 	vfx/gloverlay.h \
+	vfx/glcompositor.h \
+	vfx/glgeometry.h \
 	vfx/glsaturation.h \
 	vfx/glvignette.h \
 	vfx/glblur.h \
@@ -149,6 +174,7 @@ HEADERS = \
 	vfx/glwater.h \
 	vfx/glliftgammagain.h \
 	vfx/glresize.h \
+	vfx/glpreviewscale.h \
 	vfx/glpadding.h \
 	vfx/glcrop.h \
 	vfx/glblurmask.h \
@@ -164,11 +190,13 @@ HEADERS = \
 	vfx/glborder.h \
 	vfx/glbackgroundcolor.h \
 	vfx/glorientation.h \
+	vfx/gldeinterlace.h \
 	vfx/glwhitebalance.h \
 	vfx/gldefish.h \
 	vfx/glfiber.h \
 	vfx/glnoise.h \
 	vfx/gltext.h \
+	vfx/gltextatlas.h \
 	vfx/glcustom.h \
 	vfx/gldenoise.h \
 	vfx/glstabilize.h \
@@ -180,7 +208,9 @@ HEADERS = \
 	vfx/gldistort.h \
 	vfx/glhanddrawing.h \
 	\
-	videoout/videowidget.h
+	videoout/videowidget.h \
+	videoout/videoscopes.h \
+	videoout/scopeswidget.h
 
 TEMPLATE = lib
 
@@ -0,0 +1,523 @@
+#include <QCryptographicHash>
+#include <QDataStream>
+
+#include "afx/audiomix.h"
+#include "engine/composer.h"
+#include "engine/audiomixdown.h"
+
+
+
+static QList< QSharedPointer<AudioFilter> > currentFilters( const QList< QSharedPointer<AudioFilter> > &list, double pts, double frameDuration )
+{
+	// same selection as FList::getCurrentFilters
+	QList< QSharedPointer<AudioFilter> > cur;
+	for ( int i = 0; i < list.count(); ++i ) {
+		QSharedPointer<AudioFilter> f = list.at( i );
+		if ( f->getPosition() + f->getPositionOffset() <= pts + (frameDuration / 4 )
+			&& f->getPosition() + f->getPositionOffset() + f->getLength() - frameDuration >= pts - (frameDuration / 4) )
+			cur.append( f );
+	}
+	return cur;
+}
+
+
+
+static void filterSignature( QDataStream &ds, QSharedPointer<AudioFilter> f )
+{
+	if ( f.isNull() ) {
+		ds << QString();
+		return;
+	}
+	ds << f->getIdentifier() << f->getPosition() << f->getPositionOffset() << f->getLength();
+	QList<Parameter*> params = f->getParameters();
+	for ( int i = 0; i < params.count(); ++i ) {
+		Parameter *p = params[i];
+		ds << p->id << p->value;
+		for ( int k = 0; k < p->graph.keys.count(); ++k ) {
+			const AnimationKey &key = p->graph.keys.at( k );
+			ds << key.x << key.y << key.keyType;
+		}
+	}
+}
+
+
+
+AudioMixdown::AudioMixdown() : QThread(),
+	scene( NULL ),
+	sampleRate( DEFAULTSAMPLERATE ),
+	bytesPerSample( 0 ),
+	generation( 0 ),
+	playhead( 0 ),
+	running( false )
+{
+}
+
+
+
+AudioMixdown::~AudioMixdown()
+{
+	stop();
+	releaseInputs( true );
+	clearChunks();
+}
+
+
+
+void AudioMixdown::setScene( Scene *s )
+{
+	stop();
+	releaseInputs( true );
+	clearChunks();
+
+	scene = s;
+	if ( !scene )
+		return;
+
+	profile = scene->getProfile();
+	sampleRate = profile.getAudioSampleRate();
+	bytesPerSample = profile.getAudioChannels() * Profile::bytesPerChannel( &profile );
+	running = true;
+	start();
+}
+
+
+
+void AudioMixdown::stop()
+{
+	mutex.lock();
+	running = false;
+	wakeUp.wakeAll();
+	mutex.unlock();
+	wait();
+}
+
+
+
+void AudioMixdown::clearChunks()
+{
+	QMutexLocker ml( &mutex );
+	while ( !chunks.isEmpty() )
+		delete chunks.takeFirst();
+}
+
+
+
+void AudioMixdown::invalidate()
+{
+	QMutexLocker ml( &mutex );
+	++generation;
+	wakeUp.wakeAll();
+}
+
+
+
+qint64 AudioMixdown::sampleIndex( double pts )
+{
+	return qRound64( pts * sampleRate / MICROSECOND );
+}
+
+
+
+double AudioMixdown::samplePts( qint64 index )
+{
+	return (double)index * MICROSECOND / sampleRate;
+}
+
+
+
+MixdownChunk* AudioMixdown::findChunk( qint64 index )
+{
+	for ( int i = 0; i < chunks.count(); ++i ) {
+		if ( chunks[i]->index == index )
+			return chunks[i];
+	}
+	return NULL;
+}
+
+
+
+bool AudioMixdown::covers( double from, double to )
+{
+	if ( !scene || to <= from )
+		return false;
+
+	qint64 cs = chunkSamples();
+	qint64 first = sampleIndex( from ) / cs;
+	qint64 last = ( sampleIndex( to ) - 1 ) / cs;
+
+	QMutexLocker ml( &mutex );
+	for ( qint64 k = first; k <= last; ++k ) {
+		MixdownChunk *c = findChunk( k );
+		if ( !c || !c->valid || c->checkedGeneration != generation )
+			return false;
+	}
+	return true;
+}
+
+
+
+Frame* AudioMixdown::getMixedFrame( double pts, int nSamples )
+{
+	if ( !scene || pts < 0 )
+		return NULL;
+
+	qint64 cs = chunkSamples();
+	qint64 first = sampleIndex( pts );
+	qint64 last = first + nSamples;
+	QList<qint64> unchecked;
+
+	mutex.lock();
+	playhead = pts;
+	wakeUp.wakeAll();
+	int gen = generation;
+	for ( qint64 k = first / cs; k <= ( last - 1 ) / cs; ++k ) {
+		MixdownChunk *c = findChunk( k );
+		if ( !c || !c->valid ) {
+			mutex.unlock();
+			return NULL;
+		}
+		if ( c->checkedGeneration != gen )
+			unchecked.append( k );
+	}
+	mutex.unlock();
+
+	// something has been edited since the chunk was rendered
+	for ( int i = 0; i < unchecked.count(); ++i ) {
+		QByteArray sig;
+		snapshot( unchecked[i], sig, NULL );
+		QMutexLocker ml( &mutex );
+		MixdownChunk *c = findChunk( unchecked[i] );
+		if ( !c || !c->valid || c->signature != sig )
+			return NULL;
+		c->checkedGeneration = gen;
+	}
+
+	Frame *f = new Frame();
+	f->setAudioFrame( profile.getAudioChannels(), sampleRate, Profile::bytesPerChannel( &profile ), nSamples, pts );
+
+	QMutexLocker ml( &mutex );
+	qint64 s = first;
+	while ( s < last ) {
+		qint64 k = s / cs;
+		MixdownChunk *c = findChunk( k );
+		if ( !c || !c->valid ) {
+			delete f;
+			return NULL;
+		}
+		qint64 n = qMin( last, ( k + 1 ) * cs ) - s;
+		memcpy( f->data() + ( s - first ) * bytesPerSample, c->buffer->data() + ( s - k * cs ) * bytesPerSample, n * bytesPerSample );
+		s += n;
+	}
+
+	return f;
+}
+
+
+
+bool AudioMixdown::snapshot( qint64 index, QByteArray &signature, QList< QList<MixdownClip> > *tracks )
+{
+	double frameDuration = profile.getVideoFrameDuration();
+	double from = samplePts( index * chunkSamples() ) - frameDuration;
+	double to = samplePts( ( index + 1 ) * chunkSamples() ) + frameDuration;
+	int audible = 0;
+
+	QByteArray desc;
+	QDataStream ds( &desc, QIODevice::WriteOnly );
+	ds << sampleRate << profile.getAudioChannels() << frameDuration;
+
+	QMutexLocker ml( &scene->mutex );
+	for ( int j = 0; j < scene->tracks.count(); ++j ) {
+		Track *t = scene->tracks[j];
+		bool hasAudio = false;
+		ds << j;
+		if ( tracks )
+			tracks->append( QList<MixdownClip>() );
+		for ( int i = 0; i < t->clipCount(); ++i ) {
+			Clip *c = t->clipAt( i );
+			if ( c->position() + c->length() < from )
+				continue;
+			if ( c->position() > to )
+				break;
+
+			MixdownClip mc;
+			mc.clip = c;
+			mc.path = c->sourcePath();
+			mc.profile = c->getProfile();
+			mc.position = c->position();
+			mc.start = c->start();
+			mc.length = c->length();
+			mc.speed = c->getSpeed();
+			mc.sourceFilters = c->getSource()->audioFilters.copy();
+			mc.filters = c->audioFilters.copy();
+			if ( c->getTransition() ) {
+				mc.transitionLength = c->getTransition()->length();
+				mc.transitionFilter = c->getTransition()->getAudioFilter();
+			}
+			if ( mc.profile.hasAudio() )
+				hasAudio = true;
+
+			ds << mc.path << mc.profile.hasAudio() << mc.position << mc.start << mc.length << mc.speed << mc.transitionLength;
+			filterSignature( ds, mc.transitionFilter );
+			for ( int k = 0; k < mc.sourceFilters.count(); ++k )
+				filterSignature( ds, mc.sourceFilters[k] );
+			for ( int k = 0; k < mc.filters.count(); ++k )
+				filterSignature( ds, mc.filters[k] );
+
+			if ( tracks )
+				(*tracks)[j].append( mc );
+		}
+		if ( hasAudio )
+			++audible;
+	}
+	ml.unlock();
+
+	ds << audible;
+	signature = QCryptographicHash::hash( desc, QCryptographicHash::Md5 );
+
+	return audible >= MIXDOWNMINTRACKS;
+}
+
+
+
+Frame* AudioMixdown::getClipFrame( const MixdownClip &c, double pts, int nSamples )
+{
+	if ( !c.profile.hasAudio() )
+		return NULL;
+
+	MixdownInput *mi = NULL;
+	for ( int i = 0; i < inputs.count(); ++i ) {
+		if ( inputs[i]->clip.clip == c.clip ) {
+			mi = inputs[i];
+			break;
+		}
+	}
+
+	if ( !mi ) {
+		mi = new MixdownInput();
+		mi->input = new InputFF();
+		mi->input->setStreamMask( InputBase::AudioStream );
+		inputs.append( mi );
+	}
+
+	// reopen if not contiguous or if the clip has changed
+	if ( qAbs( mi->nextPts - pts ) > 1 || mi->clip.clip != c.clip || mi->clip.path != c.path
+		|| mi->clip.position != c.position || mi->clip.start != c.start || mi->clip.speed != c.speed )
+	{
+		double absSpeed = qAbs( c.speed );
+		Profile p = c.profile;
+		p.setAudioChannels( profile.getAudioChannels() );
+		p.setAudioLayout( profile.getAudioLayout() );
+		p.setAudioFormat( profile.getAudioFormat() );
+		if ( c.speed != 1 )
+			p.setAudioSampleRate( profile.getAudioSampleRate() / absSpeed );
+		else
+			p.setAudioSampleRate( profile.getAudioSampleRate() );
+
+		double pos;
+		if ( c.speed < 0 ) {
+			pos = c.start + (c.length * absSpeed) - profile.getVideoFrameDuration();
+			if ( c.position < pts )
+				pos -= (pts - c.position) * absSpeed;
+		}
+		else {
+			pos = c.start;
+			if ( c.position < pts )
+				pos += (pts - c.position) * absSpeed;
+		}
+
+		mi->clip = c;
+		mi->input->setSpeed( c.speed );
+		mi->input->setProfile( c.profile, p );
+		mi->input->openSeekPlay( c.path, pos, c.speed < 0 );
+	}
+
+	mi->used = true;
+	mi->nextPts = samplePts( sampleIndex( pts ) + nSamples );
+	Frame *f = mi->input->getAudioFrame( nSamples );
+	if ( f )
+		f->setPts( pts );
+	return f;
+}
+
+
+
+void AudioMixdown::releaseInputs( bool all )
+{
+	for ( int i = inputs.count() - 1; i >= 0; --i ) {
+		MixdownInput *mi = inputs[i];
+		if ( all || !mi->used ) {
+			delete mi->input;
+			delete inputs.takeAt( i );
+		}
+		else
+			mi->used = false;
+	}
+}
+
+
+
+void AudioMixdown::evictChunks( qint64 playheadChunk )
+{
+	for ( int i = chunks.count() - 1; i >= 0; --i ) {
+		if ( chunks[i]->index < playheadChunk - 1 )
+			delete chunks.takeAt( i );
+	}
+
+	while ( chunks.count() > MIXDOWNMAXCHUNKS ) {
+		int farthest = 0;
+		for ( int i = 1; i < chunks.count(); ++i ) {
+			if ( qAbs( chunks[i]->index - playheadChunk ) > qAbs( chunks[farthest]->index - playheadChunk ) )
+				farthest = i;
+		}
+		delete chunks.takeAt( farthest );
+	}
+}
+
+
+
+void AudioMixdown::renderChunk( qint64 index, QList< QList<MixdownClip> > &tracks, Buffer *buffer )
+{
+	qint64 cs = chunkSamples();
+	double frameDuration = profile.getVideoFrameDuration();
+	double margin = frameDuration / 4.0;
+	int block = sampleRate * frameDuration / MICROSECOND;
+	AudioMix am;
+
+	// mix in video frame sized blocks, as the composer does
+	for ( qint64 offset = 0; offset < cs && running; offset += block ) {
+		int nb = qMin( (qint64)block, cs - offset );
+		double pts = samplePts( index * cs + offset );
+		bool first = true;
+		Frame mix;
+		mix.setAudioFrame( profile.getAudioChannels(), sampleRate, Profile::bytesPerChannel( &profile ), nb, pts );
+
+		for ( int j = 0; j < tracks.count(); ++j ) {
+			QList<MixdownClip> &t = tracks[j];
+			int i;
+			for ( i = 0; i < t.count(); ++i ) {
+				if ( (t[i].position - margin) <= pts && (t[i].position + t[i].length - margin) > pts )
+					break;
+			}
+			if ( i == t.count() )
+				continue;
+
+			FrameSample fs;
+			MixdownClip &c = t[i];
+			fs.frame = getClipFrame( c, pts, nb );
+			if ( fs.frame ) {
+				fs.audioFilters = c.sourceFilters;
+				fs.audioFilters.append( currentFilters( c.filters, pts, frameDuration ) );
+			}
+			// Check for transition
+			if ( i < t.count() - 1 ) {
+				MixdownClip &ct = t[i + 1];
+				if ( ct.transitionLength >= 0 && (ct.position - margin) <= pts && (ct.position + ct.length - margin) > pts ) {
+					fs.transitionFrame.frame = getClipFrame( ct, pts, nb );
+					fs.transitionFrame.audioFilters = ct.sourceFilters;
+					fs.transitionFrame.audioFilters.append( currentFilters( ct.filters, pts, frameDuration ) );
+					if ( ct.position + ct.transitionLength + margin > pts )
+						fs.transitionFrame.audioTransitionFilter = ct.transitionFilter;
+				}
+			}
+
+			Frame *f = fs.frame ? fs.frame : fs.transitionFrame.frame;
+			Buffer *buf = f ? Composer::processAudioFrame( &fs, nb, bytesPerSample, &profile ) : NULL;
+			if ( buf ) {
+				if ( first )
+					memcpy( mix.data(), buf->data(), nb * bytesPerSample );
+				else
+					am.process( f, buf, &mix, mix.getBuffer(), mix.getBuffer(), &profile );
+				first = false;
+				BufferPool::globalInstance()->releaseBuffer( buf );
+			}
+			fs.clear();
+		}
+
+		if ( first )
+			memset( mix.data(), 0, nb * bytesPerSample );
+		memcpy( buffer->data() + offset * bytesPerSample, mix.data(), nb * bytesPerSample );
+	}
+}
+
+
+
+void AudioMixdown::run()
+{
+	int scanGeneration = -1;
+	qint64 scanChunk = -1;
+
+	while ( true ) {
+		mutex.lock();
+		if ( !running ) {
+			mutex.unlock();
+			break;
+		}
+		qint64 playheadChunk = sampleIndex( playhead ) / chunkSamples();
+		if ( scanGeneration == generation && scanChunk == playheadChunk ) {
+			wakeUp.wait( &mutex, 500 );
+			mutex.unlock();
+			continue;
+		}
+		int gen = generation;
+		mutex.unlock();
+
+		bool done = true, rendered = false;
+		for ( qint64 k = playheadChunk; k < playheadChunk + MIXDOWNLOOKAHEAD; ++k ) {
+			QByteArray sig;
+			QList< QList<MixdownClip> > tracks;
+			bool mix = snapshot( k, sig, &tracks );
+
+			mutex.lock();
+			if ( !running || gen != generation ) {
+				mutex.unlock();
+				done = false;
+				break;
+			}
+			// already passed by playback
+			if ( k < sampleIndex( playhead ) / chunkSamples() ) {
+				mutex.unlock();
+				continue;
+			}
+			MixdownChunk *c = findChunk( k );
+			if ( c && c->signature == sig ) {
+				c->checkedGeneration = gen;
+				mutex.unlock();
+				continue;
+			}
+			mutex.unlock();
+
+			MixdownChunk *nc = new MixdownChunk( k );
+			nc->signature = sig;
+			nc->checkedGeneration = gen;
+			if ( mix ) {
+				nc->buffer = BufferPool::globalInstance()->getBuffer( chunkSamples() * bytesPerSample );
+				renderChunk( k, tracks, nc->buffer );
+				rendered = true;
+				if ( !running ) {
+					delete nc;
+					done = false;
+					break;
+				}
+				nc->valid = true;
+			}
+
+			mutex.lock();
+			if ( ( c = findChunk( k ) ) ) {
+				chunks.removeOne( c );
+				delete c;
+			}
+			chunks.append( nc );
+			evictChunks( sampleIndex( playhead ) / chunkSamples() );
+			mutex.unlock();
+		}
+
+		if ( rendered )
+			releaseInputs( false );
+		if ( done ) {
+			scanGeneration = gen;
+			scanChunk = playheadChunk;
+		}
+	}
+
+	releaseInputs( true );
+}
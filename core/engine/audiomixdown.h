@@ -0,0 +1,121 @@
+#ifndef AUDIOMIXDOWN_H
+#define AUDIOMIXDOWN_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+
+#include "engine/scene.h"
+#include "input/input_ff.h"
+
+// one chunk holds one second of mixed audio
+#define MIXDOWNCHUNKDURATION MICROSECOND
+// chunks rendered ahead of the playhead
+#define MIXDOWNLOOKAHEAD 10
+#define MIXDOWNMAXCHUNKS 60
+// below this number of audible tracks, live mixing is cheap enough
+#define MIXDOWNMINTRACKS 3
+
+
+
+class MixdownChunk
+{
+public:
+	MixdownChunk( qint64 i ) : index( i ), buffer( NULL ), valid( false ), checkedGeneration( -1 ) {}
+	~MixdownChunk() {
+		if ( buffer )
+			BufferPool::globalInstance()->releaseBuffer( buffer );
+	}
+
+	qint64 index;
+	Buffer *buffer;
+	QByteArray signature;
+	// false if the chunk has not to be mixed in advance (too few tracks)
+	bool valid;
+	int checkedGeneration;
+};
+
+
+
+// A copy of the clip properties needed to render its audio outside of the scene mutex.
+class MixdownClip
+{
+public:
+	MixdownClip() : clip( NULL ), position( 0 ), start( 0 ), length( 0 ), speed( 1 ), transitionLength( -1 ) {}
+
+	// only used as an identifier, never dereferenced
+	Clip *clip;
+	QString path;
+	Profile profile;
+	double position, start, length, speed;
+	QList< QSharedPointer<AudioFilter> > sourceFilters;
+	QList< QSharedPointer<AudioFilter> > filters;
+	// the transition with the previous clip, if any
+	double transitionLength;
+	QSharedPointer<AudioFilter> transitionFilter;
+};
+
+
+
+class MixdownInput
+{
+public:
+	MixdownInput() : input( NULL ), nextPts( -1 ), used( false ) {}
+
+	MixdownClip clip;
+	InputFF *input;
+	double nextPts;
+	bool used;
+};
+
+
+
+// Renders the timeline audio in the background, chunk by chunk, so that
+// playback of scenes with many audio tracks only has to read a premixed buffer.
+// A chunk is identified by a signature of everything that contributes to its
+// content (clips, audio filters and transitions in range). Edits bump a generation
+// counter and chunks are checked against their signature before being used again.
+class AudioMixdown : public QThread
+{
+public:
+	AudioMixdown();
+	~AudioMixdown();
+
+	void setScene( Scene *s );
+	void invalidate();
+	// returns a frame of premixed audio, or NULL if not available
+	Frame* getMixedFrame( double pts, int nSamples );
+	// true if the range is known to be premixed. Does not lock the scene mutex.
+	bool covers( double from, double to );
+
+protected:
+	void run();
+
+private:
+	void stop();
+	void clearChunks();
+	qint64 sampleIndex( double pts );
+	double samplePts( qint64 index );
+	qint64 chunkSamples() { return sampleRate * MIXDOWNCHUNKDURATION / MICROSECOND; }
+	MixdownChunk* findChunk( qint64 index );
+	bool snapshot( qint64 index, QByteArray &signature, QList< QList<MixdownClip> > *tracks );
+	void renderChunk( qint64 index, QList< QList<MixdownClip> > &tracks, Buffer *buffer );
+	Frame* getClipFrame( const MixdownClip &c, double pts, int nSamples );
+	void releaseInputs( bool all );
+	void evictChunks( qint64 playheadChunk );
+
+	Scene *scene;
+	Profile profile;
+	int sampleRate;
+	int bytesPerSample;
+	QList<MixdownChunk*> chunks;
+	QList<MixdownInput*> inputs;
+	int generation;
+	double playhead;
+	bool running;
+	QMutex mutex;
+	QWaitCondition wakeUp;
+};
+
+#endif // AUDIOMIXDOWN_H
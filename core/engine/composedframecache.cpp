@@ -0,0 +1,197 @@
+#include <math.h>
+
+#include "engine/composedframecache.h"
+
+
+
+ComposedFrameCache::ComposedFrameCache()
+	: gpuFrames( 0 ),
+	ramBytes( 0 )
+{
+}
+
+
+
+ComposedFrameCache::~ComposedFrameCache()
+{
+	clear();
+}
+
+
+
+void ComposedFrameCache::clear()
+{
+	while ( !frames.isEmpty() )
+		remove( 0 );
+}
+
+
+
+void ComposedFrameCache::remove( int index )
+{
+	ComposedFrame *cf = frames.takeAt( index );
+	if ( cf->fbo ) {
+		delete cf->fbo;
+		--gpuFrames;
+	}
+	if ( cf->pbo ) {
+		delete cf->fence;
+		delete cf->pbo;
+		ramBytes -= cf->width * cf->height * 4;
+	}
+	if ( cf->buffer ) {
+		BufferPool::globalInstance()->releaseBuffer( cf->buffer );
+		ramBytes -= cf->width * cf->height * 4;
+	}
+	delete cf;
+}
+
+
+
+void ComposedFrameCache::insert( FBO *fbo, void *scene, qint64 generation, double pts, bool spill )
+{
+	readBack();
+
+	// frames of previous edits will never be asked again
+	for ( int i = 0; i < frames.count(); ++i ) {
+		ComposedFrame *cf = frames[i];
+		if ( cf->scene == scene && ( cf->generation != generation || fabs( cf->pts - pts ) < 1 ) )
+			remove( i-- );
+	}
+
+	FBO *copy = new FBO( fbo->width(), fbo->height(), GL_RGBA );
+	if ( !copy->isValid() ) {
+		delete copy;
+		return;
+	}
+	GLResource::copyFBO( fbo, copy );
+
+	ComposedFrame *cf = new ComposedFrame();
+	cf->scene = scene;
+	cf->generation = generation;
+	cf->pts = pts;
+	cf->width = fbo->width();
+	cf->height = fbo->height();
+	cf->fbo = copy;
+	frames.append( cf );
+	++gpuFrames;
+
+	while ( gpuFrames > COMPOSEDCACHEGPUFRAMES )
+		spillOldest( spill );
+}
+
+
+
+void ComposedFrameCache::spillOldest( bool spill )
+{
+	int i;
+	for ( i = 0; i < frames.count(); ++i ) {
+		if ( frames[i]->fbo )
+			break;
+	}
+	if ( i == frames.count() )
+		return;
+
+	ComposedFrame *cf = frames[i];
+	int size = cf->width * cf->height * 4;
+	if ( !spill || size > COMPOSEDCACHERAMBYTES ) {
+		remove( i );
+		return;
+	}
+
+	PBO *pbo = new PBO( size );
+	if ( !pbo->isValid() ) {
+		delete pbo;
+		remove( i );
+		return;
+	}
+	// asynchronous, the pixels are copied to memory by readBack
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, cf->fbo->fbo() );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, pbo->pbo() );
+	glReadPixels( 0, 0, cf->width, cf->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, 0 );
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+	cf->pbo = pbo;
+	cf->fence = new FENCE();
+	delete cf->fbo;
+	cf->fbo = NULL;
+	--gpuFrames;
+	ramBytes += size;
+
+	// drop the oldest frames in memory
+	for ( i = 0; i < frames.count() && ramBytes > COMPOSEDCACHERAMBYTES; ++i ) {
+		if ( frames[i]->buffer || frames[i]->pbo )
+			remove( i-- );
+	}
+}
+
+
+
+// Copies the completed read backs to memory.
+void ComposedFrameCache::readBack()
+{
+	for ( int i = 0; i < frames.count(); ++i ) {
+		ComposedFrame *cf = frames[i];
+		if ( !cf->pbo || glClientWaitSync( cf->fence->fence(), 0, 0 ) == GL_TIMEOUT_EXPIRED )
+			continue;
+
+		int size = cf->width * cf->height * 4;
+		Buffer *buffer = NULL;
+		glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, cf->pbo->pbo() );
+		void *data = glMapBuffer( GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY );
+		if ( data ) {
+			buffer = BufferPool::globalInstance()->getBuffer( size );
+			memcpy( buffer->data(), data, size );
+			glUnmapBuffer( GL_PIXEL_PACK_BUFFER_ARB );
+		}
+		glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, 0 );
+		if ( !buffer ) {
+			remove( i-- );
+			continue;
+		}
+
+		delete cf->fence;
+		cf->fence = NULL;
+		delete cf->pbo;
+		cf->pbo = NULL;
+		cf->buffer = buffer;
+	}
+}
+
+
+
+FBO* ComposedFrameCache::get( GLResource *gl, void *scene, qint64 generation, double pts, double margin, int width, int height )
+{
+	readBack();
+
+	for ( int i = 0; i < frames.count(); ++i ) {
+		ComposedFrame *cf = frames[i];
+		if ( cf->scene != scene || cf->generation != generation || fabs( cf->pts - pts ) >= margin
+			|| cf->width != width || cf->height != height )
+			continue;
+
+		FBO *fbo = gl->getFBO( width, height, GL_RGBA );
+		if ( !fbo )
+			return NULL;
+		if ( cf->fbo ) {
+			GLResource::copyFBO( cf->fbo, fbo );
+		}
+		else if ( cf->pbo ) {
+			// not read back yet, uploaded from the PBO
+			glBindBuffer( GL_PIXEL_UNPACK_BUFFER_ARB, cf->pbo->pbo() );
+			glBindTexture( GL_TEXTURE_2D, fbo->texture() );
+			glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+			glBindTexture( GL_TEXTURE_2D, 0 );
+			glBindBuffer( GL_PIXEL_UNPACK_BUFFER_ARB, 0 );
+		}
+		else {
+			glBindTexture( GL_TEXTURE_2D, fbo->texture() );
+			glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, cf->buffer->data() );
+			glBindTexture( GL_TEXTURE_2D, 0 );
+		}
+		frames.move( i, frames.count() - 1 );
+		return fbo;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,63 @@
+#ifndef COMPOSEDFRAMECACHE_H
+#define COMPOSEDFRAMECACHE_H
+
+#include <QList>
+
+#include "engine/glresource.h"
+#include "engine/bufferpool.h"
+
+// composed frames kept as textures
+#define COMPOSEDCACHEGPUFRAMES 24
+// older ones are read back to memory, 0 to disable
+#define COMPOSEDCACHERAMBYTES 512 * 1024 * 1024
+
+
+
+class ComposedFrame
+{
+public:
+	ComposedFrame() : scene( NULL ), generation( 0 ), pts( 0 ), width( 0 ), height( 0 ), fbo( NULL ), pbo( NULL ), fence( NULL ), buffer( NULL ) {}
+
+	void *scene;
+	qint64 generation;
+	double pts;
+	int width, height;
+	// NULL when in memory
+	FBO *fbo;
+	// asynchronous read back to memory in progress
+	PBO *pbo;
+	FENCE *fence;
+	// RGBA pixels, NULL when in texture
+	Buffer *buffer;
+};
+
+
+
+// Output frames of the composer, keyed by scene, edit generation and pts,
+// so that stepping and replaying don't run the Movit chain again.
+// Only used in the composer thread, with its GL context current.
+class ComposedFrameCache
+{
+public:
+	ComposedFrameCache();
+	~ComposedFrameCache();
+
+	// keeps a copy of fbo. If spill, the oldest texture is read back to memory
+	// instead of being dropped.
+	void insert( FBO *fbo, void *scene, qint64 generation, double pts, bool spill );
+	// a copy of the frame composed at pts, in a FBO from gl. NULL if not cached.
+	FBO* get( GLResource *gl, void *scene, qint64 generation, double pts, double margin, int width, int height );
+	void clear();
+
+private:
+	void remove( int index );
+	void spillOldest( bool spill );
+	void readBack();
+
+	// least recently used first
+	QList<ComposedFrame*> frames;
+	int gpuFrames;
+	qint64 ramBytes;
+};
+
+#endif // COMPOSEDFRAMECACHE_H
@@ -9,20 +9,34 @@
 
 
 
+int Composer::playbackQuality = GLFilter::FULLQUALITY;
+
+
+
 Composer::Composer( Sampler *samp, PlaybackBuffer *pb )
 	: playBackward( false ),
 	running( false ),
 	playing( false ),
 	oneShot( false ),
 	skipFrame( 0 ),
+	renderQuality( GLFilter::FULLQUALITY ),
+	previewScale( 1 ),
+	reducedShown( false ),
+	playbackLevel( PlaybackController::FULL ),
+	renderSeekMode( InputBase::SeekExact ),
+	renderScrubs( 0 ),
+	scrubs( 0 ),
 	hiddenContext( NULL ),
 	composerFence( NULL ),
+	lastOutput( NULL ),
+	lastOutputGeneration( 0 ),
 	movitPool( NULL ),
 	sampler( samp ),
 	playbackBuffer( pb ),
 	audioSampleDelta( 0 )
 {
 	outputResize = QSize(0, 0);
+	previewSize = QSize(0, 0);
 }
 
 
@@ -63,6 +77,13 @@ void Composer::discardFrame( int n )
 
 
 
+void Composer::setPlaybackLevel( int level )
+{
+	playbackLevel = level;
+}
+
+
+
 bool Composer::isPlaying()
 {
 	return playing || lastMsg.msgType != ItcMsg::RENDERSTOP;
@@ -115,6 +136,25 @@ void Composer::seekTo( double p, bool backward, bool seek )
 
 
 
+void Composer::scrubTo( double p )
+{
+	itcMutex.lock();
+	// remove previously queued RENDERSEEK msg ...
+	while ( !itcMsgList.isEmpty() ) {
+		if ( itcMsgList.last().msgType != ItcMsg::RENDERSEEK )
+			break;
+		itcMsgList.takeLast();
+	}
+	// ... and add this one
+	itcMsgList.append( ItcMsg( p, false, true, InputBase::SeekFast ) );
+	itcMutex.unlock();
+	// the seek in progress, if any, is outdated
+	scrubs.ref();
+	InputFF::cancelSeeks();
+}
+
+
+
 void Composer::frameByFrame()
 {
 	itcMutex.lock();
@@ -251,8 +291,18 @@ void Composer::run()
 				break;
 			}
 			case ItcMsg::RENDERSEEK: {
-				sampler->fromComposerSeekTo( lastMsg.pts, lastMsg.backward, lastMsg.seek );
+				renderSeekMode = lastMsg.seekMode;
+				renderScrubs = scrubs.load();
+				sampler->fromComposerSeekTo( lastMsg.pts, lastMsg.backward, lastMsg.seek, lastMsg.seekMode );
 				runOneShot( f );
+				renderSeekMode = InputBase::SeekExact;
+				if ( lastMsg.seekMode == InputBase::SeekFast ) {
+					// the exact frame follows, unless a newer seek is pending
+					itcMutex.lock();
+					if ( itcMsgList.isEmpty() || itcMsgList.first().msgType != ItcMsg::RENDERSEEK )
+						itcMsgList.prepend( ItcMsg( lastMsg.pts, lastMsg.backward, lastMsg.seek, InputBase::SeekCancelable ) );
+					itcMutex.unlock();
+				}
 				lastMsg.msgType = ItcMsg::RENDERSTOP;
 				break;
 			}
@@ -294,6 +344,9 @@ void Composer::run()
 					emit paused( true );
 					skipFrame = 0;
 					audioSampleDelta = 0;
+					// show the paused frame in full quality
+					if ( reducedShown )
+						updateFrame();
 				}
 				usleep( 1000 );
 			}
@@ -469,30 +522,139 @@ bool Composer::renderVideoFrame( Frame *dst )
 		}
 	}
 
+	if ( sampler->getMetronom()->isRenderMode() ) {
+		movitRender( dst );
+		return true;
+	}
+
+	// read once, an edit during the render must not be cached with the frame
+	qint64 generation = sampler->getEditGeneration();
+	if ( cachedRender( dst, generation ) )
+		return true;
+
 	movitRender( dst );
 
+	// draft or scaled frames and frames showing an OVD are not cached,
+	// filters set it while processing
+	if ( renderQuality == GLFilter::DRAFTQUALITY || previewScale < 1 )
+		return true;
+	// a keyframe shown while scrubbing, or the frame a canceled seek had reached
+	if ( renderSeekMode == InputBase::SeekFast
+		|| ( renderSeekMode == InputBase::SeekCancelable && scrubs.load() != renderScrubs ) )
+		return true;
+	Frame *f;
+	for ( i = 0; i < dst->sample->frames.count(); ++i ) {
+		if ( (f = dst->sample->frames[i]->frame) && f->glOVD )
+			return true;
+		if ( (f = dst->sample->frames[i]->transitionFrame.frame) && f->glOVD )
+			return true;
+	}
+	composedFrames.insert( dst->fbo(), sampler->getActiveScene(), generation, dst->pts(), !playing );
+
+	return true;
+}
+
+
+
+// Reuses the output frame composed at the same pts since the last edit.
+bool Composer::cachedRender( Frame *dst, qint64 generation )
+{
+	Profile projectProfile = sampler->getProfile();
+	double pts = sampler->currentPTS();
+	int w = projectProfile.getVideoWidth();
+	int h = projectProfile.getVideoHeight();
+	if (outputResize.width() > 0) {
+		w = outputResize.width();
+		h = outputResize.height();
+	}
+
+	waitFence();
+	FBO *fbo = composedFrames.get( &gl, sampler->getActiveScene(), generation, pts,
+								   projectProfile.getVideoFrameDuration() / 4.0, w, h );
+	if ( !fbo )
+		return false;
+
+	dst->setVideoFrame( Frame::GLTEXTURE, w, h, projectProfile.getVideoSAR(),
+					projectProfile.getVideoInterlaced(), projectProfile.getVideoTopFieldFirst(),
+					pts, projectProfile.getVideoFrameDuration() );
+	dst->glWidth = w;
+	dst->glHeight = h;
+	dst->glSAR = projectProfile.getVideoSAR();
+	dst->setFBO( fbo );
+	dst->setFence( gl.getFence() );
+	composerFence = gl.getFence();
+	glFlush();
+	return true;
+}
+
+
+
+// A progressive branch with filters and no transition always has its own chain,
+// so that becoming static or not never changes the main chain descriptor.
+bool Composer::isBranchApart( Frame *f, FrameSample *sample )
+{
+	return f->field() == Frame::NOFIELD && !sample->transitionFrame.frame && !sample->videoFilters.isEmpty();
+}
+
+
+
+// A branch rendered apart is reused when its input has been
+// still for a few frames and none of its filters is animated.
+bool Composer::isStaticBranch( Frame *f, FrameSample *sample, double pts )
+{
+	if ( !isBranchApart( f, sample ) )
+		return false;
+	if ( stillInputs.value( f->mmiProvider ) < STATICBRANCHMINDUPLICATES )
+		return false;
+	for ( int k = 0; k < sample->videoFilters.count(); ++k ) {
+		if ( sample->videoFilters[k]->isAnimated( pts ) )
+			return false;
+	}
 	return true;
 }
 
 
 
-void Composer::movitFrameDescriptor( QString prefix, Frame *f, QList< QSharedPointer<GLFilter> > *filters, QStringList &desc, Profile *projectProfile )
+void Composer::movitFrameDescriptor( QString prefix, Frame *f, QList< QSharedPointer<GLFilter> > *filters, QStringList &desc, Profile *projectProfile, bool staticBranch, bool placeable )
 {
 	double pts = sampler->currentPTS();
 	f->paddingAuto = f->resizeAuto = false;
+	f->staticBranch = staticBranch;
 	f->glWidth = f->profile.getVideoWidth();
 	f->glHeight = f->profile.getVideoHeight();
 	f->glSAR = f->profile.getVideoSAR();
+	f->glScale = previewScale;
 		
 	desc.append( prefix + MovitInput::getDescriptor( f ) );
+
+	// deinterlace
+	if ( f->field() != Frame::NOFIELD ) {
+		desc.append( prefix + GLDeinterlace().getDescriptor( pts, f, projectProfile ) );
+	}
 	
 	// correct orientation
 	if ( f->orientation() ) {
 		desc.append( prefix + GLOrientation().getDescriptor( pts, f, projectProfile ) );
 	}
+
+	// downscale as early as possible when composing the preview
+	if ( f->glScale < 1 ) {
+		desc.append( prefix + GLPreviewScale().getDescriptor( pts, f, projectProfile ) );
+	}
 		
+	QStringList filtersDesc;
+	QList<GLFilter*> sequence;
+	// frame size before each filter of the sequence
+	QList<QSize> sizes;
 	for ( int k = 0; k < filters->count(); ++k ) {
-		desc.append( prefix + filters->at(k)->getDescriptor( pts, f, projectProfile ) );
+		GLFilter *filter = filters->at(k).data();
+		filter->setQuality( renderQuality );
+		sizes.append( QSize( f->glWidth, f->glHeight ) );
+		QString fd = filter->getDescriptor( pts, f, projectProfile );
+		if ( renderQuality == GLFilter::DRAFTQUALITY && filter->hasDraftQuality() )
+			fd.append( " Draft" );
+		filtersDesc.append( fd );
+		sequence.append( filter );
 	}
 
 	// resize to match destination aspect ratio and/or output size
@@ -503,7 +665,9 @@ void Composer::movitFrameDescriptor( QString prefix, Frame *f, QList< QSharedPoi
 			|| ( f->glWidth != projectProfile->getVideoWidth() &&
 			f->glHeight != projectProfile->getVideoHeight() ) )
 		{		
-			desc.append( prefix + resizeFilter.getDescriptor( pts, f, projectProfile ) );
+			sizes.append( QSize( f->glWidth, f->glHeight ) );
+			filtersDesc.append( resizeFilter.getDescriptor( pts, f, projectProfile ) );
+			sequence.append( &resizeFilter );
 			f->resizeAuto = true;
 		}
 	}
@@ -511,10 +675,61 @@ void Composer::movitFrameDescriptor( QString prefix, Frame *f, QList< QSharedPoi
 	// padding
 	if ( !sampler->previewMode() ) {
 		if ( f->glWidth != projectProfile->getVideoWidth() || f->glHeight != projectProfile->getVideoHeight() ) {
-			desc.append( prefix + paddingFilter.getDescriptor( pts, f, projectProfile ) );
+			sizes.append( QSize( f->glWidth, f->glHeight ) );
+			filtersDesc.append( paddingFilter.getDescriptor( pts, f, projectProfile ) );
+			sequence.append( &paddingFilter );
 			f->paddingAuto = true;
 		}
 	}
+
+	sizes.append( QSize( f->glWidth, f->glHeight ) );
+
+	// the trailing axis aligned and opacity filters of a layer ending at
+	// the project size are applied by the compositor when it samples it
+	f->glPlaced = 0;
+	if ( placeable && !sampler->previewMode()
+		&& f->glWidth == projectProfile->getVideoWidth() && f->glHeight == projectProfile->getVideoHeight() )
+	{
+		int n = sequence.count();
+		while ( n > 0 && ( sequence[n - 1]->isAxisAligned() || sequence[n - 1]->isOpacity() ) )
+			--n;
+		f->glPlaced = sequence.count() - n;
+		sequence = sequence.mid( 0, n );
+		filtersDesc = filtersDesc.mid( 0, n );
+		// nothing left to render apart
+		if ( sequence.isEmpty() )
+			f->staticBranch = false;
+	}
+	f->glPlacedWidth = sizes[sequence.count()].width();
+	f->glPlacedHeight = sizes[sequence.count()].height();
+
+	// fuse consecutive axis aligned filters if that saves a resample
+	f->geometryRuns.clear();
+	int k = 0;
+	while ( k < sequence.count() ) {
+		int n = 0;
+		int resamples = 0;
+		while ( k + n < sequence.count() && sequence[k + n]->isAxisAligned() ) {
+			if ( sequence[k + n]->resamples() )
+				++resamples;
+			++n;
+		}
+		if ( n > 1 && resamples > 0 ) {
+			desc.append( prefix + QString( "GeometryAuto %1" ).arg( n ) );
+			f->geometryRuns.append( qMakePair( k, n ) );
+			k += n;
+		}
+		else {
+			desc.append( prefix + filtersDesc[k] );
+			++k;
+		}
+	}
+
+	if ( f->glPlaced )
+		desc.append( prefix + QString( "PlacedAuto %1" ).arg( f->glPlaced ) );
+
+	if ( f->staticBranch )
+		desc.append( prefix + QString("APART %1 %2").arg( f->glPlacedWidth ).arg( f->glPlacedHeight ) );
 }
 
 
@@ -527,7 +742,27 @@ Effect* Composer::movitFrameBuild( Frame *f, QList< QSharedPointer<GLFilter> > *
 	MovitBranch *branch = new MovitBranch( in );
 	*newBranch = branch;
 	movitChain.branches.append( branch );
-	current = movitChain.chain->add_input( in->getMovitInput( f ) );
+	EffectChain *chain = movitChain.chain;
+	if ( f->staticBranch ) {
+		Profile projectProfile = sampler->getProfile();
+		branch->staticChain = new EffectChain( projectProfile.getVideoSAR() * projectProfile.getVideoWidth(), projectProfile.getVideoHeight(), movitPool );
+		chain = branch->staticChain;
+	}
+	current = chain->add_input( in->getMovitInput( f ) );
+
+	// deinterlace, the previous frame is a second input
+	if ( f->field() != Frame::NOFIELD ) {
+		GLDeinterlace *deint = new GLDeinterlace();
+		deint->setTemporal( f->previousBuffer() != NULL );
+		QList<Effect*> el = deint->getMovitEffects();
+		branch->filters.append( new MovitFilter( el, deint ) );
+		if ( f->previousBuffer() ) {
+			Effect *previous = chain->add_input( in->getPreviousInput( f ) );
+			current = chain->add_effect( el.at( 0 ), current, previous );
+		}
+		else
+			current = chain->add_effect( el.at( 0 ), current );
+	}
 
 	// correct orientation
 	if ( f->orientation() ) {
@@ -536,40 +771,94 @@ Effect* Composer::movitFrameBuild( Frame *f, QList< QSharedPointer<GLFilter> > *
 		QList<Effect*> el = orient->getMovitEffects();
 		branch->filters.append( new MovitFilter( el, orient ) );
 		for ( int l = 0; l < el.count(); ++l )
-			current = movitChain.chain->add_effect( el.at( l ) );
+			current = chain->add_effect( el.at( l ) );
 	}
-	
-	// apply filters
-	for ( int k = 0; k < filters->count(); ++k ) {
-		QList<Effect*> el = filters->at(k)->getMovitEffects();
-		branch->filters.append( new MovitFilter( el ) );
-		for ( int l = 0; l < el.count(); ++l )
-			current = movitChain.chain->add_effect( el.at( l ) );
+
+	// preview downscale
+	if ( f->glScale < 1 ) {
+		GLPreviewScale *scale = new GLPreviewScale();
+		QList<Effect*> el = scale->getMovitEffects();
+		branch->filters.append( new MovitFilter( el, scale ) );
+		current = chain->add_effect( el.at( 0 ) );
 	}
 	
-	// auto resize to match destination aspect ratio
-	if ( f->resizeAuto ) {
-		GLResize *resize = new GLResize();
-		QList<Effect*> el = resize->getMovitEffects();
-		branch->filters.append( new MovitFilter( el, resize ) );
+	// filters, then auto resize to match destination aspect ratio and padding
+	QList< QSharedPointer<GLFilter> > sequence = *filters;
+	if ( f->resizeAuto )
+		sequence.append( QSharedPointer<GLFilter>( new GLResize() ) );
+	if ( f->paddingAuto )
+		sequence.append( QSharedPointer<GLFilter>( new GLPadding() ) );
+
+	int placed = sequence.count() - f->glPlaced;
+	int run = 0;
+	int k = 0;
+	while ( k < placed ) {
+		QList<Effect*> el;
+		if ( run < f->geometryRuns.count() && f->geometryRuns[run].first == k ) {
+			// fused geometry, frame filters are set again at each process
+			int n = f->geometryRuns[run++].second;
+			GLGeometry *geometry = new GLGeometry();
+			geometry->setFilters( sequence.mid( k, n ) );
+			el = geometry->getMovitEffects();
+			MovitFilter *mf = new MovitFilter( el, geometry );
+			mf->fusedFilters = qMax( qMin( filters->count() - k, n ), 0 );
+			branch->filters.append( mf );
+			k += n;
+		}
+		else {
+			el = sequence[k]->getMovitEffects();
+			MovitFilter *mf = new MovitFilter( el );
+			// frame filters are taken from the sample at each process
+			if ( k >= filters->count() )
+				mf->filter = sequence[k];
+			branch->filters.append( mf );
+			++k;
+		}
 		for ( int l = 0; l < el.count(); ++l )
-			current = movitChain.chain->add_effect( el.at( l ) );
+			current = chain->add_effect( el.at( l ) );
 	}
 
-	// padding
-	if ( f->paddingAuto ) {
-		GLPadding *padding = new GLPadding();
-		QList<Effect*> el = padding->getMovitEffects();
-		branch->filters.append( new MovitFilter( el, padding ) );
-		for ( int l = 0; l < el.count(); ++l )
-			current = movitChain.chain->add_effect( el.at( l ) );
+	// the remaining filters are set at each process, see GLCompositor
+	if ( f->glPlaced ) {
+		GLGeometry *geometry = new GLGeometry();
+		geometry->setFilters( sequence.mid( placed ) );
+		branch->placement = new MovitFilter( QList<Effect*>(), geometry );
+		branch->placement->fusedFilters = qMax( qMin( filters->count() - placed, f->glPlaced ), 0 );
 	}
-	
+
+	// the main chain reads the rendered branch
+	if ( f->staticBranch ) {
+		ImageFormat output_format;
+		output_format.color_space = COLORSPACE_sRGB;
+		output_format.gamma_curve = GAMMA_LINEAR;
+		chain->add_output( output_format, OUTPUT_ALPHA_FORMAT_PREMULTIPLIED );
+		chain->finalize();
+		branch->staticInput = new TextureInput( f->glPlacedWidth, f->glPlacedHeight );
+		current = movitChain.chain->add_input( branch->staticInput );
+	}
+
 	return current;
 }
 
 
 
+// vf is the index of the next frame filter
+void Composer::movitFilterProcess( MovitFilter *mf, QList< QSharedPointer<GLFilter> > *filters, int &vf, double pts, Frame *f, Profile *projectProfile )
+{
+	if ( !mf->filter ) {
+		filters->at( vf++ )->process( mf->effects, pts, f, projectProfile );
+		return;
+	}
+	if ( mf->fusedFilters ) {
+		GLGeometry *geometry = (GLGeometry*)mf->filter.data();
+		for ( int l = 0; l < mf->fusedFilters; ++l )
+			geometry->setFilter( l, filters->at( vf++ ) );
+	}
+	mf->filter->process( mf->effects, pts, f, projectProfile );
+}
+
+
+
 void Composer::movitRender( Frame *dst, bool update )
 {
 	int i, j, start=0;
@@ -594,25 +883,59 @@ void Composer::movitRender( Frame *dst, bool update )
 	QStringList currentDescriptor;
 	int ow = projectProfile.getVideoWidth();
 	int oh = projectProfile.getVideoHeight();
+	int layers = 0;
+	bool reduced = playing && !oneShot && !sampler->getMetronom()->isRenderMode();
+	renderQuality = GLFilter::FULLQUALITY;
+	if ( reduced && ( playbackQuality == GLFilter::DRAFTQUALITY || playbackLevel >= PlaybackController::DRAFT ) )
+		renderQuality = GLFilter::DRAFTQUALITY;
+	// compose at the viewer size, the chain then works in preview pixels
+	previewScale = 1;
+	if ( reduced && outputResize.width() <= 0 ) {
+		if ( previewSize.width() > 0 && previewSize.height() > 0 )
+			previewScale = qMin( 1.0, qMin( (double)previewSize.width() / ( ow * projectProfile.getVideoSAR() ), (double)previewSize.height() / oh ) );
+		if ( playbackLevel >= PlaybackController::HALFSIZE )
+			previewScale /= 2.0;
+		if ( previewScale < 1 ) {
+			previewScale = qMax( previewScale, 1.0 / 16.0 );
+			ow = qMax( qRound( ow * previewScale ), 1 );
+			oh = qMax( qRound( oh * previewScale ), 1 );
+			projectProfile.setVideoWidth( ow );
+			projectProfile.setVideoHeight( oh );
+		}
+	}
+	reducedShown = renderQuality == GLFilter::DRAFTQUALITY || previewScale < 1;
+	// layers are placed by the compositor, if any
+	int frames = 0;
+	while ( getNextFrame( dst, i ) )
+		++frames;
+	i = start;
 	while ( (f = getNextFrame( dst, i )) ) {
 		FrameSample *sample = dst->sample->frames[i - 1];
 		// input and filters
-		movitFrameDescriptor( "-", f, &sample->videoFilters, currentDescriptor, &projectProfile );
+		movitFrameDescriptor( "-", f, &sample->videoFilters, currentDescriptor, &projectProfile, isBranchApart( f, sample ), frames > 1 && !sample->transitionFrame.frame );
 		// transition
 		if ( sample->transitionFrame.frame && !sample->transitionFrame.videoTransitionFilter.isNull() ) {
 			// filters applied on first transition frame, if any
+			QString draft;
+			sample->transitionFrame.videoTransitionFilter->setQuality( renderQuality );
+			if ( renderQuality == GLFilter::DRAFTQUALITY && sample->transitionFrame.videoTransitionFilter->hasDraftQuality() )
+				draft = " Draft";
 			currentDescriptor.append( "--" + sample->transitionFrame.videoTransitionFilter->getDescriptorFirst( pts, f, &projectProfile ) );
 			movitFrameDescriptor( "->", sample->transitionFrame.frame, &sample->transitionFrame.videoFilters, currentDescriptor, &projectProfile );
 			// filters applied on second transition frame, if any
 			currentDescriptor.append( "-->" + sample->transitionFrame.videoTransitionFilter->getDescriptorSecond( pts, sample->transitionFrame.frame, &projectProfile ) );
-			currentDescriptor.append( "-<" + sample->transitionFrame.videoTransitionFilter->getDescriptor( pts, sample->transitionFrame.frame, &projectProfile ) );
+			currentDescriptor.append( "-<" + sample->transitionFrame.videoTransitionFilter->getDescriptor( pts, sample->transitionFrame.frame, &projectProfile ) + draft );
 		}
-		// overlay
-		if ( (i - 1) > start )
-			currentDescriptor.append( GLOverlay().getDescriptor( pts, f, &projectProfile ) );
+		++layers;
 		ow = f->glWidth;
 		oh = f->glHeight;
 	}
+	// overlays
+	for ( int next = 1; next < layers; next += MAXCOMPOSITORINPUTS - 1 ) {
+		GLCompositor compositor;
+		compositor.setInputs( qMin( MAXCOMPOSITORINPUTS - 1, layers - next ) + 1 );
+		currentDescriptor.append( compositor.getDescriptor( pts, NULL, &projectProfile ) );
+	}
 	// background
 	currentDescriptor.append( movitBackground.getDescriptor( pts, NULL, &projectProfile ) );
 	// output
@@ -624,7 +947,8 @@ void Composer::movitRender( Frame *dst, bool update )
 	}
 
 	// rebuild the chain if neccessary
-	if ( currentDescriptor !=  movitChain.descriptor ) {
+	bool rebuilt = currentDescriptor != movitChain.descriptor;
+	if ( rebuilt ) {
 		for ( int k = 0; k < currentDescriptor.count(); k++ )
 			printf("%s\n", currentDescriptor[k].toLocal8Bit().data());
 		movitChain.descriptor = currentDescriptor;
@@ -632,10 +956,11 @@ void Composer::movitRender( Frame *dst, bool update )
 		movitChain.chain = new EffectChain( projectProfile.getVideoSAR() * projectProfile.getVideoWidth(), projectProfile.getVideoHeight(), movitPool );
 
 		i = start;
-		Effect *last, *current = NULL;
+		Effect *current = NULL;
+		QList<Effect*> layerEffects;
+		QList<MovitBranch*> layerBranches;
 		
 		while ( (f = getNextFrame( dst, i )) ) {
-			last = current;
 			// input and filters
 			MovitBranch *branch;
 			FrameSample *sample = dst->sample->frames[i - 1];
@@ -660,14 +985,29 @@ void Composer::movitRender( Frame *dst, bool update )
 				for ( int l = 0; l < el.count(); ++l )
 					current = movitChain.chain->add_effect( el.at( l ), current, currentTrans );
 			}
-			// overlay
-			if ( last ) {
-				GLOverlay *overlay = new GLOverlay();
-				QList<Effect*> el = overlay->getMovitEffects();
-				branch->overlay = new MovitFilter( el, overlay );
-				for ( int l = 0; l < el.count(); ++l )
-					current = movitChain.chain->add_effect( el.at( l ), last, current );
+			layerEffects.append( current );
+			layerBranches.append( branch );
+		}
+		// overlays, all layers are blended in a single pass
+		// by groups of MAXCOMPOSITORINPUTS
+		current = layerEffects.isEmpty() ? NULL : layerEffects.first();
+		for ( int next = 1; next < layerEffects.count(); next += MAXCOMPOSITORINPUTS - 1 ) {
+			int count = qMin( MAXCOMPOSITORINPUTS - 1, layerEffects.count() - next );
+			std::vector<Effect*> inputs;
+			inputs.push_back( current );
+			for ( int l = next; l < next + count; ++l )
+				inputs.push_back( layerEffects[l] );
+			GLCompositor *compositor = new GLCompositor();
+			compositor->setInputs( count + 1 );
+			if ( next == 1 )
+				layerBranches[0]->compositor = compositor;
+			for ( int l = next; l < next + count; ++l ) {
+				layerBranches[l]->compositor = compositor;
+				layerBranches[l]->compositorInput = l - next + 1;
 			}
+			QList<Effect*> el = compositor->getMovitEffects();
+			layerBranches[next + count - 1]->overlay = new MovitFilter( el, compositor );
+			current = movitChain.chain->add_effect( el.at( 0 ), inputs );
 		}
 		// background
 		QList<Effect*> el = movitBackground.getMovitEffects();
@@ -689,7 +1029,11 @@ void Composer::movitRender( Frame *dst, bool update )
 		movitChain.chain->finalize();
 	}
 
-	// update inputs data and filters parameters
+	// update inputs data and filters parameters.
+	// If all inputs are duplicates and nothing is animated, the output is the same.
+	bool isStatic = true;
+	bool unchanged = !rebuilt && lastOutput && lastOutputGeneration == sampler->getEditGeneration();
+	QHash<QString, int> still;
 	i = start, j = 0;
 	int w = projectProfile.getVideoWidth();
 	int h = projectProfile.getVideoHeight();
@@ -702,14 +1046,45 @@ void Composer::movitRender( Frame *dst, bool update )
 		
 		// input and filters
 		MovitBranch *branch = movitChain.branches[ j++ ];
+		FrameSample *sample = dst->sample->frames[i - 1];
+		if ( f->field() != Frame::NOFIELD || sample->transitionFrame.frame )
+			isStatic = false;
+		for ( int k = 0; isStatic && k < sample->videoFilters.count(); ++k ) {
+			if ( sample->videoFilters[k]->isAnimated( pts ) )
+				isStatic = false;
+		}
+		bool duplicate = branch->input->isDuplicate( f );
+		if ( !duplicate )
+			unchanged = false;
+		still[ f->mmiProvider ] = duplicate ? stillInputs.value( f->mmiProvider ) + 1 : 0;
 		branch->input->process( f, &gl );
 		int vf = 0;
-		FrameSample *sample = dst->sample->frames[i - 1];
-		for ( int k = 0; k < branch->filters.count(); ++k ) { 
-			if ( !branch->filters[k]->filter )
-				sample->videoFilters[vf++]->process( branch->filters[k]->effects, pts, f, &projectProfile );
-			else
-				branch->filters[k]->filter->process( branch->filters[k]->effects, pts, f, &projectProfile );
+		for ( int k = 0; k < branch->filters.count(); ++k )
+			movitFilterProcess( branch->filters[k], &sample->videoFilters, vf, pts, f, &projectProfile );
+		// placement in the compositor
+		if ( branch->placement ) {
+			GLGeometry *geometry = (GLGeometry*)branch->placement->filter.data();
+			for ( int l = 0; l < branch->placement->fusedFilters; ++l )
+				geometry->setFilter( l, sample->videoFilters.at( vf++ ) );
+			double iw = f->glWidth;
+			double ih = f->glHeight;
+			AxisTransform t;
+			QRectF visible;
+			double opacity = geometry->getPlacement( pts, f, &projectProfile, t, visible );
+			branch->compositor->setPlacement( branch->compositorInput, iw, ih, t, visible, opacity );
+		}
+		// branch rendered apart, reused while static and nothing changed
+		if ( branch->staticChain ) {
+			qint64 generation = sampler->getEditGeneration();
+			if ( !duplicate || branch->staticGeneration != generation || !isStaticBranch( f, sample, pts ) ) {
+				int sw = branch->staticInput->get_width();
+				int sh = branch->staticInput->get_height();
+				if ( !branch->staticFBO )
+					branch->staticFBO = new FBO( sw, sh, GL_RGBA16F );
+				branch->staticChain->render_to_fbo( branch->staticFBO->fbo(), sw, sh );
+				branch->staticInput->setTexture( branch->staticFBO->texture() );
+				branch->staticGeneration = generation;
+			}
 		}
 		// transition
 		if ( sample->transitionFrame.frame && !sample->transitionFrame.videoTransitionFilter.isNull() ) {
@@ -720,22 +1095,20 @@ void Composer::movitRender( Frame *dst, bool update )
 			branchTrans->input->process( sample->transitionFrame.frame, &gl );
 			int tvf = 0;
 			int k;
-			for ( k = 0; k < branchTrans->filters.count() - 1; ++k ) { 
-				if ( !branchTrans->filters[k]->filter )
-					sample->transitionFrame.videoFilters[tvf++]->process( branchTrans->filters[k]->effects, pts, sample->transitionFrame.frame, &projectProfile );
-				else
-					branchTrans->filters[k]->filter->process( branchTrans->filters[k]->effects, pts, sample->transitionFrame.frame, &projectProfile );
-			}
+			for ( k = 0; k < branchTrans->filters.count() - 1; ++k )
+				movitFilterProcess( branchTrans->filters[k], &sample->transitionFrame.videoFilters, tvf, pts, sample->transitionFrame.frame, &projectProfile );
 			sample->transitionFrame.videoTransitionFilter->process( branchTrans->filters[k]->effects, pts, f, sample->transitionFrame.frame, &projectProfile );
 		}
 		// overlay
 		if ( branch->overlay && branch->overlay->filter )
-			branch->overlay->filter->process( branch->overlay->effects, pts, f, f, &projectProfile );
+			branch->overlay->filter->process( branch->overlay->effects, pts, f, &projectProfile );
 		
 		w = f->glWidth;
 		h = f->glHeight;
 	}
 
+	stillInputs = still;
+
 	// render
 	waitFence();
 	// output resizer
@@ -744,7 +1117,23 @@ void Composer::movitRender( Frame *dst, bool update )
 		h = outputResize.height();
 	}
 	FBO *fbo = gl.getFBO( w, h, GL_RGBA );
-	movitChain.chain->render_to_fbo( fbo->fbo(), w, h );
+	unchanged = unchanged && isStatic && lastOutput->width() == w && lastOutput->height() == h;
+	if ( unchanged ) {
+		GLResource::copyFBO( lastOutput, fbo );
+	}
+	else {
+		movitChain.chain->render_to_fbo( fbo->fbo(), w, h );
+		if ( lastOutput && ( !isStatic || lastOutput->width() != w || lastOutput->height() != h ) ) {
+			delete lastOutput;
+			lastOutput = NULL;
+		}
+		if ( isStatic ) {
+			if ( !lastOutput )
+				lastOutput = new FBO( w, h, GL_RGBA );
+			GLResource::copyFBO( fbo, lastOutput );
+			lastOutputGeneration = sampler->getEditGeneration();
+		}
+	}
 	
 	dst->glWidth = w;
 	dst->glHeight = h;
@@ -754,6 +1143,7 @@ void Composer::movitRender( Frame *dst, bool update )
 						projectProfile.getVideoInterlaced(), projectProfile.getVideoTopFieldFirst(),
 						pts, projectProfile.getVideoFrameDuration() );
 	}
+	dst->isUnchanged = unchanged;
 	dst->setFBO( fbo );
 	dst->setFence( gl.getFence() );
 	composerFence = gl.getFence();
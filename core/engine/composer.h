@@ -2,14 +2,19 @@
 #define COMPOSER_H
 
 #include "movitchain.h"
+#include "composedframecache.h"
 #include "vfx/movitbackground.h"
 #include "filtercollection.h"
 
 #include <QGLWidget>
+#include <QHash>
 #include <QThread>
 
 #include "engine/sampler.h"
 
+// duplicate input frames before a branch rendered apart is reused, see isStaticBranch
+#define STATICBRANCHMINDUPLICATES 3
+
 
 
 class ItcMsg
@@ -20,8 +25,8 @@ public:
 		: msgType( RENDERSTOP ) {}
 	ItcMsg( int type )
 		: msgType( type ) {}
-	ItcMsg( double p, bool b, bool s )
-		: msgType( RENDERSEEK ), pts( p ), backward( b ), seek( s ) {}
+	ItcMsg( double p, bool b, bool s, int mode = InputBase::SeekExact )
+		: msgType( RENDERSEEK ), pts( p ), backward( b ), seek( s ), seekMode( mode ) {}
 	ItcMsg( bool bw )
 		: msgType( RENDERSETPLAYBACKBUFFER ), backward( bw ) {}
 	ItcMsg( int type, int s )
@@ -32,6 +37,7 @@ public:
 	int msgType;
 	double pts;
 	bool backward, seek;
+	int seekMode;
 	int step;
 };
 
@@ -47,6 +53,8 @@ public:
 	void play( bool b, bool backward = false );
 	void setPlaybackBuffer( bool backward );
 	void seekTo( double p, bool backward = false, bool seek = true );
+	// like seekTo, but a close frame is shown first
+	void scrubTo( double p );
 	void frameByFrame();
 	void frameByFrameSetPlaybackBuffer( bool backward );
 	void skipBy( int step );
@@ -54,10 +62,17 @@ public:
 	bool isPlaying();
 	
 	void setOutputResize( QSize size ) { outputResize = size; }
+	// physical size of the viewer, playback is composed at this resolution
+	void setPreviewSize( QSize size ) { previewSize = size; }
+	// GLFilter::Quality used while playing. Playback also falls back
+	// to draft when the PlaybackController asks for it.
+	static void setPlaybackQuality( int q ) { playbackQuality = q; }
+	static Buffer* processAudioFrame( FrameSample *sample, int nsamples, int bitsPerSample, Profile *profile );
 
 public slots:
 	void setSharedContext( QGLWidget *shared );
 	void discardFrame( int );
+	void setPlaybackLevel( int level );
 
 private:
 	void run();
@@ -67,17 +82,33 @@ private:
 	Frame* getNextFrame( Frame *dst, int &track );
 	void waitFence();
 	bool renderVideoFrame( Frame *dst );
-	void movitFrameDescriptor( QString prefix, Frame *f, QList< QSharedPointer<GLFilter> > *filters, QStringList &desc, Profile *projectProfile );
+	bool cachedRender( Frame *dst, qint64 generation );
+	bool isBranchApart( Frame *f, FrameSample *sample );
+	bool isStaticBranch( Frame *f, FrameSample *sample, double pts );
+	void movitFrameDescriptor( QString prefix, Frame *f, QList< QSharedPointer<GLFilter> > *filters, QStringList &desc, Profile *projectProfile, bool staticBranch = false, bool placeable = false );
 	Effect* movitFrameBuild( Frame *f, QList< QSharedPointer<GLFilter> > *filters, MovitBranch **newBranch );
+	void movitFilterProcess( MovitFilter *mf, QList< QSharedPointer<GLFilter> > *filters, int &vf, double pts, Frame *f, Profile *projectProfile );
 	void movitRender( Frame *dst, bool update = false );
 	bool getNextAudioFrame( Frame *dst, int &track );
-	Buffer* processAudioFrame( FrameSample *sample, int nsamples, int bitsPerSample, Profile *profile );
 	bool renderAudioFrame( Frame *dst, int nSamples );
 
 	bool playBackward;
 	bool running, playing;
 	bool oneShot;
 	int skipFrame;
+	// quality and scale of the frame being rendered
+	int renderQuality;
+	double previewScale;
+	// draft or scaled frame shown
+	bool reducedShown;
+	// PlaybackController::Level
+	int playbackLevel;
+	// InputBase::SeekMode of the frame being rendered, and scrubs seen
+	// when its seek started. Frames that may not be the exact ones are not cached.
+	int renderSeekMode;
+	int renderScrubs;
+	QAtomicInt scrubs;
+	static int playbackQuality;
 	ItcMsg lastMsg;
 	QList<ItcMsg> itcMsgList;
 	QMutex itcMutex;
@@ -92,6 +123,12 @@ private:
 
 	MovitBackground movitBackground;
 	MovitChain movitChain;
+	ComposedFrameCache composedFrames;
+	// copy of the last output, reused while nothing changes
+	FBO *lastOutput;
+	qint64 lastOutputGeneration;
+	// consecutive duplicate frames per mmiProvider
+	QHash<QString, int> stillInputs;
 	ResourcePool *movitPool;
 
 	Sampler *sampler;
@@ -99,6 +136,7 @@ private:
 	double audioSampleDelta;
 	
 	QSize outputResize;
+	QSize previewSize;
 
 signals:
 	void newFrame( Frame* );
@@ -4,7 +4,9 @@
 // auto filters
 #include "vfx/glpadding.h"
 #include "vfx/glresize.h"
+#include "vfx/glpreviewscale.h"
 #include "vfx/glorientation.h"
+#include "vfx/gldeinterlace.h"
 
 // video filters
 #include "vfx/glbackgroundcolor.h"
@@ -48,6 +50,8 @@
 #include "vfx/glfrostedglass.h"
 #include "vfx/glhardcut.h"
 #include "vfx/gloverlay.h"
+#include "vfx/glcompositor.h"
+#include "vfx/glgeometry.h"
 #include "vfx/glzoomin.h"
 
 // audio filters
@@ -11,13 +11,17 @@ Frame::Frame( MQueue<Frame*> *origin )
 	mmi( 0 ),
 	sample( NULL ),
 	isDuplicate( false ),
+	isUnchanged( false ),
+	glScale( 1 ),
 	pType( Frame::NONE ),
 	fb( NULL ),
 	pb( NULL ),
 	glfence( NULL ),
 	pPTS( 0 ),
 	pOrientation( 0 ),
+	pField( NOFIELD ),
 	buffer( NULL ),
+	prevBuffer( NULL ),
 	originQueue( origin )
 {
 }
@@ -28,6 +32,8 @@ Frame::~Frame()
 {
 	if ( buffer )
 		BufferPool::globalInstance()->releaseBuffer( buffer );
+	if ( prevBuffer )
+		BufferPool::globalInstance()->releaseBuffer( prevBuffer );
 	if ( fb )
 		fb->setFree( true );
 	if ( pb )
@@ -68,9 +74,17 @@ void Frame::release()
 		buffer = NULL;
 	}
 
+	if ( prevBuffer ) {
+		BufferPool::globalInstance()->releaseBuffer( prevBuffer );
+		prevBuffer = NULL;
+	}
+
+	pField = NOFIELD;
 	mmi = 0;
 	audioReversed = false;
 	isDuplicate = false;
+	isUnchanged = false;
+	glScale = 1;
 
 	if ( originQueue )
 		originQueue->enqueue( this );
@@ -88,6 +102,17 @@ void Frame::setSharedBuffer( Buffer *b )
 
 
 
+void Frame::setPreviousBuffer( Buffer *b )
+{
+	if ( prevBuffer )
+		BufferPool::globalInstance()->releaseBuffer( prevBuffer );
+	prevBuffer = b;
+	if ( prevBuffer )
+		BufferPool::globalInstance()->useBuffer( prevBuffer );
+}
+
+
+
 void Frame::setVideoFrame( DataType t, int w, int h, double sar, bool il, bool tff, double p, double d, int rot )
 {
 	pType = t;
@@ -99,6 +124,7 @@ void Frame::setVideoFrame( DataType t, int w, int h, double sar, bool il, bool t
 	profile.setVideoFrameDuration( d );
 	pPTS = p;
 	pOrientation = rot;
+	pField = NOFIELD;
 
 	int s = w * h;
 	switch ( pType ) {
@@ -120,6 +146,7 @@ void Frame::setVideoFrame( Frame *src )
 	profile = src->profile;
 	pPTS = src->pts();
 	pOrientation = src->orientation();
+	pField = src->field();
 }
 
 
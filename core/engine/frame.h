@@ -91,6 +91,16 @@ public:
 
 	int orientation() { return pOrientation; }
 
+	// Interlaced frames not deinterlaced by the decoder are deinterlaced
+	// by the composer (see GLDeinterlace). field is the one to show,
+	// field order is given by profile.getVideoTopFieldFirst().
+	enum Field{ NOFIELD=-1, FIRSTFIELD=0, SECONDFIELD=1 };
+	void setField( int f ) { pField = f; }
+	int field() { return pField; }
+	// previous frame data for the deinterlacer, NULL if unknown
+	void setPreviousBuffer( Buffer *b );
+	Buffer* previousBuffer() { return prevBuffer; }
+
 	// memory management indicator. See input.h
 	quint32 mmi;
 	QString mmiProvider;
@@ -103,6 +113,8 @@ public:
 	ProjectSample *sample;
 	// indicate that this frame should not be pushed in playbackBuffer
 	bool isDuplicate;
+	// composed image is the same as the previous output frame
+	bool isUnchanged;
 
 	// frame profile
 	Profile profile;
@@ -110,10 +122,21 @@ public:
 	// composer helpers
 	int glWidth, glHeight;
 	double glSAR;
+	// preview pixels per project pixel, filters scale their pixel sizes by it
+	double glScale;
 	int glOVD;
 	QRectF glOVDRect;
 	QList<FilterTransform> glOVDTransformList;
 	bool paddingAuto, resizeAuto;
+	// input and filters rendered in their own chain, see MovitBranch
+	bool staticBranch;
+	// fused axis aligned filters, first index and count in the
+	// filters followed by auto resize and padding. See GLGeometry
+	QList< QPair<int, int> > geometryRuns;
+	// count of trailing axis aligned and opacity filters applied
+	// by the compositor, and the size before them. See GLCompositor
+	int glPlaced;
+	int glPlacedWidth, glPlacedHeight;
 
 private:
 	int pType;
@@ -123,8 +146,10 @@ private:
 	int pAudioSamples;
 	double pPTS;
 	int pOrientation;
+	int pField;
 
 	Buffer *buffer;
+	Buffer *prevBuffer;
 
 	MQueue<Frame*> *originQueue;
 };
@@ -181,7 +206,7 @@ public:
 class ProjectSample
 {
 public:
-	ProjectSample() {}
+	ProjectSample() : mixdown( false ) {}
 	// for video only
 	void copyVideoSample( ProjectSample *src ) {
 		clear();
@@ -195,6 +220,7 @@ public:
 				fs->frame->setType( sfs->frame->type() );
 				if ( sfs->frame->getBuffer() )
 					fs->frame->setSharedBuffer( sfs->frame->getBuffer() );
+				fs->frame->setPreviousBuffer( sfs->frame->previousBuffer() );
 				fs->videoFilters = sfs->videoFilters;
 				if ( sfs->transitionFrame.frame ) {
 					fs->transitionFrame.frame = new Frame();
@@ -202,6 +228,7 @@ public:
 					fs->transitionFrame.frame->setType( sfs->transitionFrame.frame->type() );
 					if ( sfs->transitionFrame.frame->getBuffer() )
 						fs->transitionFrame.frame->setSharedBuffer( sfs->transitionFrame.frame->getBuffer() );
+					fs->transitionFrame.frame->setPreviousBuffer( sfs->transitionFrame.frame->previousBuffer() );
 					fs->transitionFrame.videoFilters = sfs->transitionFrame.videoFilters;
 					fs->transitionFrame.videoTransitionFilter = sfs->transitionFrame.videoTransitionFilter;
 				}
@@ -220,6 +247,8 @@ public:
 	}
 
 	QList<FrameSample*> frames;
+	// audio only: frames holds a single premixed frame
+	bool mixdown;
 };
 
 #endif // FRAME_H
@@ -26,6 +26,17 @@ bool GLResource::black( Frame *dst )
 
 
 
+void GLResource::copyFBO( FBO *src, FBO *dst )
+{
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, src->fbo() );
+	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, dst->fbo() );
+	glBlitFramebuffer( 0, 0, src->width(), src->height(), 0, 0, dst->width(), dst->height(), GL_COLOR_BUFFER_BIT, GL_NEAREST );
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+}
+
+
+
 PBO* GLResource::getPBO( int size )
 {
 	int i;
@@ -168,7 +179,7 @@ bool FBO::init( int w, int h, GLint iformat )
 		return false;
 
 	glBindTexture( GL_TEXTURE_2D, tex );
-	glTexImage2D( GL_TEXTURE_2D, 0, iformat, iw, ih, 0, iformat, GL_UNSIGNED_BYTE, NULL );
+	glTexImage2D( GL_TEXTURE_2D, 0, iformat, iw, ih, 0, ( iformat == GL_RGBA16F || iformat == GL_RGBA32F ) ? GL_RGBA : iformat, GL_UNSIGNED_BYTE, NULL );
 	glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
 	glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
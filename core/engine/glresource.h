@@ -90,6 +90,7 @@ public:
 	FENCE* getFence();
 
 	bool black( Frame *dst );
+	static void copyFBO( FBO *src, FBO *dst );
 
 private:
 	QList<FBO*> fboList;
@@ -148,6 +148,8 @@ void Metronom::play( bool b, bool backward )
 		playBackward = backward;
 		speed = 0;
 		sclock = videoLate = 0;
+		controller.reset();
+		emit playbackLevel( controller.level() );
 		running = true;
 		if ( !renderMode )
 			ao.go();
@@ -180,6 +182,16 @@ void Metronom::changeSpeed( int s )
 
 
 
+double Metronom::getSpeedFactor()
+{
+	int s = speed;
+	if ( s >= 0 )
+		return (double)fastPlaybackSpeed[s][0] / (double)fastPlaybackSpeed[s][1];
+	return (double)slowPlaybackSpeed[-s][0] / (double)slowPlaybackSpeed[-s][1];
+}
+
+
+
 void Metronom::readData( Frame **data, double time, void *userdata )
 {
 	Metronom *m = (Metronom*)userdata;
@@ -268,6 +280,8 @@ void Metronom::runRender()
 	QGLFramebufferObject *fb = NULL;
 	struct SwsContext *swsCtx;
 	GLuint pbo = 0;
+	// the last converted frame, shared by unchanged ones
+	Buffer *lastConverted = NULL;
 
 	while ( running ) {
 		if ( (f = videoFrames.dequeue()) ) {
@@ -297,6 +311,17 @@ void Metronom::runRender()
 				glBufferData(GL_PIXEL_PACK_BUFFER_ARB, w * h * 3 + 32, NULL, GL_STREAM_READ);
 			}
 
+			if ( f->isUnchanged && lastConverted ) {
+				f->setSharedBuffer( lastConverted );
+				f->setVideoFrame( Frame::YUV420P, w, h, f->profile.getVideoSAR(),
+								  f->profile.getVideoInterlaced(),
+								  f->profile.getVideoTopFieldFirst(),
+								  f->pts(),
+								  f->profile.getVideoFrameDuration() );
+				encodeVideoFrames.enqueue( f );
+				continue;
+			}
+
 			if ( f->fence() )
 				glClientWaitSync( f->fence()->fence(), 0, GL_TIMEOUT_IGNORED );
 
@@ -331,12 +356,19 @@ void Metronom::runRender()
 			glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
 			fb->release();
 
+			if ( lastConverted )
+				BufferPool::globalInstance()->releaseBuffer( lastConverted );
+			lastConverted = f->getBuffer();
+			BufferPool::globalInstance()->useBuffer( lastConverted );
+
 			encodeVideoFrames.enqueue( f );
 		}
 		else
 			usleep( 1000 );
 	}
 
+	if ( lastConverted )
+		BufferPool::globalInstance()->releaseBuffer( lastConverted );
 	if (pbo)
 		glDeleteBuffers( 1, &pbo );
 	if ( fb )
@@ -410,8 +442,14 @@ void Metronom::runShow()
 			}
 			lastpts = f->pts();
 
+			// lower the preview cost before dropping frames
+			if ( controller.update( ct - t, videoFrames.count(), frameDuration ) ) {
+				emit playbackLevel( controller.level() );
+				emit osdMessage( controller.levelName(), 2 );
+			}
+
 			if ( t < ct ) {
-				if ( (ct - t) > frameDuration && skipped > -1 ) {
+				if ( (ct - t) > frameDuration && skipped > -1 && controller.canDrop( ct - t, frameDuration ) ) {
 					//predict = 0;
 					emit discardFrame( 1 );
 					if ( ++skipped > MICROSECOND / frameDuration / 4.0 ) {
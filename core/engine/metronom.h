@@ -5,6 +5,7 @@
 
 #include "audioout/ao_sdl.h"
 #include "engine/playbackbuffer.h"
+#include "engine/playbackcontroller.h"
 
 #include <QGLWidget>
 #include <QThread>
@@ -20,9 +21,11 @@ public:
 	Metronom( PlaybackBuffer *pb );
 	~Metronom();
 	void setRenderMode( bool b );
+	bool isRenderMode() { return renderMode; }
 	void play( bool b, bool backward = false );
 	bool isPlaying() { return isRunning(); }
 	void changeSpeed( int s );
+	double getSpeedFactor();
 	void flush();
 	Frame* getLastFrame();
 	Frame* getAndLockLastFrame();
@@ -57,6 +60,7 @@ private:
 	QGLWidget *fencesContext;
 
 	bool renderMode;
+	PlaybackController controller;
 	Frame *lastFrame;
 	QMutex lastFrameMutex;
 
@@ -64,6 +68,8 @@ signals:
 	void newFrame( Frame* );
 	void currentFramePts( double );
 	void discardFrame( int );
+	// PlaybackController::Level
+	void playbackLevel( int );
 
 	void osdMessage( const QString &text, int duration );
 	void osdTimer( bool );
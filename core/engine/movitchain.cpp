@@ -9,6 +9,7 @@
 
 MovitInput::MovitInput()
 	: input( NULL ),
+	previous( NULL ),
 	mmi( -1 )
 {
 }
@@ -38,14 +39,23 @@ bool MovitInput::setBuffer( PBO *p, Frame *src, int size )
 
 
 
+bool MovitInput::isDuplicate( Frame *src )
+{
+	return src->mmiProvider == mmiProvider && mmi != -1 && src->mmi != 0 && src->mmi == mmi;
+}
+
+
+
 bool MovitInput::process( Frame *src, GLResource *gl )
 {
-	if ( src->mmiProvider != mmiProvider )
-		mmiProvider = src->mmiProvider;
-	else if ( mmi != -1 && src->mmi != 0 && src->mmi == mmi )
+	if ( isDuplicate( src ) )
 		return true;
 	
+	mmiProvider = src->mmiProvider;
 	mmi = src->mmi ? src->mmi : ++src->mmi;
+
+	if ( previous && src->previousBuffer() )
+		setPreviousData( src );
 	
 	int w = src->profile.getVideoWidth();
 	int h = src->profile.getVideoHeight();
@@ -113,7 +123,56 @@ bool MovitInput::process( Frame *src, GLResource *gl )
 
 
 
+// the previous frame is only used by the deinterlacer, it is uploaded without PBO
+void MovitInput::setPreviousData( Frame *src )
+{
+	int w = src->profile.getVideoWidth();
+	int h = src->profile.getVideoHeight();
+	uint8_t *data = src->previousBuffer()->data();
+
+	switch ( src->type() ) {
+		case Frame::YUV420P: {
+			YCbCrInput *ycbcr = (YCbCrInput*)previous;
+			ycbcr->set_pixel_data( 0, data );
+			ycbcr->set_pixel_data( 1, &data[w * h]);
+			ycbcr->set_pixel_data( 2, &data[w * h + (w / 2 * h / 2)] );
+			break;
+		}
+		case Frame::YUV422P: {
+			YCbCrInput *ycbcr = (YCbCrInput*)previous;
+			ycbcr->set_pixel_data( 0, data );
+			ycbcr->set_pixel_data( 1, &data[w * h]);
+			ycbcr->set_pixel_data( 2, &data[w * h + (w / 2 * h)] );
+			break;
+		}
+		case Frame::RGB:
+		case Frame::RGBA: {
+			FlatInput *flat = (FlatInput*)previous;
+			flat->set_pixel_data( data );
+			break;
+		}
+	}
+}
+
+
+
 Input* MovitInput::getMovitInput( Frame *src )
+{
+	input = createInput( src );
+	return input;
+}
+
+
+
+Input* MovitInput::getPreviousInput( Frame *src )
+{
+	previous = createInput( src );
+	return previous;
+}
+
+
+
+Input* MovitInput::createInput( Frame *src )
 {
 	ImageFormat input_format;
 	YCbCrFormat ycbcr_format;
@@ -176,26 +235,21 @@ Input* MovitInput::getMovitInput( Frame *src )
 	switch ( src->type() ) {
 		case Frame::YUV420P: {
 			ycbcr_format.chroma_subsampling_x = ycbcr_format.chroma_subsampling_y = 2;
-			input = new YCbCrInput( input_format, ycbcr_format, src->profile.getVideoWidth(), src->profile.getVideoHeight() );
-			return input;
+			return new YCbCrInput( input_format, ycbcr_format, src->profile.getVideoWidth(), src->profile.getVideoHeight() );
 		}
 		case Frame::YUV422P: {
 			ycbcr_format.chroma_subsampling_x = 2;
 			ycbcr_format.chroma_subsampling_y = 1;
-			input = new YCbCrInput( input_format, ycbcr_format, src->profile.getVideoWidth(), src->profile.getVideoHeight() );
-			return input;
+			return new YCbCrInput( input_format, ycbcr_format, src->profile.getVideoWidth(), src->profile.getVideoHeight() );
 		}
 		case Frame::RGBA: {
-			input = new FlatInput( input_format, FORMAT_BGRA_POSTMULTIPLIED_ALPHA, GL_UNSIGNED_BYTE, src->profile.getVideoWidth(), src->profile.getVideoHeight() );
-			return input;
+			return new FlatInput( input_format, FORMAT_BGRA_POSTMULTIPLIED_ALPHA, GL_UNSIGNED_BYTE, src->profile.getVideoWidth(), src->profile.getVideoHeight() );
 		}
 		case Frame::RGB: {
-			input = new FlatInput( input_format, FORMAT_BGR, GL_UNSIGNED_BYTE, src->profile.getVideoWidth(), src->profile.getVideoHeight() );
-			return input;
+			return new FlatInput( input_format, FORMAT_BGR, GL_UNSIGNED_BYTE, src->profile.getVideoWidth(), src->profile.getVideoHeight() );
 		}
 		case Frame::GLSL: {
-			input = new BlankInput( src->profile.getVideoWidth(), src->profile.getVideoHeight() );
-			return input;
+			return new BlankInput( src->profile.getVideoWidth(), src->profile.getVideoHeight() );
 		}
 	}
 	return NULL;
@@ -228,7 +282,8 @@ QString MovitInput::getDescriptor( Frame *src )
 
 MovitFilter::MovitFilter( const QList<Effect*> &el, GLFilter *f )
 	: effects( el ),
-	filter( f )
+	filter( f ),
+	fusedFilters( 0 )
 {
 }
 
@@ -236,7 +291,14 @@ MovitFilter::MovitFilter( const QList<Effect*> &el, GLFilter *f )
 
 MovitBranch::MovitBranch( MovitInput *in )
 	: input( in ),
-	overlay( NULL )
+	overlay( NULL ),
+	placement( NULL ),
+	compositor( NULL ),
+	compositorInput( 0 ),
+	staticChain( NULL ),
+	staticInput( NULL ),
+	staticFBO( NULL ),
+	staticGeneration( -1 )
 {
 }
 
@@ -249,6 +311,13 @@ MovitBranch::~MovitBranch()
 		delete filters.takeFirst();
 	if ( overlay )
 		delete overlay;
+	if ( placement )
+		delete placement;
+	// owns the input and filters effects
+	if ( staticChain )
+		delete staticChain;
+	if ( staticFBO )
+		delete staticFBO;
 }
 
 
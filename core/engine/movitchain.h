@@ -7,6 +7,7 @@
 #include <movit/resource_pool.h>
 #include <movit/effect.h>
 #include <movit/input.h>
+#include <movit/effect_util.h>
 
 #include "engine/frame.h"
 #include "vfx/glfilter.h"
@@ -15,6 +16,8 @@
 
 using namespace movit;
 
+class GLCompositor;
+
 
 
 static const char *BlankInput_shader=
@@ -47,6 +50,54 @@ private:
 
 
 
+static const char *TextureInput_shader=
+"uniform sampler2D PREFIX(tex);\n"
+"vec4 FUNCNAME(vec2 tc) {\n"
+"	return tex2D( PREFIX(tex), tc );\n"
+"}\n";
+
+
+
+// A texture rendered by another chain, in linear light with premultiplied alpha.
+class TextureInput : public Input
+{
+public:
+	TextureInput( int w, int h ) : width( w ), height( h ), texture( 0 ), output_linear_gamma(true), needs_mipmaps(false) {
+		register_int("output_linear_gamma", &output_linear_gamma);
+		register_int("needs_mipmaps", &needs_mipmaps);
+	}
+	std::string effect_type_id() const { return "TextureInput"; }
+	std::string output_fragment_shader() { return TextureInput_shader; }
+	AlphaHandling alpha_handling() const { return INPUT_AND_OUTPUT_PREMULTIPLIED_ALPHA; }
+	bool can_output_linear_gamma() const { return true; }
+	unsigned get_width() const { return width; }
+	unsigned get_height() const { return height; }
+	Colorspace get_color_space() const { return COLORSPACE_sRGB; }
+	GammaCurve get_gamma_curve() const { return GAMMA_LINEAR; }
+
+	void setTexture( GLuint tex ) { texture = tex; }
+
+	void set_gl_state( GLuint glsl_program_num, const std::string &prefix, unsigned *sampler_num ) {
+		glActiveTexture( GL_TEXTURE0 + *sampler_num );
+		glBindTexture( GL_TEXTURE_2D, texture );
+		if ( needs_mipmaps ) {
+			glGenerateMipmap( GL_TEXTURE_2D );
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST );
+		}
+		else
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+		set_uniform_int( glsl_program_num, prefix, "tex", *sampler_num );
+		++*sampler_num;
+	}
+
+private:
+	int width, height;
+	GLuint texture;
+	int output_linear_gamma, needs_mipmaps;
+};
+
+
+
 class MovitInput
 {
 public:
@@ -54,13 +105,20 @@ public:
 	~MovitInput();
 
 	bool process( Frame *src, GLResource *gl = NULL );
+	// true if src data is the same as the last processed one
+	bool isDuplicate( Frame *src );
 	Input* getMovitInput( Frame *src );
+	// input for src->previousBuffer(), see GLDeinterlace
+	Input* getPreviousInput( Frame *src );
 
 	static QString getDescriptor( Frame *src );
 
 private:
+	Input* createInput( Frame *src );
 	bool setBuffer( PBO *p, Frame *src, int size );
+	void setPreviousData( Frame *src );
 	Input *input;
+	Input *previous;
 	qint64 mmi;
 	QString mmiProvider;
 };
@@ -74,6 +132,8 @@ public:
 	
 	QList<Effect*> effects;
 	QSharedPointer<GLFilter> filter;
+	// number of frame filters fused in a GLGeometry filter
+	int fusedFilters;
 };
 
 
@@ -87,6 +147,19 @@ public:
 	MovitInput *input;
 	QList<MovitFilter*> filters;
 	MovitFilter *overlay;
+	// trailing axis aligned and opacity filters (see Frame::glPlaced),
+	// applied by compositor input compositorInput
+	MovitFilter *placement;
+	GLCompositor *compositor;
+	int compositorInput;
+
+	// A branch rendered apart (see Frame::staticBranch) has its own chain,
+	// rendered in staticFBO unless it is static and neither its input nor
+	// an edit changed. The main chain reads staticFBO through staticInput.
+	EffectChain *staticChain;
+	TextureInput *staticInput;
+	FBO *staticFBO;
+	qint64 staticGeneration;
 };
 
 
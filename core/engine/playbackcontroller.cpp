@@ -0,0 +1,75 @@
+#include "engine/playbackcontroller.h"
+
+
+
+PlaybackController::PlaybackController()
+{
+	reset();
+}
+
+
+
+void PlaybackController::reset()
+{
+	currentLevel = FULL;
+	averageLate = 0;
+	settle = CONTROLLERSETTLEFRAMES;
+	headroom = 0;
+	recoverFrames = CONTROLLERRECOVERFRAMES;
+	raised = false;
+}
+
+
+
+bool PlaybackController::update( double late, int queued, double frameDuration )
+{
+	averageLate += ( late - averageLate ) / CONTROLLERSMOOTHING;
+	if ( settle > 0 ) {
+		--settle;
+		return false;
+	}
+
+	if ( averageLate > frameDuration / 2.0 ) {
+		headroom = 0;
+		if ( currentLevel == DROPFRAMES )
+			return false;
+		if ( raised )
+			recoverFrames = qMin( recoverFrames * 2, CONTROLLERRECOVERFRAMES * 8 );
+		raised = false;
+		++currentLevel;
+		settle = CONTROLLERSETTLEFRAMES;
+		return true;
+	}
+
+	if ( averageLate < 0 && queued > 0 ) {
+		if ( currentLevel == FULL || ++headroom < recoverFrames )
+			return false;
+		headroom = 0;
+		raised = true;
+		--currentLevel;
+		settle = CONTROLLERSETTLEFRAMES;
+		return true;
+	}
+
+	headroom = 0;
+	return false;
+}
+
+
+
+bool PlaybackController::canDrop( double late, double frameDuration )
+{
+	return currentLevel == DROPFRAMES || late > frameDuration * CONTROLLERMAXLATEFRAMES;
+}
+
+
+
+QString PlaybackController::levelName()
+{
+	switch ( currentLevel ) {
+		case DRAFT: return "Preview: draft effects";
+		case HALFSIZE: return "Preview: half resolution";
+		case DROPFRAMES: return "Preview: dropping frames";
+	}
+	return "Preview: full quality";
+}
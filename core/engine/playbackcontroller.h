@@ -0,0 +1,43 @@
+#ifndef PLAYBACKCONTROLLER_H
+#define PLAYBACKCONTROLLER_H
+
+#include <QString>
+
+// frames the lateness is averaged over
+#define CONTROLLERSMOOTHING 8
+// frames to wait after a change before judging its effect
+#define CONTROLLERSETTLEFRAMES 12
+// frames ready in advance before quality is raised again
+#define CONTROLLERRECOVERFRAMES 50
+// beyond that, frames are dropped whatever the level
+#define CONTROLLERMAXLATEFRAMES 12
+
+
+
+// Lowers the preview cost step by step while shown frames are late,
+// and raises it back when frames are ready in advance.
+// Frames are only dropped at the last level.
+class PlaybackController
+{
+public:
+	enum Level{ FULL, DRAFT, HALFSIZE, DROPFRAMES };
+
+	PlaybackController();
+	void reset();
+	// late in microseconds, negative when early. queued frames are ready to show.
+	// Returns true if the level has changed.
+	bool update( double late, int queued, double frameDuration );
+	bool canDrop( double late, double frameDuration );
+	int level() { return currentLevel; }
+	QString levelName();
+
+private:
+	int currentLevel;
+	double averageLate;
+	int settle, headroom;
+	// doubled when quality has to be lowered again right after being raised
+	int recoverFrames;
+	bool raised;
+};
+
+#endif // PLAYBACKCONTROLLER_H
@@ -0,0 +1,555 @@
+#include <sys/resource.h>
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QCryptographicHash>
+
+#include "util.h"
+#include "input/input_ff.h"
+#include "proxycollection.h"
+
+#define PROXY_DIR "proxy"
+#define PROXY_EXTENSION ".mkv"
+
+
+
+ProxyCollection ProxyCollection::globalInstance = ProxyCollection();
+
+
+
+ProxyCollection* ProxyCollection::getGlobalInstance()
+{
+	return &globalInstance;
+}
+
+
+
+ProxyCollection::ProxyCollection() : QObject()
+{
+	connect( &checkBuilderTimer, SIGNAL(timeout()), this, SLOT(checkBuilderThreads()) );
+}
+
+
+
+ProxyCollection::~ProxyCollection()
+{
+	while ( !builders.isEmpty() )
+		delete builders.takeFirst();
+}
+
+
+
+bool ProxyCollection::cdProxyDir( QDir &dir )
+{
+	dir = QDir::home();
+	if ( !dir.cd( MACHINTRUC_DIR ) ) {
+		if ( !dir.mkdir( MACHINTRUC_DIR ) ) {
+			qDebug() << "Can't create" << MACHINTRUC_DIR << "directory.";
+			return false;
+		}
+		if ( !dir.cd( MACHINTRUC_DIR ) )
+			return false;
+	}
+	if ( !dir.cd( PROXY_DIR ) ) {
+		if ( !dir.mkdir( PROXY_DIR ) ) {
+			qDebug() << "Can't create" << PROXY_DIR << "directory.";
+			return false;
+		}
+		if ( !dir.cd( PROXY_DIR ) )
+			return false;
+	}
+
+	return true;
+}
+
+
+
+// the size is part of the name, so that a modified source gets a new proxy
+QString ProxyCollection::proxyFilePath( QString path )
+{
+	QDir dir;
+	if ( !cdProxyDir( dir ) )
+		return QString();
+
+	QString key = path + QString::number( QFileInfo( path ).size() );
+	return dir.filePath( QCryptographicHash::hash( key.toUtf8(), QCryptographicHash::Sha256 ).toHex() + PROXY_EXTENSION );
+}
+
+
+
+bool ProxyCollection::needsProxy( Source *source )
+{
+	if ( source->getType() != InputBase::FFMPEG )
+		return false;
+
+	Profile prof = source->getProfile();
+	if ( !prof.hasVideo() || prof.getVideoHeight() <= PROXYHEIGHT )
+		return false;
+
+	if ( prof.getVideoWidth() * prof.getVideoHeight() > 1920 * 1080 )
+		return true;
+	if ( prof.getVideoCodecName().contains( "hevc", Qt::CaseInsensitive ) )
+		return true;
+	double seconds = prof.getStreamDuration() / MICROSECOND;
+	if ( seconds > 0 && source->getSize() * 8 / seconds > PROXYMINBITRATE )
+		return true;
+
+	return false;
+}
+
+
+
+bool ProxyCollection::probeProxy( QString fileName )
+{
+	QString path = proxyFilePath( fileName );
+	if ( path.isEmpty() || !QFile::exists( path ) )
+		return false;
+
+	InputFF *in = new InputFF();
+	Profile prof;
+	bool ok = in->probe( path, &prof );
+	delete in;
+	if ( !ok || !prof.hasVideo() )
+		return false;
+
+	QMutexLocker ml( &mutex );
+	proxies[fileName] = prof;
+	proxyPaths[fileName] = path;
+	return true;
+}
+
+
+
+void ProxyCollection::requestProxy( Source *source )
+{
+	QString fileName = source->getFileName();
+
+	mutex.lock();
+	bool known = proxies.contains( fileName ) || proxyErrors.contains( fileName );
+	mutex.unlock();
+	if ( known )
+		return;
+
+	for ( int i = 0; i < builders.count(); ++i ) {
+		if ( builders[i]->getFileName() == fileName )
+			return;
+	}
+
+	if ( probeProxy( fileName ) ) {
+		emit proxyReady( fileName );
+		return;
+	}
+
+	builders.append( new ProxyBuilder( fileName, source->getProfile() ) );
+	if ( !checkBuilderTimer.isActive() )
+		checkBuilderTimer.start( 3000 );
+}
+
+
+
+int ProxyCollection::getStatus( QString fileName, int &progress )
+{
+	mutex.lock();
+	bool ready = proxies.contains( fileName );
+	bool error = proxyErrors.contains( fileName );
+	mutex.unlock();
+	if ( ready )
+		return PROXYREADY;
+	if ( error )
+		return PROXYERROR;
+
+	for ( int i = 0; i < builders.count(); ++i ) {
+		ProxyBuilder *b = builders[i];
+		if ( b->getFileName() == fileName ) {
+			if ( b->getStarted() ) {
+				progress = b->getProgress();
+				return PROXYINPROGRESS;
+			}
+			return PROXYENQUEUED;
+		}
+	}
+
+	return PROXYNONE;
+}
+
+
+
+bool ProxyCollection::getProxy( QString fileName, QString &path, Profile &prof )
+{
+	QMutexLocker ml( &mutex );
+	if ( !proxies.contains( fileName ) )
+		return false;
+
+	path = proxyPaths[fileName];
+	prof = proxies[fileName];
+	return true;
+}
+
+
+
+void ProxyCollection::checkBuilderThreads()
+{
+	int working = 0;
+
+	for ( int i = 0; i < builders.count(); ++i ) {
+		ProxyBuilder *b = builders.at( i );
+		if ( b->getStarted() ) {
+			if ( !b->isRunning() ) {
+				QString fileName = b->getFileName();
+				builders.takeAt( i-- );
+				delete b;
+				if ( probeProxy( fileName ) ) {
+					emit proxyReady( fileName );
+				}
+				else {
+					mutex.lock();
+					proxyErrors.append( fileName );
+					mutex.unlock();
+				}
+			}
+			else {
+				++working;
+			}
+		}
+	}
+
+	// one at a time, it's a lot of io
+	for ( int i = 0; i < builders.count(); ++i ) {
+		if ( working > 0 )
+			break;
+		ProxyBuilder *b = builders.at( i );
+		if ( !b->getStarted() ) {
+			b->go();
+			++working;
+		}
+	}
+
+	if ( !builders.count() )
+		checkBuilderTimer.stop();
+}
+
+
+
+ProxyBuilder::ProxyBuilder( QString path, Profile prof )
+	: progress( 0 ),
+	started( false ),
+	finishedSuccess( false ),
+	running( false ),
+	fileName( path ),
+	profile( prof ),
+	inCtx( NULL ),
+	outCtx( NULL ),
+	decCtx( NULL ),
+	encCtx( NULL ),
+	outVideo( NULL ),
+	outAudio( NULL ),
+	videoIndex( -1 ),
+	audioIndex( -1 ),
+	sws( NULL ),
+	frame( NULL ),
+	scaled( NULL ),
+	yadif( NULL ),
+	lastPts( AV_NOPTS_VALUE )
+{
+	FFmpegCommon::getGlobalInstance()->initFFmpeg();
+}
+
+
+
+ProxyBuilder::~ProxyBuilder()
+{
+	stop();
+}
+
+
+
+void ProxyBuilder::go()
+{
+	if ( isRunning() )
+		return;
+	running = true;
+	start( QThread::LowestPriority );
+	started = true;
+}
+
+
+
+void ProxyBuilder::stop()
+{
+	running = false;
+	wait();
+}
+
+
+
+void ProxyBuilder::run()
+{
+	setpriority( PRIO_PROCESS, 0, 19 );
+
+	QString outName = ProxyCollection::proxyFilePath( fileName );
+	if ( outName.isEmpty() )
+		return;
+	QString partName = outName + ".part";
+
+	bool ok = transcode( partName );
+	close();
+
+	if ( ok && running ) {
+		QFile::remove( outName );
+		finishedSuccess = QFile::rename( partName, outName );
+	}
+	else {
+		QFile::remove( partName );
+	}
+}
+
+
+
+void ProxyBuilder::close()
+{
+	if ( sws ) {
+		sws_freeContext( sws );
+		sws = NULL;
+	}
+	if ( frame )
+		av_frame_free( &frame );
+	if ( scaled )
+		av_frame_free( &scaled );
+	if ( yadif ) {
+		delete yadif;
+		yadif = NULL;
+	}
+
+	if ( encCtx ) {
+		avcodec_close( encCtx );
+		encCtx = NULL;
+	}
+	if ( outCtx ) {
+		if ( outCtx->pb && !(outCtx->oformat->flags & AVFMT_NOFILE) )
+			avio_closep( &outCtx->pb );
+		avformat_free_context( outCtx );
+		outCtx = NULL;
+	}
+
+	if ( decCtx ) {
+		avcodec_close( decCtx );
+		decCtx = NULL;
+	}
+	if ( inCtx )
+		avformat_close_input( &inCtx );
+}
+
+
+
+bool ProxyBuilder::transcode( QString outName )
+{
+	if ( avformat_open_input( &inCtx, fileName.toLocal8Bit().data(), NULL, NULL ) != 0 )
+		return false;
+	if ( avformat_find_stream_info( inCtx, NULL ) < 0 )
+		return false;
+
+	for ( unsigned int i = 0; i < inCtx->nb_streams; ++i ) {
+		AVMediaType type = inCtx->streams[i]->codec->codec_type;
+		if ( videoIndex == -1 && type == AVMEDIA_TYPE_VIDEO )
+			videoIndex = i;
+		else if ( audioIndex == -1 && type == AVMEDIA_TYPE_AUDIO )
+			audioIndex = i;
+		else
+			inCtx->streams[i]->discard = AVDISCARD_ALL;
+	}
+	if ( videoIndex == -1 )
+		return false;
+
+	AVStream *inVideo = inCtx->streams[videoIndex];
+	AVCodec *decoder = avcodec_find_decoder( inVideo->codec->codec_id );
+	if ( !decoder || avcodec_open2( inVideo->codec, decoder, NULL ) < 0 )
+		return false;
+	decCtx = inVideo->codec;
+
+	int h = PROXYHEIGHT;
+	int w = ((decCtx->width * h / decCtx->height) + 1) & ~1;
+
+	avformat_alloc_output_context2( &outCtx, NULL, "matroska", outName.toLocal8Bit().data() );
+	if ( !outCtx )
+		return false;
+
+	// video, intra only so that seeking is cheap
+	AVCodec *encoder = avcodec_find_encoder( AV_CODEC_ID_MJPEG );
+	if ( !encoder )
+		return false;
+	outVideo = avformat_new_stream( outCtx, encoder );
+	if ( !outVideo )
+		return false;
+	outVideo->id = outCtx->nb_streams - 1;
+	AVCodecContext *ctx = outVideo->codec;
+	ctx->width = w;
+	ctx->height = h;
+	ctx->pix_fmt = AV_PIX_FMT_YUVJ420P;
+	ctx->time_base = inVideo->time_base;
+	// fields are half a frame apart
+	if ( profile.getVideoInterlaced() )
+		ctx->time_base.den *= 2;
+	ctx->sample_aspect_ratio = inVideo->sample_aspect_ratio.num ? inVideo->sample_aspect_ratio : decCtx->sample_aspect_ratio;
+	ctx->colorspace = decCtx->colorspace;
+	ctx->flags |= CODEC_FLAG_QSCALE;
+	ctx->global_quality = FF_QP2LAMBDA * PROXYQUALITY;
+	if ( outCtx->oformat->flags & AVFMT_GLOBALHEADER )
+		ctx->flags |= CODEC_FLAG_GLOBAL_HEADER;
+	if ( avcodec_open2( ctx, encoder, NULL ) < 0 )
+		return false;
+	encCtx = ctx;
+	outVideo->time_base = ctx->time_base;
+	outVideo->sample_aspect_ratio = ctx->sample_aspect_ratio;
+	av_dict_copy( &outVideo->metadata, inVideo->metadata, 0 );
+
+	// audio, copied
+	if ( audioIndex != -1 ) {
+		AVStream *inAudio = inCtx->streams[audioIndex];
+		outAudio = avformat_new_stream( outCtx, NULL );
+		if ( !outAudio )
+			return false;
+		outAudio->id = outCtx->nb_streams - 1;
+		if ( avcodec_copy_context( outAudio->codec, inAudio->codec ) < 0 )
+			return false;
+		outAudio->codec->codec_tag = 0;
+		if ( outCtx->oformat->flags & AVFMT_GLOBALHEADER )
+			outAudio->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+		outAudio->time_base = inAudio->time_base;
+	}
+
+	if ( avio_open( &outCtx->pb, outName.toLocal8Bit().data(), AVIO_FLAG_WRITE ) < 0 )
+		return false;
+	if ( avformat_write_header( outCtx, NULL ) < 0 )
+		return false;
+
+	frame = av_frame_alloc();
+	scaled = av_frame_alloc();
+	if ( !frame || !scaled )
+		return false;
+	scaled->format = ctx->pix_fmt;
+	scaled->width = w;
+	scaled->height = h;
+	if ( av_frame_get_buffer( scaled, 32 ) < 0 )
+		return false;
+
+	// scaling interleaved fields would bake the combing in the proxy
+	if ( profile.getVideoInterlaced() ) {
+		yadif = new Yadif();
+		if ( !yadif->reset( true, videoIndex, inCtx, decCtx ) )
+			return false;
+	}
+
+	AVPacket pkt;
+	av_init_packet( &pkt );
+	pkt.data = NULL;
+	pkt.size = 0;
+	int gotFrame;
+
+	while ( running && av_read_frame( inCtx, &pkt ) >= 0 ) {
+		if ( pkt.stream_index == videoIndex ) {
+			if ( avcodec_decode_video2( decCtx, frame, &gotFrame, &pkt ) >= 0 && gotFrame ) {
+				filterFrame( frame );
+				av_frame_unref( frame );
+			}
+		}
+		else if ( pkt.stream_index == audioIndex ) {
+			av_packet_rescale_ts( &pkt, inCtx->streams[audioIndex]->time_base, outAudio->time_base );
+			pkt.stream_index = outAudio->index;
+			if ( av_interleaved_write_frame( outCtx, &pkt ) < 0 )
+				qDebug() << "ProxyBuilder: error while writing audio packet.";
+		}
+		av_free_packet( &pkt );
+	}
+
+	if ( !running )
+		return false;
+
+	// get the delayed frames
+	pkt.data = NULL;
+	pkt.size = 0;
+	do {
+		gotFrame = 0;
+		if ( avcodec_decode_video2( decCtx, frame, &gotFrame, &pkt ) >= 0 && gotFrame ) {
+			filterFrame( frame );
+			av_frame_unref( frame );
+		}
+	} while ( gotFrame );
+	if ( yadif )
+		filterFrame( NULL );
+
+	av_write_trailer( outCtx );
+	return true;
+}
+
+
+
+// Deinterlaces if needed and encodes. NULL flushes yadif.
+void ProxyBuilder::filterFrame( AVFrame *f )
+{
+	if ( !yadif ) {
+		encodeFrame( f, av_frame_get_best_effort_timestamp( f ) );
+		return;
+	}
+
+	if ( f ) {
+		int64_t pts = av_frame_get_best_effort_timestamp( f );
+		if ( pts == AV_NOPTS_VALUE )
+			return;
+		// in the encoder time base, twice the stream one
+		double duration = av_rescale_q( profile.getVideoFrameDuration(), AV_TIME_BASE_Q, encCtx->time_base );
+		if ( !yadif->pushFrame( f, pts * 2, duration, 1 ) )
+			return;
+	}
+	else
+		yadif->pushFrame( NULL, 0, 0, 0 );
+
+	double pts, duration, ratio;
+	AVFrame *ya;
+	while ( (ya = yadif->pullFrame( pts, duration, ratio )) ) {
+		encodeFrame( ya, qRound64( pts ) );
+		av_frame_unref( ya );
+	}
+}
+
+
+
+bool ProxyBuilder::encodeFrame( AVFrame *f, int64_t pts )
+{
+	// the muxer wants increasing timestamps
+	if ( pts == AV_NOPTS_VALUE || (lastPts != AV_NOPTS_VALUE && pts <= lastPts) )
+		return false;
+	lastPts = pts;
+
+	sws = sws_getCachedContext( sws, f->width, f->height, (AVPixelFormat)f->format,
+								scaled->width, scaled->height, (AVPixelFormat)scaled->format,
+								SWS_BICUBIC, NULL, NULL, NULL );
+	if ( !sws )
+		return false;
+
+	av_frame_make_writable( scaled );
+	sws_scale( sws, f->data, f->linesize, 0, f->height, scaled->data, scaled->linesize );
+	scaled->pts = pts;
+
+	AVPacket pkt;
+	av_init_packet( &pkt );
+	pkt.data = NULL;
+	pkt.size = 0;
+	int gotPacket = 0;
+	if ( avcodec_encode_video2( encCtx, &pkt, scaled, &gotPacket ) < 0 )
+		return false;
+	if ( gotPacket ) {
+		av_packet_rescale_ts( &pkt, encCtx->time_base, outVideo->time_base );
+		pkt.stream_index = outVideo->index;
+		if ( av_interleaved_write_frame( outCtx, &pkt ) < 0 )
+			qDebug() << "ProxyBuilder: error while writing video packet.";
+	}
+
+	double t = pts * av_q2d( encCtx->time_base ) * AV_TIME_BASE;
+	double start = profile.getStreamStartTime();
+	double duration = profile.getStreamDuration();
+	if ( duration > 0 )
+		progress = qMax( 0.0, qMin( (t - start) * 100 / duration, 99.0 ) );
+
+	return true;
+}
@@ -0,0 +1,115 @@
+#ifndef PROXYCOLLECTION_H
+#define PROXYCOLLECTION_H
+
+#include <QThread>
+#include <QDir>
+#include <QHash>
+#include <QStringList>
+#include <QMutex>
+#include <QTimer>
+
+#include "source.h"
+#include "output/common_ff.h"
+
+// proxies are made for sources higher than this. At 720 lines, decoders still
+// default to bt709 like for the HD sources.
+#define PROXYHEIGHT 720
+// or with a higher bitrate (bits per second)
+#define PROXYMINBITRATE 50000000
+// mjpeg quantizer
+#define PROXYQUALITY 4
+
+class Yadif;
+
+
+
+// Transcodes a source into an intra frame (mjpeg), low resolution proxy.
+// Video frames keep their source pts, audio is copied.
+// Interlaced sources are deinterlaced at field rate before scaling.
+class ProxyBuilder : public QThread
+{
+public:
+	ProxyBuilder( QString path, Profile prof );
+	~ProxyBuilder();
+	void go();
+	void stop();
+	bool getFinishedSuccess() { return finishedSuccess; }
+	bool getStarted() { return started; }
+	int getProgress() { return progress; }
+	QString getFileName() { return fileName; }
+
+protected:
+	void run();
+
+private:
+	bool transcode( QString outName );
+	void filterFrame( AVFrame *f );
+	// pts in the encoder time base
+	bool encodeFrame( AVFrame *f, int64_t pts );
+	void close();
+
+	int progress;
+	bool started;
+	bool finishedSuccess;
+	bool running;
+	QString fileName;
+	Profile profile;
+
+	AVFormatContext *inCtx;
+	AVFormatContext *outCtx;
+	AVCodecContext *decCtx;
+	AVCodecContext *encCtx;
+	AVStream *outVideo;
+	AVStream *outAudio;
+	int videoIndex;
+	int audioIndex;
+	SwsContext *sws;
+	AVFrame *frame;
+	AVFrame *scaled;
+	// NULL if the source is progressive
+	Yadif *yadif;
+	int64_t lastPts;
+};
+
+
+
+class ProxyCollection : public QObject
+{
+	Q_OBJECT
+public:
+	enum Status{ PROXYNONE, PROXYERROR, PROXYENQUEUED, PROXYINPROGRESS, PROXYREADY };
+
+	static ProxyCollection* getGlobalInstance();
+	~ProxyCollection();
+
+	static bool needsProxy( Source *source );
+	void requestProxy( Source *source );
+	int getStatus( QString fileName, int &progress );
+	// path and profile of the proxy of fileName, false if not ready.
+	// Can be called from any thread.
+	bool getProxy( QString fileName, QString &path, Profile &prof );
+	bool hasRunningJobs() { return builders.count() > 0; }
+	static bool cdProxyDir( QDir &dir );
+	static QString proxyFilePath( QString path );
+
+private slots:
+	void checkBuilderThreads();
+
+private:
+	ProxyCollection();
+	ProxyCollection( const ProxyCollection& ) : QObject() {}
+	bool probeProxy( QString fileName );
+
+	QTimer checkBuilderTimer;
+	QList<ProxyBuilder*> builders;
+	QHash<QString, Profile> proxies;
+	QHash<QString, QString> proxyPaths;
+	QStringList proxyErrors;
+	QMutex mutex;
+	static ProxyCollection globalInstance;
+
+signals:
+	void proxyReady( QString fileName );
+};
+
+#endif // PROXYCOLLECTION_H
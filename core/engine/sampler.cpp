@@ -1,19 +1,33 @@
 #include "engine/composer.h"
 #include "engine/sampler.h"
+#include "engine/proxycollection.h"
 
 #define MAXINPUTS 20
+// idle inputs kept opened on their source, per input type
+#define MAXIDLEINPUTS 4
+// open inputs this many times their warm up cost ahead
+#define WARMUPCOSTFACTOR 8
+#define MAXFORWARDLOOKUP 10 * MICROSECOND
+// frames between two occlusion checks in the look-ahead
+#define OCCLUSIONSTEP 4
+#define VIDEOSHOWN -2
 
 
 
 Sampler::Sampler()
 	: playBackward( false ),
-	bufferedPlaybackPts( -1 )
+	updateGeneration( 0 ),
+	seekMode( InputBase::SeekExact ),
+	bufferedPlaybackPts( -1 ),
+	audioMixed( false )
 {	
 	metronom = new Metronom( &playbackBuffer );
 	composer = new Composer( this, &playbackBuffer );
 	connect( composer, SIGNAL(newFrame(Frame*)), this, SIGNAL(newFrame(Frame*)) );
 	connect( composer, SIGNAL(paused(bool)), this, SIGNAL(paused(bool)) );
 	connect( metronom, SIGNAL(discardFrame(int)), composer, SLOT(discardFrame(int)) );
+	connect( metronom, SIGNAL(playbackLevel(int)), composer, SLOT(setPlaybackLevel(int)) );
+	mixdown = new AudioMixdown();
 
 	Profile prof;
 
@@ -28,6 +42,7 @@ Sampler::Sampler()
 
 Sampler::~Sampler()
 {
+	delete mixdown;
 }
 
 
@@ -89,10 +104,13 @@ void Sampler::clearAll()
 void Sampler::drainScenes()
 {
 	stopComposer();
+	mixdown->setScene( NULL );
 
 	for ( int i = 0; i < sceneList.count(); ++i ) {
 		sceneList[i]->drain();
 	}
+	if ( sceneList.count() )
+		startMixdown();
 }
 
 
@@ -102,6 +120,8 @@ void Sampler::setSceneList( QList<Scene*> list )
 	if ( !list.count() )
 		return;
 
+	mixdown->setScene( NULL );
+	++updateGeneration;
 	while ( sceneList.count() ) {
 		delete sceneList.takeFirst();
 	}
@@ -110,6 +130,7 @@ void Sampler::setSceneList( QList<Scene*> list )
 	if ( currentScene != preview )
 		currentScene = timelineScene;
 	preview->drain();
+	startMixdown();
 }
 
 
@@ -119,12 +140,14 @@ bool Sampler::setProfile( Profile p )
 	bool ok = true;
 	
 	stopComposer();
+	mixdown->setScene( NULL );
 
 	for ( int i = 0; i < sceneList.count(); ++i ) {
 		bool b = sceneList[i]->setProfile( p );
 		if ( !b )
 			ok = false;
 	}
+	startMixdown();
 
 	composer->seekTo( currentPTS() );
 	return ok;
@@ -139,6 +162,24 @@ void Sampler::setOutputResize( QSize size )
 
 
 
+void Sampler::setRenderMode( bool b )
+{
+	metronom->setRenderMode( b );
+	// the mixdown would only open more inputs while rendering
+	mixdown->setScene( NULL );
+	startMixdown();
+}
+
+
+
+void Sampler::startMixdown()
+{
+	if ( !metronom->isRenderMode() )
+		mixdown->setScene( timelineScene );
+}
+
+
+
 void Sampler::switchMode( bool down )
 {
 	if ( (down ? timelineScene : preview) == currentScene )
@@ -213,6 +254,13 @@ void Sampler::setFencesContext( QGLWidget *shared )
 
 
 
+void Sampler::setPreviewSize( QSize size )
+{
+	composer->setPreviewSize( size );
+}
+
+
+
 bool Sampler::play( bool b, bool backward )
 {
 	if ( b ) {
@@ -236,7 +284,10 @@ void Sampler::slideSeek( double p )
 {
 	stopComposer();
 	metronom->flush();
-	composer->seekTo( p );
+	if ( metronom->isRenderMode() )
+		composer->seekTo( p );
+	else
+		composer->scrubTo( p );
 }
 
 
@@ -264,6 +315,8 @@ void Sampler::wheelSeek( int a )
 
 void Sampler::updateFrame()
 {
+	++updateGeneration;
+	mixdown->invalidate();
 	if ( composer->isPlaying() )
 		return;
 
@@ -315,7 +368,7 @@ double Sampler::fromComposerSetPlaybackBuffer( bool backward )
 
 
 // called from the composer thread
-void Sampler::fromComposerSeekTo( double p, bool backward, bool seek )
+void Sampler::fromComposerSeekTo( double p, bool backward, bool seek, int mode )
 {
 	int i, j;
 
@@ -329,6 +382,9 @@ void Sampler::fromComposerSeekTo( double p, bool backward, bool seek )
 			currentScene->tracks[j]->clipAt( i )->setInput( NULL );
 		currentScene->tracks[j]->resetIndexes( backward );
 	}
+	hiddenClips.clear();
+	audioMixed = false;
+	seekMode = mode;
 	currentScene->currentPTS = p;
 	currentScene->currentPTSAudio = p;
 	
@@ -432,19 +488,28 @@ void Sampler::rewardPTS()
 InputBase* Sampler::getInput( QString fn, InputBase::InputType type )
 {
 	InputBase *in = NULL, *candidate = NULL;
+	int idle = 0;
 
 	for ( int j = 0; j < inputs.count(); ++j ) {
 		in = inputs.at( j );
 		if ( !in->isUsed() && in->getType() == type ) {
-			if ( in->getSource() == fn )
+			if ( in->getSource() == fn ) {
+				inputs.move( j, inputs.count() - 1 );
 				return in;
+			}
 			if ( !candidate )
 				candidate = in;
+			++idle;
 		}
 	}
 	
-	if ( candidate )
+	// reopen the least recently used idle input only if there are enough
+	// of them, so that recently used sources don't have to be opened again.
+	if ( candidate && ( idle > MAXIDLEINPUTS || inputs.count() >= MAXINPUTS ) ) {
+		inputs.removeOne( candidate );
+		inputs.append( candidate );
 		return candidate;
+	}
 	
 	switch ( type ) {
 		case InputBase::FFMPEG:
@@ -464,9 +529,44 @@ InputBase* Sampler::getInput( QString fn, InputBase::InputType type )
 
 
 
+void Sampler::updateWarmUpCosts()
+{
+	for ( int i = 0; i < inputs.count(); ++i ) {
+		InputBase *in = inputs[i];
+		double cost = in->takeWarmUpCost();
+		if ( cost < 0 )
+			continue;
+		// follow peaks, forget them slowly
+		QString fn = in->getSource();
+		warmUpCosts[fn] = qMax( cost, warmUpCosts.value( fn, 0 ) * 0.9 );
+	}
+}
+
+
+
+double Sampler::clipLookup( Clip *c )
+{
+	double cost = warmUpCosts.value( c->sourcePath(), 0 ) * WARMUPCOSTFACTOR;
+	return qMax( (double)FORWARDLOOKUP, qMin( cost, (double)MAXFORWARDLOOKUP ) );
+}
+
+
+
 InputBase* Sampler::getClipInput( Clip *c, double pts )
 {
-	InputBase *in = getInput( c->getSource()->getFileName(), c->getSource()->getType() );
+	// preview plays the proxy if any, render always uses the source
+	QString path = c->sourcePath();
+	Profile inProfile = c->getProfile();
+	if ( c->getSource()->getUseProxy() && c->getSource()->getType() == InputBase::FFMPEG && !metronom->isRenderMode() ) {
+		Profile proxyProfile;
+		if ( ProxyCollection::getGlobalInstance()->getProxy( c->sourcePath(), path, proxyProfile ) ) {
+			// deinterlaced at field rate by the ProxyBuilder
+			inProfile = proxyProfile;
+			inProfile.setVideoInterlaced( false );
+		}
+	}
+	
+	InputBase *in = getInput( path, c->getSource()->getType() );
 	double speed = c->getSpeed();
 	double absSpeed = qAbs( speed );
 	Profile p = c->getProfile();
@@ -507,28 +607,152 @@ InputBase* Sampler::getClipInput( Clip *c, double pts )
 				pos -= (pts - c->position()) * absSpeed;
 		}
 		else {
-			pos = c->start();
-			if ( c->position() < pts )
-				pos += (pts - c->position()) * absSpeed;
+			pos = clipSourcePts( c, pts );
 		}
 	}
 	printf("%f %s cpos:%f, cstart:%f, seek:%f\n", pts, c->sourcePath().toLatin1().data(), c->position(), c->start(), pos);
 	
 	in->setSpeed( c->getSpeed() );
+	in->setPreviewSpeed( previewSpeed() );
 	if (in->getType() == InputBase::GLSL) {
 		p.setVideoWidth(cur.getVideoWidth());
 		p.setVideoHeight(cur.getVideoHeight());
 		p.setVideoSAR(cur.getVideoSAR());
 	}
-	in->setProfile( c->getProfile(), p );
-	in->openSeekPlay( c->sourcePath(), pos, speed < 0 ? !playBackward : playBackward );
+	in->setGLDeinterlace( GLDeinterlace::isEnabled() );
+	in->setSeekMode( seekMode );
+	in->setProfile( inProfile, p );
+	in->setStreamMask( (p.hasVideo() ? InputBase::VideoStream : InputBase::NoStream) | (p.hasAudio() ? InputBase::AudioStream : InputBase::NoStream) );
+	in->openSeekPlay( path, pos, speed < 0 ? !playBackward : playBackward );
 	c->setInput( in );
+	hiddenClips.remove( c );
 
 	return in;
 }
 
 
 
+// source pts of a forward clip at timeline pts
+double Sampler::clipSourcePts( Clip *c, double pts )
+{
+	double pos = c->start();
+	if ( c->position() < pts )
+		pos += (pts - c->position()) * qAbs( c->getSpeed() );
+	return pos;
+}
+
+
+
+// 0 when rendering, all frames are then decoded
+double Sampler::previewSpeed()
+{
+	if ( metronom->isRenderMode() )
+		return 0;
+	return metronom->getSpeedFactor();
+}
+
+
+
+bool Sampler::canHideClip( Clip *c )
+{
+	return !playBackward && c->getSpeed() > 0 && c->getProfile().hasVideo();
+}
+
+
+
+// true if the clip i of track t covers the whole frame at pts
+bool Sampler::clipOccludes( Track *t, int i, double pts, double margin )
+{
+	Clip *c = t->clipAt( i );
+	if ( !opaqueSources.value( c->sourcePath(), false ) )
+		return false;
+
+	Profile prof = c->getProfile();
+	Profile out = currentScene->getProfile();
+	if ( prof.getVideoWidth() != out.getVideoWidth() || prof.getVideoHeight() != out.getVideoHeight()
+		|| qAbs( prof.getVideoSAR() - out.getVideoSAR() ) > 1e-3 )
+		return false;
+
+	// in transition with the next clip
+	if ( i < t->clipCount() - 1 && (t->clipAt( i + 1 )->position() - margin) <= pts )
+		return false;
+
+	QList< QSharedPointer<GLFilter> > filters = c->getSource()->videoFilters.copy();
+	filters.append( c->videoFilters.getCurrentFilters( pts, margin * 4 ) );
+	for ( int k = 0; k < filters.count(); ++k ) {
+		if ( !filters[k]->keepsFrameOpaque( pts ) )
+			return false;
+	}
+
+	return true;
+}
+
+
+
+bool Sampler::trackHidden( int track, double pts, double margin )
+{
+	for ( int j = track + 1; j < currentScene->tracks.count(); ++j ) {
+		Track *t = currentScene->tracks[j];
+		int i, hint = t->currentClipIndex();
+		if ( hint < 0 || hint >= t->clipCount() || t->clipAt( hint )->position() - margin > pts )
+			hint = 0;
+		if ( searchCurrentClip( i, t, hint, pts, margin ) && clipOccludes( t, i, pts, margin ) )
+			return true;
+	}
+	return false;
+}
+
+
+
+// first pts of [from, to] where the track is not hidden, -1 if none
+double Sampler::firstVisiblePts( int track, double from, double to, double margin )
+{
+	double dur = currentScene->getProfile().getVideoFrameDuration();
+	double last = -1;
+
+	for ( double pts = from; pts <= to; pts += dur * OCCLUSIONSTEP ) {
+		if ( !trackHidden( track, pts, margin ) ) {
+			if ( last < 0 )
+				return pts;
+			for ( double p = last + dur; p < pts; p += dur ) {
+				if ( !trackHidden( track, p, margin ) )
+					return p;
+			}
+			return pts;
+		}
+		last = pts;
+	}
+
+	return -1;
+}
+
+
+
+// Suspends the video of a clip while it is hidden,
+// and resumes it so that frames are ready when it shows up.
+void Sampler::updateHiddenClip( Clip *c, InputBase *in, double visible, double from, double margin )
+{
+	double state = hiddenClips.value( c, VIDEOSHOWN );
+
+	if ( visible < 0 ) {
+		if ( state != -1 ) {
+			in->suspendVideo();
+			hiddenClips[c] = -1;
+		}
+	}
+	else if ( visible <= from + margin ) {
+		if ( state == -1 || state > from + margin )
+			in->resumeVideo( clipSourcePts( c, from ) );
+		hiddenClips.remove( c );
+	}
+	else if ( state == VIDEOSHOWN || state == -1 || qAbs( state - visible ) > margin ) {
+		in->resumeVideo( clipSourcePts( c, visible ) );
+		hiddenClips[c] = visible;
+	}
+}
+
+
+
 Clip* Sampler::searchCurrentClip( int &i, Track *t, int clipIndex, double pts, double margin )
 {
 	Clip *c = NULL;
@@ -594,25 +818,39 @@ void Sampler::getVideoTracks( Frame *dst )
 	if ( dst->sample )
 		delete dst->sample;
 	dst->sample = new ProjectSample();
+	for ( j = 0; j < currentScene->tracks.count(); ++j )
+		dst->sample->frames.append( new FrameSample() );
 	
-	for ( j = 0; j < currentScene->tracks.count(); ++j ) {
+	// from top to bottom, tracks under an opaque frame are hidden
+	bool hidden = false;
+	for ( j = currentScene->tracks.count() - 1; j >= 0; --j ) {
 		c = NULL;
 		Track *t = currentScene->tracks[j];
 		if ( currentScene->update )
 			t->resetIndexes( playBackward );
 		// find the clip at currentScene->currentPTS
 		c = searchCurrentClip( i, t, t->currentClipIndex(), currentScene->currentPTS, margin );
-		FrameSample *fs = new FrameSample();
-		dst->sample->frames.append( fs );
+		FrameSample *fs = dst->sample->frames[j];
 		if ( c ) {
 			t->setCurrentClipIndex( i );
+			if ( hidden && canHideClip( c ) )
+				continue;
 			if ( !(in = c->getInput()) )
 				in = getClipInput( c, currentScene->currentPTS );
+			else if ( hiddenClips.contains( c ) ) {
+				// visible before its video was resumed
+				double state = hiddenClips.take( c );
+				if ( state < 0 || state > currentScene->currentPTS + margin )
+					in->resumeVideo( clipSourcePts( c, currentScene->currentPTS ) );
+			}
 			f = in->getVideoFrame();
 			if ( f ) {
 				fs->frame = f;
 				fs->videoFilters = c->getSource()->videoFilters.copy();
 				fs->videoFilters.append( c->videoFilters.getCurrentFilters( currentScene->currentPTS, margin * 4 ) );
+				int type = f->type();
+				opaqueSources[ c->sourcePath() ] = ( type == Frame::YUV420P || type == Frame::YUV422P || type == Frame::RGB )
+					&& f->orientation() % 180 == 0;
 			}
 			// Check for transition
 			if ( playBackward ? i > 0 : i < t->clipCount() - 1 ) {
@@ -647,6 +885,8 @@ void Sampler::getVideoTracks( Frame *dst )
 					}
 				}
 			}
+			if ( !playBackward && fs->frame && !fs->transitionFrame.frame && clipOccludes( t, i, currentScene->currentPTS, margin ) )
+				hidden = true;
 		}
 	}
 
@@ -680,8 +920,12 @@ int Sampler::updateVideoFrame( Frame *dst )
 		}
 		if ( c && c->getProfile().hasVideo() ) {
 			FrameSample *fs = dst->sample->frames.at( j );
-			if ( !fs->frame )
+			if ( !fs->frame ) {
+				// not pulled while hidden by upper tracks
+				if ( !playBackward && trackHidden( j, dst->pts(), margin ) )
+					continue;
 				return 0;
+			}
 			++nframes;
 			fs->clear( false );
 			fs->videoFilters = c->getSource()->videoFilters.copy();
@@ -737,11 +981,24 @@ void Sampler::getAudioTracks( Frame *dst, int nSamples )
 		return;
 	}
 
+	Frame *mixed = NULL;
+	if ( !playBackward && currentScene == timelineScene && !metronom->isRenderMode() ) {
+		if ( currentScene->update )
+			mixdown->invalidate();
+		mixed = mixdown->getMixedFrame( currentScene->currentPTSAudio, nSamples );
+	}
+
 	QMutexLocker ml( &currentScene->mutex );
 	
 	if ( dst->sample )
 		delete dst->sample;
 	dst->sample = new ProjectSample();
+	if ( mixed ) {
+		FrameSample *fs = new FrameSample();
+		fs->frame = mixed;
+		dst->sample->frames.append( fs );
+		dst->sample->mixdown = true;
+	}
 	
 	for ( j = 0; j < currentScene->tracks.count(); ++j ) {
 		c = NULL;
@@ -750,10 +1007,18 @@ void Sampler::getAudioTracks( Frame *dst, int nSamples )
 			t->resetIndexes( playBackward );
 		// find the clip at currentScene->currentPTSAudio
 		c = searchCurrentClip( i, t, t->currentClipIndexAudio(), currentScene->currentPTSAudio, margin );
+		if ( mixed ) {
+			// inputs are not read
+			if ( c )
+				t->setCurrentClipIndexAudio( i );
+			continue;
+		}
 		FrameSample *fs = new FrameSample();
 		dst->sample->frames.append( fs );
 		if ( c ) {
 			t->setCurrentClipIndexAudio( i );
+			if ( audioMixed )
+				resyncAudioInput( c );
 			if ( !(in = c->getInput()) )
 				in = getClipInput( c, currentScene->currentPTSAudio );
 			f = in->getAudioFrame( nSamples );
@@ -768,6 +1033,8 @@ void Sampler::getAudioTracks( Frame *dst, int nSamples )
 				Clip *ct = playBackward ? t->clipAt( i - 1 ) : t->clipAt( i + 1 );
 				Transition *trans = playBackward ? c->getTransition() : ct->getTransition();
 				if ( trans && (ct->position() - margin) <= currentScene->currentPTSAudio && (ct->position() + ct->length() - margin) > currentScene->currentPTSAudio ) {
+					if ( audioMixed )
+						resyncAudioInput( ct );
 					if ( !(in = ct->getInput()) )
 						in = getClipInput( ct, currentScene->currentPTSAudio );
 					f = in->getAudioFrame( nSamples );
@@ -794,18 +1061,31 @@ void Sampler::getAudioTracks( Frame *dst, int nSamples )
 		}
 	}
 	
+	audioMixed = mixed != NULL;
 	currentScene->update = false;
 }
 
 
 
+// Live mixing takes over the mixdown, the audio of the input
+// has not been read and is seeked to the playhead.
+void Sampler::resyncAudioInput( Clip *c )
+{
+	if ( !c->getInput() )
+		return;
+	c->setInput( NULL );
+	getClipInput( c, currentScene->currentPTSAudio );
+}
+
+
+
 void Sampler::updateAudioFrame( Frame *dst )
 {
 	int i, j;
 	Clip *c = NULL;
 	double margin = currentScene->getProfile().getVideoFrameDuration() / 4.0;
 	
-	if ( !dst->sample )
+	if ( !dst->sample || dst->sample->mixdown )
 		return;
 
 	QMutexLocker ml( &currentScene->mutex );
@@ -865,6 +1145,8 @@ void Sampler::prepareInputs()
 	InputBase *in = NULL;
 	double minPTS, maxPTS;
 	double margin = currentScene->getProfile().getVideoFrameDuration() / 4.0;
+	double vpts = bufferedPlaybackPts != -1 ? bufferedPlaybackPts : currentScene->currentPTS;
+	double shuttle = previewSpeed();
 
 	if ( bufferedPlaybackPts != -1 )
 		minPTS = maxPTS = bufferedPlaybackPts;
@@ -877,6 +1159,7 @@ void Sampler::prepareInputs()
 		maxPTS = currentScene->currentPTS;
 	}
 	
+	updateWarmUpCosts();
 	QMutexLocker ml( &currentScene->mutex );
 
 	for ( j = 0; j < currentScene->tracks.count(); ++j ) {
@@ -894,13 +1177,33 @@ void Sampler::prepareInputs()
 			if ( (c->position() + c->length()) < minPTS - margin ) {
 				c->setInput( NULL );
 			}
-			else if ( c->position() <= (maxPTS + FORWARDLOOKUP) ) {
+			else if ( c->position() <= (maxPTS + MAXFORWARDLOOKUP) ) {
+				// slow sources are opened earlier
+				double lookup = clipLookup( c );
+				if ( c->position() > maxPTS + lookup )
+					continue;
+				// audio only clips are not needed where the audio is premixed
+				if ( !c->getProfile().hasVideo() && currentScene == timelineScene && !metronom->isRenderMode()
+					&& mixdown->covers( qMax( c->position(), minPTS ), qMin( c->position() + c->length(), maxPTS + lookup ) ) )
+					continue;
+				// video hidden by upper tracks is not decoded
+				double visible = 0;
+				bool hideable = canHideClip( c );
+				if ( hideable ) {
+					double from = qMax( c->position(), vpts );
+					visible = firstVisiblePts( j, from, qMin( c->position() + c->length(), maxPTS + lookup ), margin );
+					if ( visible < 0 && !c->getInput() && !c->getProfile().hasAudio() )
+						continue;
+				}
 				//if ( inputs.count() >= MAXINPUTS )
 					//break;
 				if ( !(in = c->getInput()) ) {
 					in = getClipInput( c, minPTS );
 					//break;
 				}
+				if ( hideable )
+					updateHiddenClip( c, in, visible, qMax( c->position(), vpts ), margin );
+				in->setPreviewSpeed( shuttle );
 			}
 			else
 				break;
@@ -933,6 +1236,7 @@ void Sampler::prepareInputsBackward()
 		maxPTS = currentScene->currentPTS;
 	}
 	
+	updateWarmUpCosts();
 	QMutexLocker ml( &currentScene->mutex );
 
 	for ( j = 0; j < currentScene->tracks.count(); ++j ) {
@@ -950,7 +1254,9 @@ void Sampler::prepareInputsBackward()
 			if ( c->position() > maxPTS + margin ) {
 				c->setInput( NULL );
 			}
-			else if ( (c->position() + c->length()) >= (minPTS - FORWARDLOOKUP) ) {
+			else if ( (c->position() + c->length()) >= (minPTS - MAXFORWARDLOOKUP) ) {
+				if ( (c->position() + c->length()) < minPTS - clipLookup( c ) )
+					continue;
 				//if ( inputs.count() >= MAXINPUTS )
 					//break;
 				if ( !(in = c->getInput()) ) {
@@ -1,12 +1,15 @@
 #ifndef SAMPLER_H
 #define SAMPLER_H
 
+#include <QHash>
+
 #include "input/input_ff.h"
 #include "input/input_image.h"
 #include "input/input_blank.h"
 
 #include "engine/scene.h"
 #include "engine/metronom.h"
+#include "engine/audiomixdown.h"
 
 
 
@@ -34,6 +37,8 @@ public:
 	void rewardPTS();
 	
 	void setOutputResize( QSize size );
+	// no proxies and no premixed audio
+	void setRenderMode( bool b );
 	
 	void newProject( Profile p );
 	bool setProfile( Profile p );
@@ -48,9 +53,12 @@ public:
 	Scene* getCurrentScene() { return timelineScene; }
 	void setSceneList( QList<Scene*> list );
 	bool previewMode() { return currentScene == preview; }
+	// the scene being played and its edit generation, changed by any edit
+	Scene* getActiveScene() { return currentScene; }
+	qint64 getEditGeneration() { return ((qint64)updateGeneration << 32) | (quint32)currentScene->editGeneration; }
 	
 	// called from composer thread
-	void fromComposerSeekTo( double p, bool backward = false, bool seek = true );
+	void fromComposerSeekTo( double p, bool backward = false, bool seek = true, int mode = InputBase::SeekExact );
 	double fromComposerSetPlaybackBuffer( bool backward );
 	bool fromComposerUpdateFrame( Frame *f );
 	void fromComposerReleaseVideoFrame( Frame *f );
@@ -58,6 +66,7 @@ public:
 public slots:
 	void setSharedContext( QGLWidget *shared );
 	void setFencesContext( QGLWidget *shared );
+	void setPreviewSize( QSize size );
 	void switchMode( bool down );
 	void setSource( Source *source, double pts );
 	void wheelSeek( int a );
@@ -66,6 +75,7 @@ public slots:
 
 private:
 	void drainScenes();
+	void startMixdown();
 	void stopComposer();
 	Clip* searchCurrentClip( int &i, Track *t, int clipIndex, double pts, double margin );
 	void prepareInputsBackward();
@@ -73,20 +83,45 @@ private:
 	int updateVideoFrame( Frame *dst );
 	void updateAudioFrame( Frame *dst );
 	InputBase* getInput( QString fn, InputBase::InputType type );
+	void updateWarmUpCosts();
+	double clipLookup( Clip *c );
 	InputBase* getClipInput( Clip *c, double pts );
+	double clipSourcePts( Clip *c, double pts );
+	double previewSpeed();
+	void resyncAudioInput( Clip *c );
+	bool canHideClip( Clip *c );
+	bool clipOccludes( Track *t, int i, double pts, double margin );
+	bool trackHidden( int track, double pts, double margin );
+	double firstVisiblePts( int track, double from, double to, double margin );
+	void updateHiddenClip( Clip *c, InputBase *in, double visible, double from, double margin );
 
 	QList<Scene*> sceneList;
 	Scene *timelineScene;
 	Scene *preview;
 	Scene *currentScene;
+	// least recently used first
 	QList<InputBase*> inputs;
+	// per source, the time needed to open and seek
+	QHash<QString, double> warmUpCosts;
+	// sources known to give opaque and not rotated frames
+	QHash<QString, bool> opaqueSources;
+	// clips whose video is not decoded while hidden by upper tracks,
+	// with the pts where decoding resumes or -1
+	QHash<Clip*, double> hiddenClips;
 
 	bool playBackward;
+	// incremented by updateFrame and project changes
+	int updateGeneration;
+	// InputBase::SeekMode of the inputs opened after the last seek
+	int seekMode;
 	PlaybackBuffer playbackBuffer;
 	double bufferedPlaybackPts;
+	// the last audio frame was premixed, clip inputs were left behind
+	bool audioMixed;
 	
 	Metronom *metronom;
 	Composer *composer;
+	AudioMixdown *mixdown;
 
 signals:
 	void modeSwitched();
@@ -6,6 +6,7 @@
 
 Scene::Scene( Profile p )
 	: update( true ),
+	editGeneration( 0 ),
 	currentPTS( 0 ),
 	currentPTSAudio( 0 ),
 	profile( p )
@@ -25,6 +26,7 @@ Scene::~Scene()
 
 bool Scene::setProfile( Profile &p )
 {
+	++editGeneration;
 	bool ok = true;
 	double duration = profile.getVideoFrameDuration();
 	profile = p;
@@ -140,6 +142,7 @@ bool Scene::canSplitClip(Clip *clip, int track, double pts)
 
 Clip* Scene::sceneSplitClip( Clip *clip, int track, double pts )
 {
+	++editGeneration;
 	pts = nearestPTS( pts, profile.getVideoFrameDuration() );
 	
 	double start = clip->position();
@@ -239,6 +242,7 @@ bool Scene::effectCanMove( Clip *clip, double &newPos, bool isVideo, int index )
 
 void Scene::effectMove( Clip *clip, double newPos, bool isVideo, int index )
 {
+	++editGeneration;
 	QSharedPointer<Filter> f;
 	if ( isVideo )
 		f = clip->videoFilters.at( index );
@@ -277,6 +281,7 @@ bool Scene::effectCanResizeStart( Clip *clip, double &newPos, double endPos, boo
 
 void Scene::effectResizeStart( Clip *clip, double newPos, double newLength, bool isVideo, int index )
 {
+	++editGeneration;
 	QSharedPointer<Filter> f;
 	if ( isVideo )
 		f = clip->videoFilters.at( index );
@@ -318,6 +323,7 @@ bool Scene::effectCanResize( Clip *clip, double &newLength, bool isVideo, int in
 
 void Scene::effectResize( Clip *clip, double newLength, bool isVideo, int index )
 {
+	++editGeneration;
 	QSharedPointer<Filter> f;
 	if ( isVideo )
 		f = clip->videoFilters.at( index );
@@ -358,6 +364,7 @@ bool Scene::canResizeStart( Clip *clip, double &newPos, double endPos, int track
 	
 void Scene::resizeStart( Clip *clip, double newPos, double newLength, int track )
 {
+	++editGeneration;
 	QMutexLocker ml( &mutex );
 	
 	if ( clip->position() == newPos && clip->length() == newLength )
@@ -422,6 +429,7 @@ bool Scene::canResize( Clip *clip, double &newLength, int track )
 	
 void Scene::resize( Clip *clip, double newLength, int track )
 {
+	++editGeneration;
 	QMutexLocker ml( &mutex );
 	
 	if ( clip->length() == newLength )
@@ -450,6 +458,7 @@ bool Scene::canMove( Clip *clip, double clipLength, double &newPos, int newTrack
 
 void Scene::move( Clip *clip, int clipTrack, double newPos, int newTrack )
 {
+	++editGeneration;
 	QMutexLocker ml( &mutex );
 	
 	if ( clip->position() == newPos && clipTrack == newTrack )
@@ -540,6 +549,7 @@ bool Scene::canMoveMulti( Clip *clip, double clipLength, double &newPos, int tra
 
 void Scene::moveMulti( Clip *clip, int clipTrack, double newPos )
 {
+	++editGeneration;
 	QMutexLocker ml( &mutex );
 	
 	if ( clip->position() == newPos )
@@ -794,6 +804,7 @@ double Scene::previousEdge(double pts)
 	
 void Scene::addClip( Clip *clip, int track )
 {
+	++editGeneration;
 	QMutexLocker ml( &mutex );
 	double margin = profile.getVideoFrameDuration() / 4.0;
 	Track *t = tracks[track];
@@ -816,6 +827,7 @@ void Scene::addClip( Clip *clip, int track )
 	
 bool Scene::removeClip( Clip *clip )
 {
+	++editGeneration;
 	QMutexLocker ml( &mutex );
 	int i, j;
 	for ( i = 0; i < tracks.count(); ++i ) {
@@ -867,6 +879,7 @@ Clip* Scene::getTailClip(Clip *clip, int track)
 
 void Scene::drain()
 {
+	++editGeneration;
 	QMutexLocker ml( &mutex );
 	for ( int i = 0; i < tracks.count(); ++i ) {
 		Track *t = tracks[ i ];
@@ -881,6 +894,7 @@ void Scene::drain()
 
 bool Scene::removeTrack( int index )
 {
+	++editGeneration;
 	if ( index < 0 || index >= tracks.count() )
 		return false;
 	
@@ -895,6 +909,7 @@ bool Scene::removeTrack( int index )
 
 bool Scene::addTrack( int index )
 {
+	++editGeneration;
 	if ( index < 0 || index > tracks.count() )
 		return false;
 	
@@ -52,6 +52,8 @@ public:
 	double previousEdge(double pts);
 
 	bool update;
+	// incremented by any edit, see ComposedFrameCache
+	int editGeneration;
 	QList<Track*> tracks;
 	double currentPTS, currentPTSAudio;
 	QMutex mutex;
@@ -0,0 +1,219 @@
+#include <QDebug>
+#include <QFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+
+#include "util.h"
+#include "shadercache.h"
+
+#define SHADER_DIR "shaders"
+#define SHADER_EXTENSION ".bin"
+// identity of the driver that made the binaries
+#define SHADER_DRIVERFILE "driver"
+
+
+
+static ShaderCache globalShaderCache;
+
+
+
+ShaderCache* ShaderCache::globalInstance()
+{
+	return &globalShaderCache;
+}
+
+
+
+ShaderCache::ShaderCache()
+	: initialized( false ),
+	enabled( false )
+{
+}
+
+
+
+bool ShaderCache::cdShaderDir( QDir &d )
+{
+	d = QDir::home();
+	if ( !d.cd( MACHINTRUC_DIR ) ) {
+		if ( !d.mkdir( MACHINTRUC_DIR ) ) {
+			qDebug() << "Can't create" << MACHINTRUC_DIR << "directory.";
+			return false;
+		}
+		if ( !d.cd( MACHINTRUC_DIR ) )
+			return false;
+	}
+	if ( !d.cd( SHADER_DIR ) ) {
+		if ( !d.mkdir( SHADER_DIR ) ) {
+			qDebug() << "Can't create" << SHADER_DIR << "directory.";
+			return false;
+		}
+		if ( !d.cd( SHADER_DIR ) )
+			return false;
+	}
+
+	return true;
+}
+
+
+
+bool ShaderCache::init()
+{
+	initialized = true;
+
+	GLint formats = 0;
+	glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formats );
+	if ( formats < 1 || !cdShaderDir( dir ) )
+		return false;
+
+	driver = QByteArray( (const char*)glGetString( GL_VENDOR ) ) + "\n"
+		+ QByteArray( (const char*)glGetString( GL_RENDERER ) ) + "\n"
+		+ QByteArray( (const char*)glGetString( GL_VERSION ) ) + "\n"
+		+ QByteArray( (const char*)glGetString( GL_SHADING_LANGUAGE_VERSION ) ) + "\n";
+
+	// binaries of another driver would be rejected anyway
+	QFile f( dir.filePath( SHADER_DRIVERFILE ) );
+	if ( f.open( QIODevice::ReadOnly ) ) {
+		QByteArray old = f.readAll();
+		f.close();
+		if ( old == driver )
+			return true;
+	}
+	QStringList bins = dir.entryList( QStringList( QString( "*" ) + SHADER_EXTENSION ), QDir::Files );
+	for ( int i = 0; i < bins.count(); ++i )
+		dir.remove( bins[i] );
+	if ( !f.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+		return false;
+	f.write( driver );
+	f.close();
+
+	return true;
+}
+
+
+
+GLuint ShaderCache::getProgram( const QByteArray &vertex, const QByteArray &fragment, QString *log )
+{
+	QMutexLocker ml( &mutex );
+	if ( !initialized )
+		enabled = init();
+
+	QString path;
+	if ( enabled ) {
+		QByteArray key = driver + vertex + '\0' + fragment;
+		path = dir.filePath( QCryptographicHash::hash( key, QCryptographicHash::Sha256 ).toHex() + SHADER_EXTENSION );
+		GLuint program = loadProgram( path );
+		if ( program )
+			return program;
+	}
+
+	GLuint vs = compileShader( GL_VERTEX_SHADER, vertex, log );
+	GLuint fs = vs ? compileShader( GL_FRAGMENT_SHADER, fragment, log ) : 0;
+	GLuint program = 0;
+	if ( vs && fs ) {
+		program = glCreateProgram();
+		glAttachShader( program, vs );
+		glAttachShader( program, fs );
+		if ( enabled )
+			glProgramParameteri( program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+		glLinkProgram( program );
+		GLint ok;
+		glGetProgramiv( program, GL_LINK_STATUS, &ok );
+		if ( !ok ) {
+			if ( log ) {
+				char s[4096];
+				glGetProgramInfoLog( program, sizeof( s ), NULL, s );
+				*log = s;
+			}
+			glDeleteProgram( program );
+			program = 0;
+		}
+		else if ( enabled )
+			saveProgram( program, path );
+	}
+	if ( vs )
+		glDeleteShader( vs );
+	if ( fs )
+		glDeleteShader( fs );
+
+	return program;
+}
+
+
+
+GLuint ShaderCache::compileShader( GLenum type, const QByteArray &src, QString *log )
+{
+	GLuint shader = glCreateShader( type );
+	const char *data = src.constData();
+	GLint len = src.size();
+	glShaderSource( shader, 1, &data, &len );
+	glCompileShader( shader );
+	GLint ok;
+	glGetShaderiv( shader, GL_COMPILE_STATUS, &ok );
+	if ( !ok ) {
+		if ( log ) {
+			char s[4096];
+			glGetShaderInfoLog( shader, sizeof( s ), NULL, s );
+			*log = s;
+		}
+		glDeleteShader( shader );
+		return 0;
+	}
+	return shader;
+}
+
+
+
+GLuint ShaderCache::loadProgram( const QString &path )
+{
+	QFile f( path );
+	if ( !f.open( QIODevice::ReadOnly ) )
+		return 0;
+	QDataStream ds( &f );
+	QByteArray drv, bin;
+	quint32 format;
+	ds >> drv >> format >> bin;
+	f.close();
+	if ( ds.status() != QDataStream::Ok || drv != driver || bin.isEmpty() ) {
+		QFile::remove( path );
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary( program, format, bin.constData(), bin.size() );
+	GLint ok;
+	glGetProgramiv( program, GL_LINK_STATUS, &ok );
+	if ( !ok ) {
+		// the driver was updated without changing its version string
+		glDeleteProgram( program );
+		QFile::remove( path );
+		return 0;
+	}
+	return program;
+}
+
+
+
+void ShaderCache::saveProgram( GLuint program, const QString &path )
+{
+	GLint len = 0;
+	glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &len );
+	if ( len < 1 )
+		return;
+	QByteArray bin( len, 0 );
+	GLenum format;
+	glGetProgramBinary( program, len, &len, &format, bin.data() );
+	bin.resize( len );
+
+	// renamed when complete, so that other instances never read partial files
+	QString partName = path + ".part";
+	QFile f( partName );
+	if ( !f.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+		return;
+	QDataStream ds( &f );
+	ds << driver << (quint32)format << bin;
+	f.close();
+	QFile::remove( path );
+	if ( ds.status() != QDataStream::Ok || !QFile::rename( partName, path ) )
+		QFile::remove( partName );
+}
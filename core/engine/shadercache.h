@@ -0,0 +1,41 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#define GL_GLEXT_PROTOTYPES
+
+#include <movit/effect_chain.h>
+
+#include <QDir>
+#include <QMutex>
+
+
+
+// Linked program binaries, stored on disk and keyed by the sources and
+// the driver identity. A new driver clears the cache, a binary rejected
+// by the driver is compiled again.
+// Needs GL 4.1 or ARB_get_program_binary, else programs are just compiled.
+class ShaderCache
+{
+public:
+	ShaderCache();
+
+	// A linked program, to be deleted by the caller. 0 on error,
+	// with the info log in log. The GL context must be current.
+	GLuint getProgram( const QByteArray &vertex, const QByteArray &fragment, QString *log = NULL );
+
+	static ShaderCache* globalInstance();
+
+private:
+	bool init();
+	bool cdShaderDir( QDir &dir );
+	GLuint loadProgram( const QString &path );
+	void saveProgram( GLuint program, const QString &path );
+	GLuint compileShader( GLenum type, const QByteArray &src, QString *log );
+
+	QMutex mutex;
+	bool initialized, enabled;
+	QByteArray driver;
+	QDir dir;
+};
+
+#endif // SHADERCACHE_H
@@ -8,6 +8,7 @@ Source::Source( InputBase::InputType t, QString path, Profile prof )
 	: fileName( path ),
 	profile( prof ),
 	type( t ),
+	useProxy( false ),
 	refcount( 1 )
 {
 	size = QFileInfo( path ).size();
@@ -18,6 +19,7 @@ Source::Source( InputBase::InputType t, QString path, Profile prof )
 Source::Source( QString path )
 	: fileName( path ),
 	type( InputBase::UNDEF ),
+	useProxy( false ),
 	refcount( 1 )
 {
 	size = QFileInfo( path ).size();
@@ -25,12 +25,16 @@ public:
 	FList< QSharedPointer<AudioFilter> > audioFilters;
 	
 	void setAfter( InputBase::InputType t, Profile prof );
+	// preview plays the proxy, when ready
+	void setUseProxy( bool b ) { useProxy = b; }
+	bool getUseProxy() const { return useProxy; }
 
 private:
 	QString fileName;
 	qint64 size;
 	Profile profile;
 	InputBase::InputType type;
+	bool useProxy;
 	
 	// HACK for glstabilize
 	int refcount;
@@ -287,6 +287,7 @@ void StabMotionDetect::run()
 	}
 
 	InputFF *input = new InputFF();
+	input->setStreamMask( InputBase::VideoStream );
 	if ( !input->open( source->getFileName() ) ) {
 		delete input;
 		return;
@@ -324,7 +325,6 @@ void StabMotionDetect::run()
 	vsTransformDataInit( &data, &config, &fi_src, &fi_dst );
 	vsTransformationsInit( &trans );
 	
-	int nSamples = sourceProfile.getAudioSampleRate() * outProfile.getVideoFrameDuration() / MICROSECOND;
 	double startPts = sourceProfile.getStreamStartTime();
 	double endPts = sourceProfile.getStreamStartTime() + sourceProfile.getStreamDuration();
 	
@@ -348,9 +348,6 @@ void StabMotionDetect::run()
 		vs_vector_del( &localmotions );
 
 		delete f;
-		// consume audio
-		if ( (f = input->getAudioFrame( nSamples )) )
-			delete f;
 		f = NULL;
 		
 		if ( !finishedSuccess )
@@ -7,7 +7,6 @@
 #include "vfx/movitflip.h"
 #include "vfx/movitbackground.h"
 
-#include <QGLShaderProgram>
 #include <QGLFramebufferObject>
 #include <QCryptographicHash>
 
@@ -15,6 +14,7 @@
 #include "input/input_image.h"
 #include "input/input_blank.h"
 #include "engine/source.h"
+#include "engine/shadercache.h"
 #include "util.h"
 #include "thumbnailer.h"
 
@@ -25,7 +25,8 @@
 
 Thumbnailer::Thumbnailer()
 	: running( false ),
-	glContext( NULL )
+	glContext( NULL ),
+	movitPool( NULL )
 {
 }
 
@@ -114,6 +115,8 @@ void Thumbnailer::gotResult()
 void Thumbnailer::run()
 {
 	glContext->makeCurrent();
+	// shared by all thumbnails, so that their programs are linked once
+	movitPool = new ResourcePool();
 	
 	while ( running ) {
 		requestMutex.lock();
@@ -142,6 +145,8 @@ void Thumbnailer::run()
 		}
 	}
 	
+	delete movitPool;
+	movitPool = NULL;
 	glContext->doneCurrent();
 #if QT_VERSION >= 0x050000
 	glContext->context()->moveToThread( qApp->thread() );
@@ -228,6 +233,7 @@ void Thumbnailer::makeThumb( ThumbRequest &request )
 		input = new InputFF();
 	
 	input->setProfile( request.profile, request.profile );
+	input->setStreamMask( InputBase::VideoStream );
 	input->open( request.filePath );
 	
 	if ( request.profile.hasVideo() ) {
@@ -302,20 +308,18 @@ void Thumbnailer::compileShader( ThumbRequest &request )
 	shader += "\n";
 	shader += read_file( "footer.frag" ).c_str();
 	
-	QGLShaderProgram prog;
-	bool ok = prog.addShaderFromSourceCode( QGLShader::Fragment, shader )
-		&& prog.addShaderFromSourceCode( QGLShader::Vertex, read_version_dependent_file("vs", "vert").c_str());
-	if ( ok )
-		ok = prog.link();
-	if ( ok ) {
+	QString log;
+	GLuint prog = ShaderCache::globalInstance()->getProgram( read_version_dependent_file("vs", "vert").c_str(), shader.toUtf8(), &log );
+	if ( prog ) {
+		glDeleteProgram( prog );
 		// be strict, treat warning as error
 		/*if ( prog.log().contains( "Warning" ) || prog.log().contains( "warning" ) )
-			request.filePath = "nok" + prog.log();
+			request.filePath = "nok" + log;
 		else*/
 			request.filePath = "ok";
 	}
 	else {
-		request.filePath = "nok" + prog.log();
+		request.filePath = "nok" + log;
 	}
 }
 
@@ -328,7 +332,7 @@ QImage Thumbnailer::getSourceThumb( Frame *f, bool border )
 
 	MovitChain *movitChain = new MovitChain();
 	double ar = f->profile.getVideoSAR() * f->profile.getVideoWidth() / f->profile.getVideoHeight();
-	movitChain->chain = new EffectChain( ar, 1.0 );
+	movitChain->chain = new EffectChain( ar, 1.0, movitPool );
 	MovitInput *in = new MovitInput();
 	MovitBranch *branch = new MovitBranch( in );
 	movitChain->branches.append( branch );
@@ -17,6 +17,10 @@ class Source;
 class Frame;
 class QGLWidget;
 
+namespace movit {
+class ResourcePool;
+}
+
 
 
 class ThumbRequest
@@ -88,6 +92,7 @@ private:
 	QMutex requestMutex, resultMutex;
 	bool running;
 	QGLWidget *glContext;
+	movit::ResourcePool *movitPool;
 	
 signals:
 	void resultReady();
@@ -0,0 +1,513 @@
+#include <sys/resource.h>
+#include <math.h>
+
+#include <QDebug>
+#include <QFile>
+#include <QCryptographicHash>
+#include <QDataStream>
+
+#include "util.h"
+#include "input/ffdecoder.h"
+#include "waveformcollection.h"
+
+#define WAVEFORM_DIR "wave"
+#define WAVEFORM_EXTENSION ".peaks"
+#define WAVEFORM_MAGIC 0x4d545746
+#define WAVEFORM_VERSION 1
+
+
+
+static WaveformPeak makePeak( float mn, float mx, double meanSquare )
+{
+	WaveformPeak p;
+	p.min = qMax( -1.0f, qMin( mn, 1.0f ) ) * 32767;
+	p.max = qMax( -1.0f, qMin( mx, 1.0f ) ) * 32767;
+	p.rms = qMin( sqrt( meanSquare ), 1.0 ) * 32767;
+	return p;
+}
+
+
+
+WaveformCollection WaveformCollection::globalInstance = WaveformCollection();
+
+
+
+WaveformCollection* WaveformCollection::getGlobalInstance()
+{
+	return &globalInstance;
+}
+
+
+
+WaveformCollection::WaveformCollection() : QObject()
+{
+	connect( &checkBuilderTimer, SIGNAL(timeout()), this, SLOT(checkBuilderThreads()) );
+}
+
+
+
+WaveformCollection::~WaveformCollection()
+{
+	while ( !builders.isEmpty() )
+		delete builders.takeFirst();
+	while ( !waveItems.isEmpty() )
+		delete waveItems.takeFirst();
+}
+
+
+
+bool WaveformCollection::cdWaveformDir( QDir &dir )
+{
+	dir = QDir::home();
+	if ( !dir.cd( MACHINTRUC_DIR ) ) {
+		if ( !dir.mkdir( MACHINTRUC_DIR ) ) {
+			qDebug() << "Can't create" << MACHINTRUC_DIR << "directory.";
+			return false;
+		}
+		if ( !dir.cd( MACHINTRUC_DIR ) )
+			return false;
+	}
+	if ( !dir.cd( WAVEFORM_DIR ) ) {
+		if ( !dir.mkdir( WAVEFORM_DIR ) ) {
+			qDebug() << "Can't create" << WAVEFORM_DIR << "directory.";
+			return false;
+		}
+		if ( !dir.cd( WAVEFORM_DIR ) )
+			return false;
+	}
+
+	return true;
+}
+
+
+
+QString WaveformCollection::pathToFileName( QString path )
+{
+	return QCryptographicHash::hash( path.toUtf8(), QCryptographicHash::Sha256 ).toHex();
+}
+
+
+
+void WaveformCollection::checkBuilderThreads()
+{
+	int working = 0;
+
+	for ( int i = 0; i < builders.count(); ++i ) {
+		WaveformBuilder *builder = builders.at( i );
+		if ( builder->getStarted() ) {
+			if ( !builder->isRunning() ) {
+				QString fn = builder->getFileName();
+				bool ok = builder->getFinishedSuccess();
+				builders.takeAt( i-- );
+				delete builder;
+				if ( ok )
+					emit waveformReady( fn );
+				else
+					waveErrors.append( fn );
+			}
+			else {
+				++working;
+			}
+		}
+	}
+
+	for ( int i = 0; i < builders.count(); ++i ) {
+		if ( working > 1 )
+			break;
+		WaveformBuilder *builder = builders.at( i );
+		if ( !builder->getStarted() ) {
+			builder->go();
+			++working;
+		}
+	}
+
+	if ( !builders.count() )
+		checkBuilderTimer.stop();
+}
+
+
+
+Waveform* WaveformCollection::getWaveform( Source *source, int &status, int &progress )
+{
+	QString fn = source->getFileName();
+
+	foreach( Waveform *it, waveItems ) {
+		if ( it->getSourceName() == fn ) {
+			it->use();
+			status = WaveformPeak::WAVEREADY;
+			return it;
+		}
+	}
+
+	if ( waveErrors.contains( fn ) || !source->getProfile().hasAudio() ) {
+		status = WaveformPeak::WAVEERROR;
+		return NULL;
+	}
+
+	// before looking at the disk, this is asked on each paint while building
+	for ( int i = 0; i < builders.count(); ++i ) {
+		WaveformBuilder *builder = builders.at( i );
+		if ( builder->getFileName() == fn ) {
+			if ( builder->getStarted() ) {
+				status = WaveformPeak::WAVEINPROGRESS;
+				progress = builder->getProgress();
+			}
+			else {
+				status = WaveformPeak::WAVEENQUEUED;
+			}
+			return NULL;
+		}
+	}
+
+	QDir dir;
+	if ( !cdWaveformDir( dir ) ) {
+		status = WaveformPeak::WAVEERROR;
+		return NULL;
+	}
+
+	QString path = dir.filePath( pathToFileName( fn ) + WAVEFORM_EXTENSION );
+	if ( QFile::exists( path ) ) {
+		Waveform *wave = new Waveform( fn, path );
+		if ( wave->load() ) {
+			waveItems.append( wave );
+			wave->use();
+			status = WaveformPeak::WAVEREADY;
+			return wave;
+		}
+		// corrupted, build it again
+		delete wave;
+		QFile::remove( path );
+	}
+
+	builders.append( new WaveformBuilder( source ) );
+	if ( !checkBuilderTimer.isActive() )
+		checkBuilderTimer.start( 1000 );
+
+	status = WaveformPeak::WAVEENQUEUED;
+	return NULL;
+}
+
+
+
+void WaveformCollection::releaseWaveform( Waveform *wave )
+{
+	for( int i = 0; i < waveItems.count(); ++i ) {
+		Waveform *it = waveItems.at( i );
+		if ( it == wave ) {
+			if ( it->release() )
+				delete waveItems.takeAt( i );
+			break;
+		}
+	}
+}
+
+
+
+Waveform::Waveform( QString fileName, QString cacheFile )
+	: sourceName( fileName ),
+	cachePath( cacheFile ),
+	sampleRate( 0 ),
+	startTime( 0 ),
+	refcount( 0 )
+{
+}
+
+
+
+Waveform::~Waveform()
+{
+	while ( !levels.isEmpty() ) {
+		QVector<WaveformPeak> *v = levels.takeFirst();
+		if ( v )
+			delete v;
+	}
+}
+
+
+
+bool Waveform::load()
+{
+	QFile f( cachePath );
+	if ( !f.open( QIODevice::ReadOnly ) )
+		return false;
+
+	QDataStream data( &f );
+	quint32 magic;
+	qint32 version, rate, nLevels;
+	data >> magic >> version >> rate >> startTime >> nLevels;
+	if ( data.status() != QDataStream::Ok || magic != WAVEFORM_MAGIC || version != WAVEFORM_VERSION
+		|| rate <= 0 || nLevels < 1 || nLevels > WAVEFORMMAXLEVELS )
+	{
+		f.close();
+		return false;
+	}
+
+	sampleRate = rate;
+	for ( int i = 0; i < nLevels; ++i ) {
+		qint32 count;
+		qint64 offset;
+		data >> count >> offset;
+		if ( data.status() != QDataStream::Ok || count < 1 || offset + (qint64)count * 3 * sizeof(qint16) > f.size() ) {
+			f.close();
+			levelCounts.clear();
+			levelOffsets.clear();
+			return false;
+		}
+		levelCounts.append( count );
+		levelOffsets.append( offset );
+		levels.append( NULL );
+	}
+	f.close();
+
+	return true;
+}
+
+
+
+double Waveform::binDuration( int level )
+{
+	return (double)WAVEFORMBASEBIN * (1 << level) * MICROSECOND / sampleRate;
+}
+
+
+
+int Waveform::levelFor( double duration )
+{
+	int level = 0;
+	while ( level < levelCount() - 1 && binDuration( level + 1 ) <= duration )
+		++level;
+	return level;
+}
+
+
+
+QVector<WaveformPeak>* Waveform::getLevel( int level )
+{
+	if ( level < 0 || level >= levels.count() )
+		return NULL;
+	if ( levels[level] )
+		return levels[level];
+
+	QFile f( cachePath );
+	if ( !f.open( QIODevice::ReadOnly ) || !f.seek( levelOffsets[level] ) )
+		return NULL;
+
+	QVector<WaveformPeak> *v = new QVector<WaveformPeak>( levelCounts[level] );
+	QDataStream data( &f );
+	for ( int i = 0; i < v->count(); ++i ) {
+		WaveformPeak &p = (*v)[i];
+		data >> p.min >> p.max >> p.rms;
+	}
+	f.close();
+
+	if ( data.status() != QDataStream::Ok ) {
+		delete v;
+		return NULL;
+	}
+
+	levels[level] = v;
+	return v;
+}
+
+
+
+bool Waveform::getPeak( double from, double duration, WaveformPeak &peak )
+{
+	QMutexLocker ml( &mutex );
+
+	int level = levelFor( duration );
+	QVector<WaveformPeak> *v = getLevel( level );
+	if ( !v )
+		return false;
+
+	double bd = binDuration( level );
+	int i0 = floor( (from - startTime) / bd );
+	int i1 = floor( (from + duration - startTime) / bd );
+	if ( i1 <= i0 )
+		i1 = i0 + 1;
+	if ( i1 <= 0 || i0 >= v->count() )
+		return false;
+	i0 = qMax( 0, i0 );
+	i1 = qMin( i1, v->count() );
+
+	qint16 mn = 32767, mx = -32767;
+	double sq = 0;
+	for ( int i = i0; i < i1; ++i ) {
+		const WaveformPeak &p = v->at( i );
+		mn = qMin( mn, p.min );
+		mx = qMax( mx, p.max );
+		sq += (double)p.rms * p.rms;
+	}
+	peak.min = mn;
+	peak.max = mx;
+	peak.rms = sqrt( sq / (i1 - i0) );
+
+	return true;
+}
+
+
+
+WaveformBuilder::WaveformBuilder( Source *aSource )
+	: progress( 0 ),
+	started( false ),
+	finishedSuccess( false ),
+	running( false ),
+	fileName( aSource->getFileName() ),
+	profile( aSource->getProfile() )
+{
+}
+
+
+
+WaveformBuilder::~WaveformBuilder()
+{
+	stop();
+}
+
+
+
+void WaveformBuilder::go()
+{
+	if ( isRunning() )
+		return;
+	running = true;
+	start( QThread::LowestPriority );
+	started = true;
+}
+
+
+
+void WaveformBuilder::stop()
+{
+	running = false;
+	wait();
+}
+
+
+
+void WaveformBuilder::run()
+{
+	setpriority( PRIO_PROCESS, 0, 19 );
+
+	// decode audio only, as float stereo at source rate
+	Profile outProfile = profile;
+	outProfile.setHasVideo( false );
+	outProfile.setAudioFormat( Profile::SAMPLE_FMT_32F );
+	outProfile.setAudioLayout( Profile::LAYOUT_STEREO );
+	outProfile.setAudioChannels( 2 );
+
+	FFDecoder *decoder = new FFDecoder();
+	decoder->setProfile( profile, outProfile );
+	if ( !decoder->open( fileName ) || !decoder->haveAudio ) {
+		delete decoder;
+		return;
+	}
+
+	int channels = outProfile.getAudioChannels();
+	AudioFrame af( sizeof(float) * channels, outProfile.getAudioSampleRate() );
+	double startPts = profile.getStreamStartTime();
+	double duration = qMax( 1.0, profile.getStreamDuration() );
+	double firstPts = 0;
+	bool first = true;
+
+	QVector<WaveformPeak> base;
+	float bmin = 1.0f, bmax = -1.0f;
+	double bsq = 0;
+	int bn = 0;
+	bool more = true;
+
+	while ( running && more ) {
+		af.available = 0;
+		more = decoder->decodeAudio( &af );
+		if ( af.available < 1 )
+			continue;
+		if ( first ) {
+			firstPts = af.bufPts;
+			first = false;
+		}
+		float *s = (float*)(af.buffer->data() + af.bufOffset);
+		for ( int i = 0; i < af.available; ++i ) {
+			for ( int c = 0; c < channels; ++c ) {
+				float v = *s++;
+				bmin = qMin( bmin, v );
+				bmax = qMax( bmax, v );
+				bsq += v * v;
+			}
+			if ( ++bn == WAVEFORMBASEBIN ) {
+				base.append( makePeak( bmin, bmax, bsq / (bn * channels) ) );
+				bmin = 1.0f;
+				bmax = -1.0f;
+				bsq = 0;
+				bn = 0;
+			}
+		}
+		if ( more )
+			progress = qMax( 0.0, qMin( (af.bufPts - startPts) * 100 / duration, 99.0 ) );
+	}
+
+	delete decoder;
+
+	if ( !running )
+		return;
+	if ( bn )
+		base.append( makePeak( bmin, bmax, bsq / (bn * channels) ) );
+	if ( base.isEmpty() )
+		return;
+
+	// each level halves the previous one
+	QList< QVector<WaveformPeak> > pyramid;
+	pyramid.append( base );
+	while ( pyramid.last().count() > 1 && pyramid.count() < WAVEFORMMAXLEVELS ) {
+		QVector<WaveformPeak> prev = pyramid.last();
+		QVector<WaveformPeak> level( (prev.count() + 1) / 2 );
+		for ( int i = 0; i < level.count(); ++i ) {
+			const WaveformPeak &a = prev.at( 2 * i );
+			const WaveformPeak &b = ( 2 * i + 1 < prev.count() ) ? prev.at( 2 * i + 1 ) : a;
+			level[i].min = qMin( a.min, b.min );
+			level[i].max = qMax( a.max, b.max );
+			level[i].rms = sqrt( ((double)a.rms * a.rms + (double)b.rms * b.rms) / 2.0 );
+		}
+		pyramid.append( level );
+	}
+
+	finishedSuccess = save( pyramid, outProfile.getAudioSampleRate(), firstPts );
+	progress = 100;
+}
+
+
+
+bool WaveformBuilder::save( const QList< QVector<WaveformPeak> > &pyramid, int sampleRate, double startTime )
+{
+	QDir dir;
+	if ( !WaveformCollection::cdWaveformDir( dir ) )
+		return false;
+
+	// write to a temp file, so that a crash never leaves a truncated cache
+	QString path = dir.filePath( WaveformCollection::pathToFileName( fileName ) + WAVEFORM_EXTENSION );
+	QFile f( path + ".tmp" );
+	if ( !f.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+		return false;
+
+	QDataStream data( &f );
+	data << (quint32)WAVEFORM_MAGIC << (qint32)WAVEFORM_VERSION << (qint32)sampleRate << startTime << (qint32)pyramid.count();
+
+	qint64 offset = sizeof(quint32) + 3 * sizeof(qint32) + sizeof(double) + pyramid.count() * (sizeof(qint32) + sizeof(qint64));
+	for ( int i = 0; i < pyramid.count(); ++i ) {
+		data << (qint32)pyramid[i].count() << offset;
+		offset += (qint64)pyramid[i].count() * 3 * sizeof(qint16);
+	}
+	for ( int i = 0; i < pyramid.count(); ++i ) {
+		const QVector<WaveformPeak> &level = pyramid.at( i );
+		for ( int j = 0; j < level.count(); ++j )
+			data << level[j].min << level[j].max << level[j].rms;
+	}
+	f.close();
+
+	if ( data.status() != QDataStream::Ok ) {
+		f.remove();
+		return false;
+	}
+
+	QFile::remove( path );
+	return f.rename( path );
+}
@@ -0,0 +1,129 @@
+#ifndef WAVEFORMCOLLECTION_H
+#define WAVEFORMCOLLECTION_H
+
+#include <QThread>
+#include <QDir>
+#include <QList>
+#include <QVector>
+#include <QMutex>
+#include <QTimer>
+
+#include "source.h"
+
+// number of audio samples summarized by one peak of the finest level
+#define WAVEFORMBASEBIN 256
+#define WAVEFORMMAXLEVELS 16
+
+
+
+class WaveformPeak
+{
+public:
+	enum Status{ WAVEERROR, WAVEENQUEUED, WAVEINPROGRESS, WAVEREADY };
+
+	WaveformPeak() : min( 0 ), max( 0 ), rms( 0 ) {}
+
+	// normalized to [-32767, 32767], rms in [0, 32767]
+	qint16 min;
+	qint16 max;
+	qint16 rms;
+};
+
+
+
+// A min/max/rms pyramid stored in the waveform cache.
+// Level 0 has one peak per WAVEFORMBASEBIN samples, each next level halves the resolution.
+// Levels are only read from disk when needed.
+class Waveform
+{
+public:
+	Waveform( QString fileName, QString cacheFile );
+	~Waveform();
+
+	bool load();
+	QString getSourceName() const { return sourceName; }
+	int levelCount() { return levelOffsets.count(); }
+	double getStartTime() { return startTime; }
+	double binDuration( int level );
+	int levelFor( double duration );
+	// peak of the range [from, from + duration[, false if out of range
+	bool getPeak( double from, double duration, WaveformPeak &peak );
+
+	void use() { ++refcount; }
+	bool release() { return --refcount == 0; }
+
+private:
+	QVector<WaveformPeak>* getLevel( int level );
+
+	QString sourceName;
+	QString cachePath;
+	int sampleRate;
+	double startTime;
+	QList<qint64> levelOffsets;
+	QList<int> levelCounts;
+	QList< QVector<WaveformPeak>* > levels;
+	QMutex mutex;
+	int refcount;
+};
+
+
+
+class WaveformBuilder : public QThread
+{
+public:
+	WaveformBuilder( Source *aSource );
+	~WaveformBuilder();
+	void go();
+	void stop();
+	bool getFinishedSuccess() { return finishedSuccess; }
+	bool getStarted() { return started; }
+	int getProgress() { return progress; }
+	QString getFileName() { return fileName; }
+
+protected:
+	void run();
+
+private:
+	bool save( const QList< QVector<WaveformPeak> > &pyramid, int sampleRate, double startTime );
+
+	int progress;
+	bool started;
+	bool finishedSuccess;
+	bool running;
+	QString fileName;
+	Profile profile;
+};
+
+
+
+class WaveformCollection : public QObject
+{
+	Q_OBJECT
+public:
+	static WaveformCollection* getGlobalInstance();
+	~WaveformCollection();
+
+	Waveform* getWaveform( Source *source, int &status, int &progress );
+	void releaseWaveform( Waveform *wave );
+	bool hasRunningJobs() { return builders.count() > 0; }
+	static bool cdWaveformDir( QDir &dir );
+	static QString pathToFileName( QString path );
+
+private slots:
+	void checkBuilderThreads();
+
+private:
+	WaveformCollection();
+	WaveformCollection( const WaveformCollection& ) : QObject() {}
+
+	QTimer checkBuilderTimer;
+	QList<Waveform*> waveItems;
+	QStringList waveErrors;
+	QList<WaveformBuilder*> builders;
+	static WaveformCollection globalInstance;
+
+signals:
+	void waveformReady( QString fileName );
+};
+
+#endif // WAVEFORMCOLLECTION_H
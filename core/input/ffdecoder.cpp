@@ -3,6 +3,7 @@
 #include <sys/time.h>
 
 #include <QTimer>
+#include <QtAlgorithms>
 
 #include "input/ffdecoder.h"
 
@@ -13,6 +14,7 @@
 
 FFDecoder::FFDecoder()
 	: formatCtx( NULL ),
+	mediaIO( NULL ),
 	videoCodecCtx( NULL ),
 	audioCodecCtx( NULL ),
 	swr( NULL ),
@@ -25,7 +27,16 @@ FFDecoder::FFDecoder()
 	orientation( 0 ),
 	duration( 0 ),
 	startTime( 0 ),
-	endOfFile( 0 )
+	indexGop( -1 ),
+	skipMode( SkipNone ),
+	waitKeyframe( false ),
+	decodedVideoFrames( 0 ),
+	skippedVideoPackets( 0 ),
+	seekGeneration( NULL ),
+	seekStart( 0 ),
+	endOfFile( 0 ),
+	streamMask( InputBase::AllStreams ),
+	skipVideo( false )
 {
 	FFmpegCommon::getGlobalInstance()->initFFmpeg();
 
@@ -76,6 +87,10 @@ void FFDecoder::close()
 		avformat_close_input( &formatCtx );
 		formatCtx = NULL;
 	}
+	if ( mediaIO ) {
+		delete mediaIO;
+		mediaIO = NULL;
+	}
 }
 
 
@@ -101,6 +116,7 @@ bool FFDecoder::probe( QString fn, Profile *prof )
 	// allow ffOpen to retrieve streams infos
 	prof->setHasAudio( true );
 	prof->setHasVideo( true );
+	streamMask = InputBase::AllStreams;
 	// set the audio profile for the following audio/video sync
 	setProfile( *prof, *prof );
 
@@ -274,6 +290,12 @@ bool FFDecoder::ffOpen( QString fn )
 {
 	unsigned int i;
 
+	if ( (mediaIO = MediaIO::open( fn )) ) {
+		formatCtx = avformat_alloc_context();
+		formatCtx->pb = mediaIO->context();
+		formatCtx->flags |= AVFMT_FLAG_CUSTOM_IO;
+	}
+
 	if ( avformat_open_input( &formatCtx, fn.toLocal8Bit().data(), NULL, NULL ) != 0 )
 		return false;
 
@@ -284,10 +306,16 @@ bool FFDecoder::ffOpen( QString fn )
 
 	videoStream = audioStream = -1;
 	haveVideo = haveAudio = false;
+	skipVideo = false;
+	keyframes.clear();
+	indexGop = -1;
+	skipMode = SkipNone;
+	waitKeyframe = false;
+	decodedVideoFrames = skippedVideoPackets = 0;
 	orientation = 0;
 
 	for ( i = 0; i < formatCtx->nb_streams; i++ ) {
-		if ( videoStream == -1 && outProfile.hasVideo() && formatCtx->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO ) {
+		if ( videoStream == -1 && outProfile.hasVideo() && (streamMask & InputBase::VideoStream) && formatCtx->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO ) {
 			if ( (videoCodecCtx = formatCtx->streams[ i ]->codec) ) {
 				if ( (videoCodec = avcodec_find_decoder( videoCodecCtx->codec_id )) ) {
 					videoStream = i;
@@ -299,7 +327,7 @@ bool FFDecoder::ffOpen( QString fn )
 				}
 			}
 		}
-		if ( audioStream == -1 && outProfile.hasAudio() && formatCtx->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO ) {
+		if ( audioStream == -1 && outProfile.hasAudio() && (streamMask & InputBase::AudioStream) && formatCtx->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO ) {
 			if ( (audioCodecCtx = formatCtx->streams[ i ]->codec) ) {
 				if ( (audioCodec = avcodec_find_decoder( audioCodecCtx->codec_id )) ) {
 					audioStream = i;
@@ -312,13 +340,35 @@ bool FFDecoder::ffOpen( QString fn )
 	if ( !haveVideo && !haveAudio )
 		return false;
 
+	// unused streams are skipped by the demuxer
+	for ( i = 0; i < formatCtx->nb_streams; i++ ) {
+		if ( (int)i == videoStream || (int)i == audioStream )
+			formatCtx->streams[i]->discard = AVDISCARD_DEFAULT;
+		else
+			formatCtx->streams[i]->discard = AVDISCARD_ALL;
+	}
+
 	if ( videoCodecCtx ) {
 		AVDictionary *opts = NULL;
 		av_dict_set( &opts, "refcounted_frames", "1", 0 );
 		if ( avcodec_open2( videoCodecCtx, videoCodec, &opts ) < 0 ) {
 			return false; // Could not open codec_id
 		}
-		yadif.reset( outProfile.getVideoFrameRate() > inProfile.getVideoFrameRate(), videoStream, formatCtx, videoCodecCtx );
+		if ( doYadif )
+			yadif.reset( doYadif > Yadif1X, videoStream, formatCtx, videoCodecCtx );
+
+		AVStream *st = formatCtx->streams[videoStream];
+		int first = -1, last = -1, n = 0;
+		for ( int k = 0; k < st->nb_index_entries; ++k ) {
+			if ( st->index_entries[k].flags & AVINDEX_KEYFRAME ) {
+				if ( first == -1 )
+					first = k;
+				last = k;
+				++n;
+			}
+		}
+		if ( n > 1 )
+			indexGop = (st->index_entries[last].timestamp - st->index_entries[first].timestamp) * av_q2d( st->time_base ) * AV_TIME_BASE / (n - 1);
 	}
 
 	if ( audioCodecCtx ) {
@@ -381,8 +431,12 @@ bool FFDecoder::seek( double t )
 		return false;
 	}
 	else {
-		if ( haveVideo )
+		if ( haveVideo ) {
 			avcodec_flush_buffers( videoCodecCtx );
+			// seeks are frame accurate, InputFF sets the skip mode again if needed
+			setSkipMode( SkipNone );
+			waitKeyframe = false;
+		}
 		if ( haveAudio )
 			avcodec_flush_buffers( audioCodecCtx );
 
@@ -415,6 +469,7 @@ bool FFDecoder::seekTo( double p, Frame *f, AudioFrame *af )
 		return false;
 
 	flush();
+	skipVideo = false;
 
 	double timestamp = p;
 	double lastpts = p;
@@ -477,6 +532,8 @@ bool FFDecoder::seekTo( double p, Frame *f, AudioFrame *af )
 			}
 			else if ( delta > hdur ) {
 				do {
+					if ( seekCanceled() )
+						return true;
 					if ( !seekDecodeNext( f ) ) {
 						return false;
 					}
@@ -512,6 +569,122 @@ bool FFDecoder::seekTo( double p, Frame *f, AudioFrame *af )
 
 
 
+void FFDecoder::setSeekCancel( QAtomicInt *generation )
+{
+	seekGeneration = generation;
+	if ( seekGeneration )
+		seekStart = seekGeneration->load();
+}
+
+
+
+bool FFDecoder::seekCanceled()
+{
+	return seekGeneration && seekGeneration->load() != seekStart;
+}
+
+
+
+// Syncs audio only, when video frames are provided by someone else.
+bool FFDecoder::seekAudioTo( double p, AudioFrame *af )
+{
+	if ( !formatCtx || !haveAudio || ( p < startTime ) )
+		return false;
+
+	flush();
+	skipVideo = true;
+
+	double timestamp = p;
+	int loop = 0, maxloop = 10;
+	while ( loop++ < maxloop ) {
+		seek( timestamp );
+		if ( decodeAudio( af, DECODEAUDIOSYNC, &p ) )
+			return true;
+		timestamp -= MICROSECOND;
+	}
+
+	return false;
+}
+
+
+
+// Returns the frame skipping allowed when only one frame per outputDuration is used.
+int FFDecoder::skipModeFor( double outputDuration )
+{
+	if ( !haveVideo || doYadif )
+		return SkipNone;
+
+	if ( outputDuration < inProfile.getVideoFrameDuration() * SKIPNONREFRATIO )
+		return SkipNone;
+
+	double gop = indexGop;
+	if ( keyframes.count() > 1 )
+		gop = (keyframes.last() - keyframes.first()) / (keyframes.count() - 1);
+	if ( gop > 0 && gop <= outputDuration * SKIPNONKEYSPAN )
+		return SkipNonKey;
+
+	return SkipNonRef;
+}
+
+
+
+void FFDecoder::setSkipMode( int m )
+{
+	if ( m == skipMode || !videoCodecCtx )
+		return;
+
+	// P frames decoded after a keyframe only run would show artifacts
+	if ( skipMode == SkipNonKey )
+		waitKeyframe = true;
+	skipMode = m;
+
+	switch ( skipMode ) {
+		case SkipNonKey:
+			videoCodecCtx->skip_frame = AVDISCARD_NONKEY;
+			break;
+		case SkipNonRef:
+			videoCodecCtx->skip_frame = AVDISCARD_NONREF;
+			break;
+		default:
+			videoCodecCtx->skip_frame = AVDISCARD_DEFAULT;
+	}
+}
+
+
+
+// Coarse seek, decoding restarts at the keyframe before t.
+bool FFDecoder::seekKeyframe( double t )
+{
+	flush();
+	skipVideo = false;
+	return seek( t );
+}
+
+
+
+// Returns the pts of the last keyframe not after t, or -1 if unknown.
+// Uses the demuxer index if any, and the keyframes already decoded.
+double FFDecoder::keyframeBefore( double t )
+{
+	if ( !formatCtx || !haveVideo )
+		return -1;
+
+	double kf = -1;
+	AVStream *st = formatCtx->streams[videoStream];
+	double tb = av_q2d( st->time_base ) * AV_TIME_BASE;
+	int i = av_index_search_timestamp( st, t / tb, AVSEEK_FLAG_BACKWARD );
+	if ( i >= 0 )
+		kf = st->index_entries[i].timestamp * tb;
+
+	QList<double>::iterator it = qUpperBound( keyframes.begin(), keyframes.end(), t );
+	if ( it != keyframes.begin() )
+		kf = qMax( kf, *(it - 1) );
+
+	return kf;
+}
+
+
+
 bool FFDecoder::decodeVideo( Frame *f )
 {
 	int gotFrame = 0;
@@ -548,12 +721,29 @@ bool FFDecoder::decodeVideo( Frame *f )
 		else {
 			if ( !(packet = videoPackets.dequeue()) )
 				return false;
+			if ( skipMode == SkipNonKey && !(packet->flags & AV_PKT_FLAG_KEY) ) {
+				++skippedVideoPackets;
+				freePacket( packet );
+				continue;
+			}
 		}
 		int len = avcodec_decode_video2( videoCodecCtx, videoAvframe, &gotFrame, packet );
 		if ( len >= 0 && gotFrame ) {
+			++decodedVideoFrames;
 			AVStream *st = formatCtx->streams[videoStream];
 			double tb = av_q2d( st->time_base ) * AV_TIME_BASE;
 			vpts = av_frame_get_best_effort_timestamp( videoAvframe ) * tb;
+			if ( videoAvframe->key_frame ) {
+				QList<double>::iterator it = qLowerBound( keyframes.begin(), keyframes.end(), vpts );
+				if ( it == keyframes.end() || *it != vpts )
+					keyframes.insert( it, vpts );
+				waitKeyframe = false;
+			}
+			else if ( waitKeyframe ) {
+				av_frame_unref( videoAvframe );
+				freePacket( packet );
+				continue;
+			}
 
 			double ratio = 1.0;
 			if ( st->sample_aspect_ratio.num && av_cmp_q(st->sample_aspect_ratio, st->codec->sample_aspect_ratio) ) {
@@ -861,7 +1051,7 @@ bool FFDecoder::getPacket()
 		return false;
 	}
 	if ( packet->stream_index == videoStream ) {
-		if ( !av_dup_packet( packet ) )
+		if ( !skipVideo && !av_dup_packet( packet ) )
 			videoPackets.enqueue( packet );
 		else
 			freePacket( packet );
@@ -13,8 +13,15 @@
 #include <QQueue>
 
 #include <QMutex>
+#include <QAtomicInt>
 #include "engine/frame.h"
+#include "input/input.h"
+#include "input/mediaio.h"
 
+// frames may be skipped when less than 1 source frame out of SKIPNONREFRATIO is output
+#define SKIPNONREFRATIO 2.0
+// only keyframes are decoded if they come at least every SKIPNONKEYSPAN output frames
+#define SKIPNONKEYSPAN 2.0
 
 
 class AudioFrame
@@ -124,19 +131,30 @@ class FFDecoder
 {
 private:
 	friend class InputFF;
+	friend class WaveformBuilder;
 
 	enum YadifMode{ NoYadif=0, Yadif1X=1, Yadif2X=2 };
+	enum SkipMode{ SkipNone=0, SkipNonRef=1, SkipNonKey=2 };
 	FFDecoder();
 	~FFDecoder();
 	bool open( QString fn );
 	bool seekTo( double p, Frame *f, AudioFrame *af );
+	// seekTo stops at the frame reached so far when *generation changes
+	void setSeekCancel( QAtomicInt *generation );
+	bool seekCanceled();
+	bool seekAudioTo( double p, AudioFrame *af );
+	bool seekKeyframe( double t );
+	double keyframeBefore( double t );
 	bool probe( QString fn, Profile *prof );
 	bool decodeVideo( Frame *f );
 	bool decodeAudio( AudioFrame *f, int sync=0, double *pts=NULL );
-	void setProfile( const Profile &in, const Profile &out ) {
+	int skipModeFor( double outputDuration );
+	void setSkipMode( int m );
+	// if glDeinterlace, interlaced frames are passed untouched to the composer
+	void setProfile( const Profile &in, const Profile &out, bool glDeinterlace = false ) {
 		inProfile = in;
 		outProfile = out;
-		if ( inProfile.getVideoInterlaced() ) {
+		if ( inProfile.getVideoInterlaced() && !glDeinterlace ) {
 			if ( outProfile.getVideoFrameRate() > inProfile.getVideoFrameRate() )
 				doYadif = Yadif2X;
 			else
@@ -160,6 +178,8 @@ private:
 	bool seekDecodeNext( Frame *f );
 
 	AVFormatContext *formatCtx;
+	// NULL if libavformat does the file io
+	MediaIO *mediaIO;
 	AVCodecContext *videoCodecCtx;
 	AVCodecContext *audioCodecCtx;
 	SwrContext *swr;
@@ -179,6 +199,21 @@ private:
 	double duration;
 	double startTime;
 
+	// pts of the keyframes met while decoding, sorted
+	QList<double> keyframes;
+	// mean distance between keyframes in the demuxer index, -1 if unknown
+	double indexGop;
+
+	int skipMode;
+	// frames are dropped until next keyframe, their references were not decoded
+	bool waitKeyframe;
+	// since open, to measure the skip modes
+	int decodedVideoFrames, skippedVideoPackets;
+
+	// NULL if seeks can't be canceled
+	QAtomicInt *seekGeneration;
+	int seekStart;
+
 	AudioPacket currentAudioPacket;
 
 	QQueue<AVPacket*> audioPackets, videoPackets;
@@ -187,6 +222,10 @@ private:
 	int endOfFile;
 
 	bool haveAudio, haveVideo;
+	// InputBase::StreamMask
+	int streamMask;
+	// video packets are dropped, set by seekAudioTo
+	bool skipVideo;
 	Profile inProfile, outProfile;
 };
 
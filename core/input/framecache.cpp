@@ -0,0 +1,131 @@
+#include "framecache.h"
+
+
+
+static FrameCache globalFrameCache;
+
+
+
+FrameCache* FrameCache::getGlobalInstance()
+{
+	return &globalFrameCache;
+}
+
+
+
+FrameCache::FrameCache()
+	: budget( FRAMECACHEBUDGET ),
+	used( 0 ),
+	useCount( 0 )
+{
+}
+
+
+
+FrameCache::~FrameCache()
+{
+	// buffers are not released, the pool may already be destroyed at exit
+	QHash< QString, QMap<qint64, CachedFrame*> >::iterator it;
+	for ( it = frames.begin(); it != frames.end(); ++it )
+		qDeleteAll( it.value() );
+}
+
+
+
+void FrameCache::setBudget( qint64 bytes )
+{
+	QMutexLocker ml( &mutex );
+	budget = bytes;
+	evict();
+}
+
+
+
+CachedFrame* FrameCache::find( QString k, double pts, double tolerance )
+{
+	QHash< QString, QMap<qint64, CachedFrame*> >::iterator it = frames.find( k );
+	if ( it == frames.end() )
+		return NULL;
+
+	QMap<qint64, CachedFrame*>::iterator fit = it.value().lowerBound( qRound64( pts - tolerance ) );
+	CachedFrame *best = NULL;
+	while ( fit != it.value().end() && fit.value()->pts <= pts + tolerance ) {
+		if ( !best || qAbs( fit.value()->pts - pts ) < qAbs( best->pts - pts ) )
+			best = fit.value();
+		++fit;
+	}
+	return best;
+}
+
+
+
+void FrameCache::insert( QString source, int variant, Frame *f )
+{
+	if ( !f->getBuffer() || budget <= 0 )
+		return;
+
+	int bytes = f->profile.getVideoWidth() * f->profile.getVideoHeight();
+	switch ( f->type() ) {
+		case Frame::YUV420P : bytes = bytes * 3 / 2; break;
+		case Frame::YUV422P : bytes = bytes * 2; break;
+		case Frame::RGBA : bytes = bytes * 4; break;
+		case Frame::RGB : bytes = bytes * 3; break;
+		default : return;
+	}
+
+	QMutexLocker ml( &mutex );
+	QString k = key( source, variant );
+	if ( find( k, f->pts(), 1 ) )
+		return;
+
+	CachedFrame *cf = new CachedFrame();
+	cf->buffer = f->getBuffer();
+	BufferPool::globalInstance()->useBuffer( cf->buffer );
+	cf->type = f->type();
+	cf->pts = f->pts();
+	cf->profile = f->profile;
+	cf->orientation = f->orientation();
+	cf->bytes = bytes;
+	cf->lastUse = ++useCount;
+	cf->key = k;
+	frames[k].insert( qRound64( cf->pts ), cf );
+	lru.insert( cf->lastUse, cf );
+	used += bytes;
+
+	evict();
+}
+
+
+
+bool FrameCache::get( QString source, int variant, double pts, double tolerance, Frame *f )
+{
+	QMutexLocker ml( &mutex );
+	CachedFrame *cf = find( key( source, variant ), pts, tolerance );
+	if ( !cf )
+		return false;
+
+	lru.remove( cf->lastUse );
+	cf->lastUse = ++useCount;
+	lru.insert( cf->lastUse, cf );
+	f->setSharedBuffer( cf->buffer );
+	f->setVideoFrame( (Frame::DataType)cf->type, cf->profile.getVideoWidth(), cf->profile.getVideoHeight(), cf->profile.getVideoSAR(),
+					  cf->profile.getVideoInterlaced(), cf->profile.getVideoTopFieldFirst(), cf->pts, cf->profile.getVideoFrameDuration(), cf->orientation );
+	f->profile = cf->profile;
+	return true;
+}
+
+
+
+void FrameCache::evict()
+{
+	while ( used > budget && !lru.isEmpty() ) {
+		CachedFrame *cf = lru.take( lru.firstKey() );
+		QHash< QString, QMap<qint64, CachedFrame*> >::iterator it = frames.find( cf->key );
+		it.value().remove( qRound64( cf->pts ) );
+		if ( it.value().isEmpty() )
+			frames.erase( it );
+		used -= cf->bytes;
+		BufferPool::globalInstance()->releaseBuffer( cf->buffer );
+		delete cf;
+	}
+}
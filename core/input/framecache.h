@@ -0,0 +1,61 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include <QMap>
+#include <QHash>
+#include <QMutex>
+
+#include "engine/frame.h"
+
+#define FRAMECACHEBUDGET 256 * 1024 * 1024
+
+
+
+class CachedFrame
+{
+public:
+	CachedFrame() : buffer( NULL ), type( 0 ), pts( 0 ), orientation( 0 ), bytes( 0 ), lastUse( 0 ) {}
+
+	Buffer *buffer;
+	int type;
+	double pts;
+	Profile profile;
+	int orientation;
+	int bytes;
+	quint64 lastUse;
+	// of frames
+	QString key;
+};
+
+
+
+// Decoded video frames shared by all inputs, keyed by source and pts.
+// Frames hold a reference on their BufferPool buffer, like LastDecodedFrame.
+class FrameCache
+{
+public:
+	FrameCache();
+	~FrameCache();
+	static FrameCache* getGlobalInstance();
+
+	// variant distinguishes decodings of the same source (e.g. deinterlacing mode)
+	void insert( QString source, int variant, Frame *f );
+	// fills f with the frame nearest to pts, if within tolerance
+	bool get( QString source, int variant, double pts, double tolerance, Frame *f );
+	void setBudget( qint64 bytes );
+
+private:
+	QString key( QString source, int variant ) { return QString( "%1:%2" ).arg( variant ).arg( source ); }
+	CachedFrame* find( QString k, double pts, double tolerance );
+	void evict();
+
+	QHash< QString, QMap<qint64, CachedFrame*> > frames;
+	// all frames by lastUse, least recently used first
+	QMap<quint64, CachedFrame*> lru;
+	qint64 budget;
+	qint64 used;
+	quint64 useCount;
+	QMutex mutex;
+};
+
+#endif // FRAMECACHE_H
@@ -2,6 +2,7 @@
 #define INPUT_H
 
 #include <QThread>
+#include <QAtomicInt>
 
 #include "engine/frame.h"
 
@@ -12,6 +13,10 @@ class InputBase : public QThread
 	Q_OBJECT
 public:
 	enum InputType{ UNDEF, FFMPEG, GLSL, IMAGE, LAST };
+	enum StreamMask{ NoStream=0, VideoStream=1, AudioStream=2, AllStreams=3 };
+	// SeekExact: frame accurate. SeekFast: a cached frame or the keyframe before, for scrubbing.
+	// SeekCancelable: frame accurate, unless a newer seek cancels it.
+	enum SeekMode{ SeekExact, SeekFast, SeekCancelable };
 
 	InputBase()
 		: haveAudio( false ),
@@ -19,7 +24,12 @@ public:
 		usedByClip( false ),
 		inputType( UNDEF ),
 		mmi( 0 ),
-		speed( 1 )
+		speed( 1 ),
+		previewSpeed( 0 ),
+		warmUpCost( -1 ),
+		streamMask( AllStreams ),
+		glDeinterlace( false ),
+		seekMode( SeekExact )
 	{
 		mmiProvider = QString().sprintf("%p", this);
 	}
@@ -32,6 +42,10 @@ public:
 	virtual Frame *getVideoFrame() = 0;
 	virtual Frame *getAudioFrame( int nSamples ) = 0;
 	virtual void setProfile( const Profile &in, const Profile &out ) { inProfile = in; outProfile = out; }
+	// video frames are not needed until resumeVideo, audio keeps playing
+	virtual void suspendVideo() {}
+	// video frames restart at source pts p
+	virtual void resumeVideo( double p ) { Q_UNUSED( p ); }
 
 	bool hasAudio() { return haveAudio; }
 	bool hasVideo() { return haveVideo; }
@@ -41,6 +55,18 @@ public:
 	void setUsed( bool b ) { usedByClip = b; }
 	
 	void setSpeed( double s ) { speed = s; }
+	// shuttle speed of the preview, frames that can't be seen at this speed may not be decoded.
+	// 0 (default) when all frames are needed.
+	void setPreviewSpeed( double s ) { previewSpeed = s; }
+	// streams to decode, the others are not even demuxed. Applies at next open.
+	void setStreamMask( int m ) { streamMask = m; }
+	// interlaced video is deinterlaced by the composer instead of the input. Set before setProfile.
+	void setGLDeinterlace( bool b ) { glDeinterlace = b; }
+	// applies to the next seeks
+	void setSeekMode( int m ) { seekMode = m; }
+	// time (µs) spent in the last open and seek, -1 if not measured since last call.
+	// Set by the input thread, taken by the sampler.
+	double takeWarmUpCost() { return warmUpCost.fetchAndStoreOrdered( -1 ); }
 
 	// mmi (memory management indicator) gives some indication to the video composer about this frame data.
 	// Call mmiSeek when seeking, then if data is the same than previous frame call mmiDuplicate
@@ -66,6 +92,11 @@ protected:
 	QString mmiProvider;
 	
 	double speed;
+	double previewSpeed;
+	QAtomicInt warmUpCost;
+	int streamMask;
+	bool glDeinterlace;
+	int seekMode;
 
 	Profile inProfile, outProfile;
 };
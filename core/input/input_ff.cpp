@@ -1,28 +1,43 @@
 // kate: tab-indent on; indent-width 4; mixedindent off; indent-mode cstyle; remove-trailing-space on;
 
 #include <QtConcurrentRun>
+#include <QElapsedTimer>
 
 #include "input/input_ff.h"
+#include "input/framecache.h"
 
 #define BACKWARDLEN MICROSECOND
+// longest GOP kept in memory, the beginning of longer ones is decoded again
+#define BACKWARDMAXGOP 3 * MICROSECOND
 #define AUDIODRIFTMAX 100000
 
 
 
+QAtomicInt InputFF::seekGeneration;
+
+
+
 InputFF::InputFF() : InputBase(),
 	decoder( new FFDecoder() ),
 	semaphore( new QSemaphore( 1 ) ),
 	running( false ),
 	seekAndPlayPTS( 0 ),
 	seekAndPlay( false ),
+	videoSuspended( false ),
+	resumeVideoPending( false ),
+	resumeVideoPts( 0 ),
 	forwardAudioSamples( 0 ),
 	forwardStartPts( 0 ),
-	backwardAudioSamples( 0 ),
 	samplesInBackwardAudioFrames(0),
 	playBackward( false ),
 	backwardPts( 0 ),
-	backwardStartPts( 0 ),
+	backwardSegmentStart( 0 ),
 	backwardEof( false ),
+	cachedPts( -1 ),
+	audioSkipUntil( -1 ),
+	decodedAudio( new AudioFrame( 4, 48000 ) ),
+	pendingSilence( 0 ),
+	pendingSilencePts( 0 ),
 	eofVideo( false ),
 	eofAudio( false )
 {
@@ -37,6 +52,7 @@ InputFF::~InputFF()
 	wait();
 	delete decoder;
 	flush();
+	delete decodedAudio;
 }
 
 
@@ -48,24 +64,71 @@ void InputFF::flush()
 		delete f;
 	while ( !backwardVideoFrames.isEmpty() )
 		delete backwardVideoFrames.takeFirst();
+	while ( !playoutVideoFrames.isEmpty() )
+		delete playoutVideoFrames.takeFirst();
 	while ( !backwardAudioFrames.isEmpty() )
 		delete backwardAudioFrames.takeFirst();
+	while ( !reversedAudioFrames.isEmpty() )
+		delete reversedAudioFrames.takeFirst();
 
 	lastFrame.set( NULL );
-	audioFrameList.reset( outProfile );
+	audioRing.reset( outProfile );
+	decodedAudio->bytesPerSample = audioRing.getBytesPerSample();
+	decodedAudio->sampleRate = outProfile.getAudioSampleRate();
+	decodedAudio->writeDone( 0, 0 );
+	pendingSilence = 0;
 	videoResampler.reset( outProfile.getVideoFrameDuration() );
 	eofVideo = eofAudio = false;
 	backwardEof = false;
+	cachedPts = -1;
+	audioSkipUntil = -1;
 	forwardAudioSamples = 0;
-	backwardAudioSamples = 0;
 	samplesInBackwardAudioFrames = 0;
 }
 
 
 
 
+// Moves pending samples in audioRing, returns false if some are still pending.
+bool InputFF::flushAudio()
+{
+	int bps = audioRing.getBytesPerSample();
+
+	if ( pendingSilence > 0 ) {
+		int n = audioRing.writeSilence( pendingSilence, pendingSilencePts );
+		pendingSilence -= n;
+		pendingSilencePts += (double)n * MICROSECOND / outProfile.getAudioSampleRate();
+		if ( pendingSilence > 0 )
+			return false;
+	}
+
+	if ( decodedAudio->available > 0 ) {
+		int n = audioRing.write( decodedAudio->buffer->data() + decodedAudio->bufOffset, decodedAudio->available, decodedAudio->bufPts );
+		decodedAudio->available -= n;
+		decodedAudio->bufOffset += n * bps;
+		decodedAudio->bufPts += (double)n * MICROSECOND / outProfile.getAudioSampleRate();
+		if ( decodedAudio->available > 0 )
+			return false;
+	}
+
+	while ( !reversedAudioFrames.isEmpty() ) {
+		AudioFrame *af = reversedAudioFrames.first();
+		// reversed writes consume the end of the frame
+		af->available -= audioRing.write( af->buffer->data() + af->bufOffset, af->available, af->bufPts, true );
+		if ( af->available > 0 )
+			return false;
+		delete reversedAudioFrames.takeFirst();
+	}
+
+	return true;
+}
+
+
+
+
 bool InputFF::open( QString fn )
 {
+	decoder->streamMask = streamMask;
 	bool ok = decoder->open( fn );
 	if ( ok )
 		sourceName = fn;
@@ -92,46 +155,54 @@ double InputFF::seekTo( double p )
 
 	if ( playBackward ) {
 		p = qMin( p, inProfile.getStreamStartTime() + inProfile.getStreamDuration() - inProfile.getVideoFrameDuration() );
-		backwardPts = backwardStartPts = p;
-		double target = backwardPts - BACKWARDLEN;
-		if ( target <= inProfile.getStreamStartTime() ) {
-			target = inProfile.getStreamStartTime();
-			backwardEof = true;
+		backwardPts = p;
+		videoResampler.reset( outProfile.getVideoFrameDuration() );
+		videoResampler.outputPts = p;
+		if ( seekBackwardSegment() && backwardVideoFrames.count() )
+			return backwardVideoFrames.first()->pts();
+	}
+	else {
+		Frame *f = new Frame();
+		AudioFrame *af = new AudioFrame( audioRing.getBytesPerSample(), outProfile.getAudioSampleRate() );
+		bool ok;
+		if ( decoder->haveVideo && videoSuspended ) {
+			ok = false;
+			if ( decoder->haveAudio )
+				decoder->seekAudioTo( p, af );
 		}
-		Frame *f = new Frame( NULL );
-		AudioFrame *af = new AudioFrame( audioFrameList.getBytesPerSample(), outProfile.getAudioSampleRate() );
-		bool ok = decoder->seekTo( target, f, af );
-		if ( af->buffer ) {
-			backwardAudioFrames.append( af );
-			backwardAudioSamples += af->available;
-			samplesInBackwardAudioFrames += af->available;
+		else if ( decoder->haveVideo && FrameCache::getGlobalInstance()->get( sourceName, decoder->doYadif, p, sourceFrameDuration() / 2.0, f ) ) {
+			// recently decoded, only audio has to be synced
+			ok = true;
+			cachedPts = f->pts();
+			if ( decoder->haveAudio )
+				decoder->seekAudioTo( f->pts(), af );
 		}
-		else
-			delete af;
-		if ( ok && f->getBuffer() ) {
-			backwardVideoFrames.append( f );
-			videoResampler.reset( outProfile.getVideoFrameDuration() );
-			videoResampler.outputPts = p;
-			return f->pts();
+		else if ( decoder->haveVideo && seekMode == SeekFast ) {
+			// scrubbing, an exact seek follows if we are still there
+			ok = decoder->seekKeyframe( p ) && decoder->decodeVideo( f );
+			if ( ok && f->getBuffer() )
+				FrameCache::getGlobalInstance()->insert( sourceName, decoder->doYadif, f );
 		}
 		else {
-			delete f;
+			decoder->setSeekCancel( seekMode == SeekCancelable ? &seekGeneration : NULL );
+			ok = decoder->seekTo( p, f, af );
+			decoder->setSeekCancel( NULL );
+			if ( ok && f->getBuffer() )
+				FrameCache::getGlobalInstance()->insert( sourceName, decoder->doYadif, f );
 		}
-	}
-	else {
-		Frame *f = new Frame();
-		AudioFrame *af = new AudioFrame( audioFrameList.getBytesPerSample(), outProfile.getAudioSampleRate() );
-		bool ok = decoder->seekTo( p, f, af );
 		if ( af->buffer ) {
-			audioFrameList.append( af );
+			delete decodedAudio;
+			decodedAudio = af;
 			forwardAudioSamples += af->available;
 			forwardStartPts = p;
+			flushAudio();
 		}
 		else {
 			delete af;
 			eofAudio = true;
 		}
 		if ( ok && f->getBuffer() ) {
+			setFields( f, false );
 			lastFrame.set( f );
 			videoResampler.reset( outProfile.getVideoFrameDuration() );
 			videoResampler.outputPts = f->pts();
@@ -140,7 +211,7 @@ double InputFF::seekTo( double p )
 		}
 		else {
 			delete f;
-			eofVideo = true;
+			eofVideo = !videoSuspended;
 		}
 	}
 
@@ -189,6 +260,7 @@ void InputFF::osp( QString fn, double p, bool backward )
 
 void InputFF::openSeekPlay( QString fn, double p, bool backward )
 {
+	videoSuspended = false;
 	// We want this function to return as soon as possible,
 	// but in some cases it may block too long in play(), particularly
 	// if we are seeking in backward mode.
@@ -200,6 +272,39 @@ void InputFF::openSeekPlay( QString fn, double p, bool backward )
 
 
 
+void InputFF::suspendVideo()
+{
+	videoSuspended = true;
+}
+
+
+
+void threadResumeVideo( InputFF *that, double p )
+{
+	that->rv( p );
+}
+
+void InputFF::rv( double p )
+{
+	play( false );
+	resumeVideoPts = p;
+	resumeVideoPending = true;
+	start();
+}
+
+// Asynchronous like openSeekPlay, getVideoFrame waits for the first frame.
+void InputFF::resumeVideo( double p )
+{
+	if ( playBackward ) {
+		videoSuspended = false;
+		return;
+	}
+	semaphore->acquire();
+	QtConcurrent::run( threadResumeVideo, this, p );
+}
+
+
+
 void InputFF::play( bool b )
 {
 	if ( !b ) {
@@ -217,13 +322,41 @@ void InputFF::play( bool b )
 void InputFF::run()
 {
 	if ( seekAndPlay ) {
-		if ( seekAndPlayPath != sourceName || outProfile.hasVideo() != decoder->haveVideo || outProfile.hasAudio() != decoder->haveAudio )
+		QElapsedTimer timer;
+		timer.start();
+		bool wantVideo = outProfile.hasVideo() && (streamMask & VideoStream);
+		bool wantAudio = outProfile.hasAudio() && (streamMask & AudioStream);
+		if ( seekAndPlayPath != sourceName || wantVideo != decoder->haveVideo || wantAudio != decoder->haveAudio )
 			open( seekAndPlayPath );
 		seekTo( seekAndPlayPTS );
+		warmUpCost.fetchAndStoreOrdered( timer.nsecsElapsed() / 1000 );
 		seekAndPlay = false;
 		running = true;
 		semaphore->release();
 	}
+	else if ( resumeVideoPending ) {
+		Frame *f;
+		while ( (f = reorderedVideoFrames.dequeue()) )
+			delete f;
+		videoSuspended = false;
+		resumeVideoPending = false;
+		eofVideo = false;
+		cachedPts = -1;
+		mmiSeek();
+		f = new Frame();
+		if ( decoder->haveVideo && resumeDecoder( resumeVideoPts, f ) ) {
+			f->mmi = mmi;
+			f->mmiProvider = mmiProvider;
+			lastFrame.set( f );
+			videoResampler.reset( outProfile.getVideoFrameDuration() );
+			videoResampler.outputPts = f->pts();
+			resample( f );
+		}
+		else
+			delete f;
+		running = true;
+		semaphore->release();
+	}
 
 	// in case file has moved
 	if ( !decoder->formatCtx ) {
@@ -249,13 +382,22 @@ void InputFF::runForward()
 		doWait = 1;
 
 		if ( decoder->haveVideo && !eofVideo ) {
-			if ( reorderedVideoFrames.count() < 3 ) {
+			if ( videoSuspended ) {
+				// drop video until resumeVideo
+				decoder->skipVideo = true;
+				cachedPts = -1;
+				while ( (f = reorderedVideoFrames.dequeue()) )
+					delete f;
+			}
+			else if ( reorderedVideoFrames.count() < 3 ) {
 				f = new Frame();
 				// resample if necessary
 				if ( videoResampler.repeat && lastFrame.valid() ) {
 					// duplicate previous frame
 					lastFrame.get( f );
 					videoResampler.duplicate( f );
+					if ( f->field() != Frame::NOFIELD && doubleFieldRate() )
+						f->setField( Frame::SECONDFIELD );
 					f->mmi = mmi;
 					f->mmiProvider = mmiProvider;
 					reorderedVideoFrames.enqueue( f );
@@ -264,7 +406,10 @@ void InputFF::runForward()
 					mmiIncrement();
 					f->mmi = mmi;
 					f->mmiProvider = mmiProvider;
-					if ( decoder->decodeVideo( f ) ) {
+					double shown = outProfile.getVideoFrameDuration() * previewSpeed;
+					decoder->setSkipMode( shown > 0 ? decoder->skipModeFor( shown ) : FFDecoder::SkipNone );
+					if ( decodeVideoFrame( f ) ) {
+						setFields( f, false );
 						lastFrame.set( f );
 						resample ( f );
 					}
@@ -279,43 +424,47 @@ void InputFF::runForward()
 		}
 
 		if ( decoder->haveAudio && !eofAudio ) {
-			if ( audioFrameList.writable() ) {
-				AudioFrame *af = new AudioFrame( audioFrameList.getBytesPerSample(), oasr );
+			if ( flushAudio() && audioRing.writable() ) {
+				AudioFrame *af = decodedAudio;
+				af->writeDone( 0, 0 );
 				decoder->decodeAudio( af );
-				if ( af->buffer ) {
+				if ( af->available > 0 && audioSkipUntil >= 0 ) {
+					// already in the ring, see resumeDecoder
+					int ns = qMin( (audioSkipUntil - af->bufPts) * oasr / MICROSECOND, (double)af->available );
+					if ( ns > 0 ) {
+						af->available -= ns;
+						af->bufOffset += ns * audioRing.getBytesPerSample();
+						af->bufPts += (double)ns * MICROSECOND / oasr;
+					}
+					if ( af->available > 0 )
+						audioSkipUntil = -1;
+				}
+				if ( af->available > 0 ) {
 					double expectedPts = forwardStartPts + ((double)forwardAudioSamples * MICROSECOND / oasr);
 					double dpts = af->bufPts - expectedPts;
 					if ( dpts > AUDIODRIFTMAX  ) {
 						qDebug() << "Inserting silence to compensate audio pts drift : expected" << expectedPts << "got" << af->bufPts;
-						AudioFrame *silence = new AudioFrame( audioFrameList.getBytesPerSample(), oasr );
-						int ns = qMin( dpts * oasr / MICROSECOND, oasr );
-						uint8_t* dst = silence->write( 0, ns );
-						memset( dst, 0, ns * silence->bytesPerSample );
-						silence->writeDone( expectedPts, ns );
-						audioFrameList.append( silence );
-						forwardAudioSamples += silence->available;
-						audioFrameList.append( af );
+						pendingSilence = qMin( dpts * oasr / MICROSECOND, oasr );
+						pendingSilencePts = expectedPts;
+						forwardAudioSamples += pendingSilence;
 						forwardAudioSamples += af->available;
 					}
 					else if ( dpts < -AUDIODRIFTMAX ) {
 						qDebug() << "Dropping samples to compensate audio pts drift : expected" << expectedPts << "got" << af->bufPts;
 						int ns = qMin( -dpts * oasr / MICROSECOND, (double)af->available );
 						af->available -= ns;
-						audioFrameList.append( af );
 						forwardAudioSamples += af->available;
 					}
 					else {
-						audioFrameList.append( af );
 						forwardAudioSamples += af->available;
 					}
+					flushAudio();
 				}
-				else
-					delete af;
-
-				if ( decoder->endOfFile & FFDecoder::EofAudio )
-					eofAudio = true;
 				doWait = 0;
 			}
+			// do not signal eof before all samples are in the ring
+			if ( (decoder->endOfFile & FFDecoder::EofAudio) && flushAudio() )
+				eofAudio = true;
 		}
 
 		if ( decoder->haveVideo && decoder->haveAudio ) {
@@ -348,63 +497,88 @@ void InputFF::runForward()
 void InputFF::runBackward()
 {
 	int doWait;
-	bool endVideoSequence = !decoder->haveVideo;
-	bool endAudioSequence = !decoder->haveAudio;
-	int minSamples = (outProfile.getAudioSampleRate() / outProfile.getVideoFrameRate()) * NUMINPUTFRAMES;
+	bool endVideoSequence = !decoder->haveVideo || backwardVideoFrames.isEmpty();
+	bool endAudioSequence = !decoder->haveAudio || ( decoder->haveVideo && backwardVideoFrames.isEmpty() );
+	double oasr = outProfile.getAudioSampleRate();
+	int minSamples = (oasr / outProfile.getVideoFrameRate()) * NUMINPUTFRAMES;
 	double frameRate = inProfile.getVideoFrameRate() * (1.0 + (decoder->doYadif > FFDecoder::Yadif1X));
+	int maxFrames = frameRate * BACKWARDMAXGOP / MICROSECOND;
+	bool lastSegment = false;
 
 	while ( running ) {
 		doWait = 1;
+		flushAudio();
 
-		if ( !endVideoSequence ) {
-			bool yes = backwardVideoFrames.count() + reorderedVideoFrames.count() < (frameRate * BACKWARDLEN / MICROSECOND) + 3;
-			yes |= reorderedVideoFrames.count() < 3;
-			yes |= decoder->haveAudio && !audioFrameList.readable( minSamples );
-			if ( yes ) {
+		// the previous GOP is handed out a few frames at a time
+		while ( !playoutVideoFrames.isEmpty() && reorderedVideoFrames.count() < 3 ) {
+			// resample if necessary
+			if ( videoResampler.repeat && lastFrame.valid() ) {
+				// duplicate previous frame
 				Frame *f = new Frame( NULL );
-				if ( decoder->decodeVideo( f ) ) {
-					backwardVideoFrames.append( f );
-					if ( f->pts() >= backwardPts )
-						endVideoSequence = true;
-				}
-				else {
-					delete f;
-					endVideoSequence = true;
+				lastFrame.get( f, true );
+				videoResampler.duplicate( f, true );
+				if ( f->field() != Frame::NOFIELD )
+					f->setField( Frame::FIRSTFIELD );
+				f->mmi = mmi;
+				f->mmiProvider = mmiProvider;
+				reorderedVideoFrames.enqueue( f );
+			}
+			else {
+				Frame *f = playoutVideoFrames.takeLast();
+				mmiIncrement();
+				f->mmi = mmi;
+				f->mmiProvider = mmiProvider;
+				setFields( f, true );
+				lastFrame.set( f );
+				resampleBackward( f );
+			}
+			doWait = 0;
+		}
+
+		// decoded while the previous GOP plays out, at most maxFrames
+		if ( !endVideoSequence ) {
+			Frame *f = new Frame( NULL );
+			if ( decoder->decodeVideo( f ) && f->pts() < backwardPts ) {
+				backwardVideoFrames.append( f );
+				if ( backwardVideoFrames.count() > maxFrames ) {
+					delete backwardVideoFrames.takeFirst();
+					backwardSegmentStart = backwardVideoFrames.first()->pts();
+					trimBackwardAudio();
 				}
-				if ( backwardVideoFrames.count() > frameRate * 2 ) // broken stream ?
-					endVideoSequence = true;
-				doWait = 0;
 			}
+			else {
+				// reached the already played GOP
+				delete f;
+				endVideoSequence = true;
+			}
+			doWait = 0;
 		}
 
 		if ( !endAudioSequence ) {
-			bool yes = !audioFrameList.readable( minSamples * 3 );
+			bool yes = !audioRing.readable( minSamples * 3 );
+			yes |= endVideoSequence;
 			yes |= decoder->haveVideo && reorderedVideoFrames.count() < 3;
 			if ( yes ) {
-				AudioFrame *af = new AudioFrame( audioFrameList.getBytesPerSample(), outProfile.getAudioSampleRate() );
+				AudioFrame *af = new AudioFrame( audioRing.getBytesPerSample(), oasr );
 				decoder->decodeAudio( af );
-				if ( samplesInBackwardAudioFrames > outProfile.getAudioSampleRate() * 2 ) { // broken stream ?
+				if ( samplesInBackwardAudioFrames > oasr * (BACKWARDMAXGOP / MICROSECOND + 1) ) { // broken stream ?
 					delete af;
 					endAudioSequence = true;
 				}
 				else if ( af->available ) {
-					double dpts = (double)(backwardAudioSamples + af->available) * MICROSECOND / (double)outProfile.getAudioSampleRate();
-					if ( backwardAudioFrames.count() && backwardAudioFrames.first()->bufPts + dpts >= backwardStartPts ) {
-						af->available -= ((backwardAudioFrames.first()->bufPts + dpts - backwardStartPts) * (double)outProfile.getAudioSampleRate() / MICROSECOND) - 0.5;
-						if ( af->available <= 0 )
-							delete af;
-						else {
-							backwardAudioSamples += af->available;
-							samplesInBackwardAudioFrames += af->available;
-							backwardAudioFrames.append( af );
-						}
+					double end = af->bufPts + ((double)af->available * MICROSECOND / oasr);
+					if ( end >= backwardPts ) {
+						af->available -= ((end - backwardPts) * oasr / MICROSECOND) - 0.5;
 						endAudioSequence = true;
 					}
-					else {
-						backwardAudioSamples += af->available;
+					if ( af->available > 0 ) {
 						samplesInBackwardAudioFrames += af->available;
 						backwardAudioFrames.append( af );
+						if ( af->bufPts < backwardSegmentStart )
+							trimBackwardAudio();
 					}
+					else
+						delete af;
 				}
 				else {
 					delete af;
@@ -414,105 +588,52 @@ void InputFF::runBackward()
 			}
 		}
 
-		if ( endVideoSequence && endAudioSequence ) {
-			double bpts = backwardPts;
-			if ( backwardVideoFrames.count() ) {
-				bpts = backwardVideoFrames.first()->pts();
-				if ( backwardVideoFrames.first()->pts() <= inProfile.getStreamStartTime() )
-					backwardEof = true;
-			}
-			else if ( backwardAudioFrames.count() ) {
-				bpts = backwardAudioFrames.first()->bufPts;
-				if ( backwardAudioFrames.first()->bufPts <= inProfile.getStreamStartTime() )
-					backwardEof = true;
+		// the next GOP is started when the previous one is handed out
+		if ( endVideoSequence && endAudioSequence && playoutVideoFrames.isEmpty() ) {
+			if ( lastSegment ) {
+				eofVideo = true;
+				while ( running && !flushAudio() )
+					usleep( 1000 );
+				eofAudio = true;
+				printf("ff.run break\n");
+				break;
 			}
-			else
+
+			if ( backwardSegmentStart <= inProfile.getStreamStartTime() )
+				backwardEof = true;
+			if ( backwardVideoFrames.isEmpty() && backwardAudioFrames.isEmpty() )
 				backwardEof = true;
 
-			while ( !backwardVideoFrames.isEmpty() ) {
-				// resample if necessary
-				if ( videoResampler.repeat && lastFrame.valid() ) {
-					// duplicate previous frame
-					Frame *f = new Frame( NULL );
-					lastFrame.get( f, true );
-					videoResampler.duplicate( f, true );
-					f->mmi = mmi;
-					f->mmiProvider = mmiProvider;
-					reorderedVideoFrames.enqueue( f );
-				}
-				else {
-					Frame *f = backwardVideoFrames.takeLast();
-					mmiIncrement();
-					f->mmi = mmi;
-					f->mmiProvider = mmiProvider;
-					lastFrame.set( f );
-					resampleBackward( f );
-				}
-				bpts = videoResampler.outputPts + videoResampler.outputDuration;
-			}
+			playoutVideoFrames = backwardVideoFrames;
+			backwardVideoFrames.clear();
 
 			// we don't want to freeze for ever in broken streams
-			if ( bpts >= backwardPts )
+			if ( backwardSegmentStart >= backwardPts )
 				backwardPts -= BACKWARDLEN / 2.0;
 			else
-				backwardPts = bpts;
+				backwardPts = backwardSegmentStart;
 
+			// audioRing reverses the samples
 			while ( !backwardAudioFrames.isEmpty() ) {
 				AudioFrame *af = backwardAudioFrames.takeLast();
 				if ( !af->available ) {
 					delete af;
 					continue;
 				}
-				int bps = audioFrameList.getBytesPerSample();
-				int size = af->available * bps;
-				Buffer *buffer = BufferPool::globalInstance()->getBuffer( size );
-				uint8_t *src = af->buffer->data() + af->bufOffset + size - bps;
-				uint8_t *dst = buffer->data();
-				af->bufSize = size;
-				af->bufOffset = 0;
-				while ( size ) {
-					memcpy( dst, src, bps );
-					src -= bps;
-					dst += bps;
-					size -= bps;
-				}
-				BufferPool::globalInstance()->releaseBuffer( af->buffer );
-				af->buffer = buffer;
-
-				audioFrameList.append( af );
+				reversedAudioFrames.append( af );
 			}
 			samplesInBackwardAudioFrames = 0;
+			flushAudio();
 
 			if ( backwardEof ) {
-				eofVideo = eofAudio = true;
-				printf("ff.run break\n");
-				break;
-			}
-			else {
-				double target = backwardPts - BACKWARDLEN;
-				if ( target <= inProfile.getStreamStartTime() ) {
-					target = inProfile.getStreamStartTime();
-					backwardEof = true;
-				}
-				Frame *f = new Frame( NULL );
-				AudioFrame *af = new AudioFrame( audioFrameList.getBytesPerSample(), outProfile.getAudioSampleRate() );
-				bool ok = decoder->seekTo( target, f, af );
-				if ( af->buffer ) {
-					backwardAudioSamples += af->available;
-					samplesInBackwardAudioFrames += af->available;
-					if ( !decoder->haveVideo && af->bufPts == 0 )
-						af->bufPts = target;
-					backwardAudioFrames.append( af );
-				}
-				else
-					delete af;
-				if ( ok && f->getBuffer() )
-					backwardVideoFrames.append( f );
-				else
-					delete f;
+				lastSegment = true;
+				doWait = 0;
+				continue;
 			}
-			endVideoSequence = !decoder->haveVideo;
-			endAudioSequence = !decoder->haveAudio;
+
+			bool ok = seekBackwardSegment();
+			endVideoSequence = !decoder->haveVideo || !ok;
+			endAudioSequence = !decoder->haveAudio || !ok;
 		}
 
 		if ( doWait ) {
@@ -523,6 +644,154 @@ void InputFF::runBackward()
 
 
 
+// Seeks to the keyframe starting the segment that ends at backwardPts,
+// and decodes its first frame. Segments never overlap.
+bool InputFF::seekBackwardSegment()
+{
+	double target = backwardPts - BACKWARDLEN;
+	int loop = 0, maxloop = 10;
+
+	while ( loop++ < maxloop ) {
+		double kf = decoder->keyframeBefore( target );
+		if ( kf >= 0 )
+			target = kf;
+		if ( target <= inProfile.getStreamStartTime() ) {
+			target = inProfile.getStreamStartTime();
+			backwardEof = true;
+		}
+
+		if ( !decoder->haveVideo ) {
+			AudioFrame *af = new AudioFrame( audioRing.getBytesPerSample(), outProfile.getAudioSampleRate() );
+			decoder->seekTo( target, NULL, af );
+			if ( af->buffer ) {
+				if ( af->bufPts == 0 )
+					af->bufPts = target;
+				samplesInBackwardAudioFrames += af->available;
+				backwardAudioFrames.append( af );
+			}
+			else
+				delete af;
+			backwardSegmentStart = target;
+			return true;
+		}
+
+		Frame *f = new Frame( NULL );
+		if ( decoder->seekKeyframe( target ) && decoder->decodeVideo( f ) && f->pts() < backwardPts ) {
+			backwardVideoFrames.append( f );
+			backwardSegmentStart = f->pts();
+			return true;
+		}
+		delete f;
+		if ( backwardEof )
+			break;
+		// the demuxer did not go back far enough
+		target -= BACKWARDLEN;
+	}
+
+	backwardEof = true;
+	return false;
+}
+
+
+
+// Drops the audio decoded before backwardSegmentStart.
+void InputFF::trimBackwardAudio()
+{
+	double oasr = outProfile.getAudioSampleRate();
+
+	while ( !backwardAudioFrames.isEmpty() ) {
+		AudioFrame *af = backwardAudioFrames.first();
+		int ns = qMin( (backwardSegmentStart - af->bufPts) * oasr / MICROSECOND, (double)af->available );
+		if ( ns <= 0 )
+			break;
+		af->available -= ns;
+		af->bufOffset += ns * af->bytesPerSample;
+		af->bufPts += (double)ns * MICROSECOND / oasr;
+		samplesInBackwardAudioFrames -= ns;
+		if ( af->available > 0 )
+			break;
+		delete backwardAudioFrames.takeFirst();
+	}
+}
+
+
+
+double InputFF::sourceFrameDuration()
+{
+	if ( decoder->doYadif > FFDecoder::Yadif1X )
+		return inProfile.getVideoFrameDuration() / 2.0;
+	return inProfile.getVideoFrameDuration();
+}
+
+
+
+// Interlaced frames left untouched by the decoder are deinterlaced by the composer,
+// it needs the field to show and the previous frame.
+void InputFF::setFields( Frame *f, bool backward )
+{
+	if ( decoder->doYadif || !glDeinterlace || !inProfile.getVideoInterlaced() )
+		return;
+
+	if ( backward ) {
+		// fields are shown in reverse order, without temporal check
+		f->setField( doubleFieldRate() ? Frame::SECONDFIELD : Frame::FIRSTFIELD );
+	}
+	else {
+		f->setField( Frame::FIRSTFIELD );
+		lastFrame.setPrevious( f );
+	}
+}
+
+
+
+// both fields are shown when deinterlaced by the composer
+bool InputFF::doubleFieldRate()
+{
+	return outProfile.getVideoFrameRate() > inProfile.getVideoFrameRate();
+}
+
+
+
+// Takes the next frame from FrameCache while possible,
+// decoding resumes at the first miss.
+bool InputFF::decodeVideoFrame( Frame *f )
+{
+	if ( cachedPts >= 0 ) {
+		double next = cachedPts + sourceFrameDuration();
+		if ( FrameCache::getGlobalInstance()->get( sourceName, decoder->doYadif, next, sourceFrameDuration() / 2.0, f ) ) {
+			cachedPts = f->pts();
+			return true;
+		}
+		cachedPts = -1;
+		return resumeDecoder( next, f );
+	}
+
+	if ( !decoder->decodeVideo( f ) )
+		return false;
+	FrameCache::getGlobalInstance()->insert( sourceName, decoder->doYadif, f );
+	return true;
+}
+
+
+
+bool InputFF::resumeDecoder( double p, Frame *f )
+{
+	AudioFrame *af = new AudioFrame( audioRing.getBytesPerSample(), outProfile.getAudioSampleRate() );
+	bool ok = decoder->seekTo( p, f, af ) && f->getBuffer();
+	delete af;
+	// audio has to continue where it was
+	if ( decoder->haveAudio )
+		audioSkipUntil = forwardStartPts + ((double)forwardAudioSamples * MICROSECOND / outProfile.getAudioSampleRate());
+	if ( !ok ) {
+		eofVideo = true;
+		return false;
+	}
+	FrameCache::getGlobalInstance()->insert( sourceName, decoder->doYadif, f );
+	return true;
+}
+
+
+
 void InputFF::resample( Frame *f )
 {
 	double duration = (decoder->doYadif > FFDecoder::Yadif1X) ? f->profile.getVideoFrameDuration() / 2.0 : f->profile.getVideoFrameDuration();
@@ -616,16 +885,16 @@ Frame* InputFF::getAudioFrame( int nSamples )
 
 	Frame *f = new Frame();
 
-	while ( !audioFrameList.readable( nSamples ) ) {
+	while ( !audioRing.readable( nSamples ) ) {
 		if ( eofAudio ) {
-			f->setAudioFrame( outProfile.getAudioChannels(), outProfile.getAudioSampleRate(), Profile::bytesPerChannel( &outProfile ), nSamples, audioFrameList.readPts() );
-			int n = audioFrameList.read( f->data() );
+			f->setAudioFrame( outProfile.getAudioChannels(), outProfile.getAudioSampleRate(), Profile::bytesPerChannel( &outProfile ), nSamples, audioRing.readPts() );
+			int n = audioRing.read( f->data() );
 			if ( !n ) {
 				delete f;
 				return NULL;
 			}
 			// complete with silence
-			memset( f->data() + ( n * audioFrameList.getBytesPerSample() ), 0, (nSamples - n) * audioFrameList.getBytesPerSample() );
+			memset( f->data() + ( n * audioRing.getBytesPerSample() ), 0, (nSamples - n) * audioRing.getBytesPerSample() );
 			f->audioReversed = speed < 0 ? !playBackward : playBackward;
 			return f;
 		}
@@ -633,8 +902,8 @@ Frame* InputFF::getAudioFrame( int nSamples )
 		usleep( 1000 );
 	}
 
-	f->setAudioFrame( outProfile.getAudioChannels(), outProfile.getAudioSampleRate(), Profile::bytesPerChannel( &outProfile ), nSamples, audioFrameList.readPts() );
-	audioFrameList.read( f->data(), nSamples );
+	f->setAudioFrame( outProfile.getAudioChannels(), outProfile.getAudioSampleRate(), Profile::bytesPerChannel( &outProfile ), nSamples, audioRing.readPts() );
+	audioRing.read( f->data(), nSamples );
 	f->audioReversed = speed < 0 ? !playBackward : playBackward;
 
 	return f;
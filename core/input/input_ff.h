@@ -5,6 +5,7 @@
 
 #include <QString>
 #include <QSemaphore>
+#include <QAtomicInt>
 
 #include "input.h"
 #include "ffdecoder.h"
@@ -14,109 +15,173 @@
 
 
 
-class AudioFrameList
+// ring capacity, in multiples of maxSamples.
+#define AUDIORINGSIZE 4
+#define AUDIORINGMARKS 256
+
+
+
+// Interleaved audio samples written by the decoding thread and read by getAudioFrame.
+// Storage is only allocated in reset, read and write positions are atomic,
+// so there is no lock as long as there is a single reader and a single writer.
+// Each written segment records its pts, readPts() extrapolates from it.
+class AudioSampleRing
 {
 public:
-	AudioFrameList() : maxSamples( 11520 ),
+	AudioSampleRing() : buffer( NULL ),
+		capacity( 0 ),
+		maxSamples( 11520 ),
 		bytesPerSample( 4 ),
-		sampleRate( 48000 ) {
+		sampleRate( 48000 ),
+		readPos( 0 ),
+		writePos( 0 ),
+		markCount( 0 ),
+		markRead( 0 ),
+		written( 0 ),
+		consumed( 0 ) {
 	}
-	~AudioFrameList() {
-		while ( !list.isEmpty() )
-			delete list.takeFirst();
+	~AudioSampleRing() {
+		if ( buffer )
+			BufferPool::globalInstance()->releaseBuffer( buffer );
 	}
+	// reader and writer must be idle
 	void reset( Profile p ) {
-		QMutexLocker ml( &mutex );
-		while ( !list.isEmpty() )
-			delete list.takeFirst();
-		bytesPerSample = Profile::bytesPerChannel( &p ) * p.getAudioChannels();
+		int bps = Profile::bytesPerChannel( &p ) * p.getAudioChannels();
 		sampleRate = p.getAudioSampleRate();
 		double fps = qMax(p.getVideoFrameRate(), 1.0);
 		maxSamples = (((double)sampleRate / fps) + 1) * NUMINPUTFRAMES;
+		// one slot is always kept free to tell full from empty
+		int cap = maxSamples * AUDIORINGSIZE + 1;
+		if ( !buffer || cap != capacity || bps != bytesPerSample ) {
+			if ( buffer )
+				BufferPool::globalInstance()->releaseBuffer( buffer );
+			capacity = cap;
+			bytesPerSample = bps;
+			buffer = BufferPool::globalInstance()->getBuffer( capacity * bytesPerSample );
+		}
+		readPos.storeRelease( 0 );
+		writePos.storeRelease( 0 );
+		markCount.storeRelease( 0 );
+		markRead.storeRelease( 0 );
+		written = consumed = 0;
+	}
+	int available() {
+		int n = writePos.loadAcquire() - readPos.loadAcquire();
+		return n < 0 ? n + capacity : n;
 	}
 	bool readable( int nSamples ) {
-		QMutexLocker ml( &mutex );
-		int ns = 0;
-		for ( int i = 0; i < list.count(); ++i ) {
-			ns += list[i]->available;
-			if ( ns >= nSamples )
-				return true;
-		}
-		return false;
+		return available() >= nSamples;
 	}
 	bool writable() {
-		QMutexLocker ml( &mutex );
-		int ns = 0;
-		for ( int i = 0; i < list.count(); ++i ) {
-			ns += list[i]->available;
-		}
-		return ns < maxSamples;
+		return available() < maxSamples;
 	}
-	void read( uint8_t *dst, int nSamples ) {
-		QMutexLocker ml( &mutex );
-		uint8_t *d = dst;
-		while ( nSamples > 0 ) {
-			bool shift = false;
-			AudioFrame *frame = list.first();
-			int ns = frame->available;
-			if ( ns > nSamples ) {
-				ns = nSamples;
-				shift = true;
-			}
-			int blen = ns * bytesPerSample;
-			memcpy( d, frame->buffer->data() + frame->bufOffset, blen );
-			if ( shift ) {
-				frame->bufOffset += blen;
-				frame->available -= ns;
-				frame->bufPts += (double)ns * MICROSECOND / (double)sampleRate;
-				return;
+	// writes as much as possible of src, returns the number of samples written.
+	// If reversed, samples are taken from the end of src.
+	int write( const uint8_t *src, int nSamples, double pts, bool reversed = false ) {
+		int n = qMin( nSamples, capacity - 1 - available() );
+		if ( n <= 0 )
+			return 0;
+		addMark( pts );
+		int wp = writePos.loadAcquire();
+		uint8_t *data = buffer->data();
+		if ( reversed ) {
+			const uint8_t *s = src + ( nSamples - 1 ) * bytesPerSample;
+			for ( int i = 0; i < n; ++i ) {
+				memcpy( data + wp * bytesPerSample, s, bytesPerSample );
+				s -= bytesPerSample;
+				if ( ++wp == capacity )
+					wp = 0;
 			}
-			delete list.takeFirst();
-			nSamples -= ns;
-			d += blen;
 		}
+		else {
+			int first = qMin( n, capacity - wp );
+			memcpy( data + wp * bytesPerSample, src, first * bytesPerSample );
+			if ( n > first )
+				memcpy( data, src + first * bytesPerSample, ( n - first ) * bytesPerSample );
+			wp = ( wp + n ) % capacity;
+		}
+		written += n;
+		writePos.storeRelease( wp );
+		return n;
 	}
-	double readPts() {
-		QMutexLocker ml( &mutex );
-		if ( list.isEmpty() )
+	int writeSilence( int nSamples, double pts ) {
+		int n = qMin( nSamples, capacity - 1 - available() );
+		if ( n <= 0 )
+			return 0;
+		addMark( pts );
+		int wp = writePos.loadAcquire();
+		int first = qMin( n, capacity - wp );
+		memset( buffer->data() + wp * bytesPerSample, 0, first * bytesPerSample );
+		if ( n > first )
+			memset( buffer->data(), 0, ( n - first ) * bytesPerSample );
+		written += n;
+		writePos.storeRelease( ( wp + n ) % capacity );
+		return n;
+	}
+	// reads at most nSamples, returns the number of samples read
+	int read( uint8_t *dst, int nSamples ) {
+		int n = qMin( nSamples, available() );
+		if ( n <= 0 )
 			return 0;
-		return list.first()->bufPts;
+		int rp = readPos.loadAcquire();
+		int first = qMin( n, capacity - rp );
+		memcpy( dst, buffer->data() + rp * bytesPerSample, first * bytesPerSample );
+		if ( n > first )
+			memcpy( dst + first * bytesPerSample, buffer->data(), ( n - first ) * bytesPerSample );
+		consumed += n;
+		readPos.storeRelease( ( rp + n ) % capacity );
+		return n;
 	}
 	int read( uint8_t *dst ) { // reads all available samples
-		QMutexLocker ml( &mutex );
-		uint8_t *d = dst;
-		int nSamples = 0;
-		while ( !list.isEmpty() ) {
-			AudioFrame *frame = list.takeFirst();
-			int ns = frame->available;
-			int blen = ns * bytesPerSample;
-			memcpy( d, frame->buffer->data() + frame->bufOffset, blen );
-			nSamples += ns;
-			d += blen;
-			delete frame;
-		}
-		return nSamples;
+		return read( dst, available() );
+	}
+	double readPts() {
+		int count = markCount.loadAcquire();
+		if ( !count )
+			return 0;
+		int mr = markRead.loadAcquire();
+		while ( mr < count - 1 && marks[( mr + 1 ) % AUDIORINGMARKS].start <= consumed )
+			++mr;
+		markRead.storeRelease( mr );
+		const AudioMark &m = marks[mr % AUDIORINGMARKS];
+		return m.pts + (double)( consumed - m.start ) * MICROSECOND / (double)sampleRate;
 	}
 	int getBytesPerSample() {
 		return bytesPerSample;
 	}
-	void append( AudioFrame *af ) {
-		QMutexLocker ml( &mutex );
-		list.append( af );
-	}
-	int count() {
-		QMutexLocker ml( &mutex );
-		return list.count();
-	}
 
 private:
-	QList<AudioFrame*> list;
+	class AudioMark
+	{
+	public:
+		qint64 start;
+		double pts;
+	};
+
+	void addMark( double pts ) {
+		int count = markCount.loadAcquire();
+		// if the reader is late, keep extrapolating from the previous mark
+		if ( count - markRead.loadAcquire() >= AUDIORINGMARKS )
+			return;
+		AudioMark &m = marks[count % AUDIORINGMARKS];
+		m.start = written;
+		m.pts = pts;
+		markCount.storeRelease( count + 1 );
+	}
+
+	Buffer *buffer;
+	int capacity;
 	int maxSamples;
 
 	int bytesPerSample;
 	int sampleRate;
 
-	QMutex mutex;
+	QAtomicInt readPos, writePos, markCount, markRead;
+	// writer side
+	qint64 written;
+	// reader side
+	qint64 consumed;
+	AudioMark marks[AUDIORINGMARKS];
 };
 
 
@@ -124,24 +189,39 @@ private:
 class LastDecodedFrame
 {
 public:
-	LastDecodedFrame() : buffer(NULL), type(0), pts(0), orientation(0) {}
+	LastDecodedFrame() : buffer(NULL), previous(NULL), type(0), pts(0), orientation(0), field(Frame::NOFIELD) {}
 	~LastDecodedFrame() {
 		if ( buffer )
 			BufferPool::globalInstance()->releaseBuffer( buffer );
+		if ( previous )
+			BufferPool::globalInstance()->releaseBuffer( previous );
 	}
 	void set( Frame *f ) {
 		if ( buffer )
 			BufferPool::globalInstance()->releaseBuffer( buffer );
-		buffer = NULL;
+		if ( previous )
+			BufferPool::globalInstance()->releaseBuffer( previous );
+		buffer = previous = NULL;
 		if ( f ) {
 			buffer = f->getBuffer();
 			BufferPool::globalInstance()->useBuffer( buffer );
+			previous = f->previousBuffer();
+			if ( previous )
+				BufferPool::globalInstance()->useBuffer( previous );
 			profile = f->profile;
 			type = f->type();
 			pts = f->pts();
 			orientation = f->orientation();
+			field = f->field();
 		}
 	}
+	// gives our data as previous frame of f, if f follows it
+	void setPrevious( Frame *f ) {
+		double d = f->pts() - pts;
+		if ( buffer && type == f->type() && d > 0 && d < profile.getVideoFrameDuration() * 1.5
+			&& profile.getVideoWidth() == f->profile.getVideoWidth() && profile.getVideoHeight() == f->profile.getVideoHeight() )
+			f->setPreviousBuffer( buffer );
+	}
 	void get( Frame *f, bool backward = false ) {
 		Q_UNUSED( backward );
 		if ( buffer )
@@ -153,15 +233,19 @@ public:
 		f->setVideoFrame( (Frame::DataType)type, profile.getVideoWidth(), profile.getVideoHeight(), profile.getVideoSAR(),
 						  profile.getVideoInterlaced(), profile.getVideoTopFieldFirst(), pts, profile.getVideoFrameDuration(), orientation );
 		f->profile = profile;
+		f->setField( field );
+		f->setPreviousBuffer( previous );
 	}
 	bool valid() { return buffer != NULL; }
 
 private:
 	Buffer *buffer;
+	Buffer *previous;
 	int type;
 	double pts;
 	Profile profile;
 	int orientation;
+	int field;
 };
 
 
@@ -223,22 +307,37 @@ public:
 	Frame *getAudioFrame( int nSamples );
 
 	bool probe( QString fn, Profile *prof );
+	// SeekCancelable seeks in progress return the frame they have reached
+	static void cancelSeeks() { seekGeneration.ref(); }
+	// decoder statistics, read while the input is stopped
+	int decodedVideoFrames() { return decoder->decodedVideoFrames; }
+	int skippedVideoPackets() { return decoder->skippedVideoPackets; }
 
 	void setProfile( const Profile &in, const Profile &out ) {
 		InputBase::setProfile( in, out );
-		decoder->setProfile( in, out );
-		audioFrameList.reset( out );
+		decoder->setProfile( in, out, glDeinterlace );
 	}
 
 	void osp( QString fn, double p, bool backward );
+	void suspendVideo();
+	void resumeVideo( double p );
+	void rv( double p );
 
 protected:
 	void run();
 
 private:
 	void flush();
+	bool flushAudio();
 	void resample( Frame *f );
 	void resampleBackward( Frame *f );
+	double sourceFrameDuration();
+	void setFields( Frame *f, bool backward );
+	bool doubleFieldRate();
+	bool decodeVideoFrame( Frame *f );
+	bool resumeDecoder( double p, Frame *f );
+	bool seekBackwardSegment();
+	void trimBackwardAudio();
 
 	void runForward();
 	void runBackward();
@@ -253,23 +352,40 @@ private:
 	QString seekAndPlayPath;
 	bool seekAndPlay;
 
-	QList<Frame*> backwardVideoFrames;
+	bool videoSuspended;
+	bool resumeVideoPending;
+	double resumeVideoPts;
+
+	// the GOP being decoded, and the previous one handed out while it is
+	QList<Frame*> backwardVideoFrames, playoutVideoFrames;
 	MQueue<Frame*> reorderedVideoFrames;
 	QList<AudioFrame*> backwardAudioFrames;
 	int forwardAudioSamples;
 	double forwardStartPts;
-	int backwardAudioSamples;
 	int samplesInBackwardAudioFrames;
 	bool playBackward;
-	double backwardPts, backwardStartPts;
+	// the segment being decoded is [backwardSegmentStart, backwardPts[
+	double backwardPts, backwardSegmentStart;
 	bool backwardEof;
 
+	// pts of the last frame taken from FrameCache, -1 when decoding
+	double cachedPts;
+	// decoded audio before this pts is dropped, -1 if none
+	double audioSkipUntil;
+
 	LastDecodedFrame lastFrame;
 	VideoResampler videoResampler;
 
-	AudioFrameList audioFrameList;
+	AudioSampleRing audioRing;
+	// decoded samples that did not fit in audioRing yet
+	AudioFrame *decodedAudio;
+	int pendingSilence;
+	double pendingSilencePts;
+	QList<AudioFrame*> reversedAudioFrames;
 
 	bool eofVideo, eofAudio;
+
+	static QAtomicInt seekGeneration;
 };
 
 #endif // INPUTFF_H
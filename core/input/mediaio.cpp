@@ -0,0 +1,352 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QDateTime>
+
+#include "mediaio.h"
+
+
+
+MediaIO::MediaIO()
+	: fd( -1 ),
+	map( NULL ),
+	size( 0 ),
+	pos( 0 ),
+	prefetchStart( 0 ),
+	prefetchEnd( 0 ),
+	prefetchGeneration( 0 ),
+	avio( NULL )
+{
+}
+
+
+
+// a mapped page of a remote file raises SIGBUS on a network error
+static bool isLocalFilesystem( int fd )
+{
+	struct statfs st;
+	if ( fstatfs( fd, &st ) != 0 )
+		return false;
+
+	switch ( (quint32)st.f_type ) {
+		case 0x6969: // NFS
+		case 0x517B: // SMB
+		case 0xFF534D42: // CIFS
+		case 0xFE534D42: // SMB2
+		case 0x65735546: // FUSE (sshfs...)
+		case 0x73757245: // CODA
+		case 0x5346414F: // AFS
+		case 0x00C36400: // CEPH
+		case 0x01161970: // GFS2
+		case 0x47504653: // GPFS
+		case 0x0BD00BD0: // LUSTRE
+			return false;
+	}
+	return true;
+}
+
+
+
+MediaIO* MediaIO::open( QString fn )
+{
+	QFileInfo fi( fn );
+	if ( !fi.isFile() || fi.size() <= 0 )
+		return NULL;
+	if ( fi.lastModified().secsTo( QDateTime::currentDateTime() ) < MEDIAIOGROWING )
+		return NULL;
+
+	int fd = ::open( QFile::encodeName( fn ).constData(), O_RDONLY );
+	if ( fd < 0 )
+		return NULL;
+	if ( !isLocalFilesystem( fd ) ) {
+		::close( fd );
+		return NULL;
+	}
+
+	void *m = mmap( NULL, fi.size(), PROT_READ, MAP_SHARED, fd, 0 );
+	if ( m == MAP_FAILED ) {
+		::close( fd );
+		return NULL;
+	}
+	madvise( m, fi.size(), MADV_SEQUENTIAL );
+
+	MediaIO *io = new MediaIO();
+	io->source = fn;
+	io->fd = fd;
+	io->map = (uint8_t*)m;
+	io->size = fi.size();
+
+	uint8_t *buf = (uint8_t*)av_malloc( MEDIAIOBUFFER );
+	if ( !buf ) {
+		delete io;
+		return NULL;
+	}
+	io->avio = avio_alloc_context( buf, MEDIAIOBUFFER, 0, io, readPacket, NULL, seekPacket );
+	if ( !io->avio ) {
+		av_free( buf );
+		delete io;
+		return NULL;
+	}
+
+	MediaIOPool::getGlobalInstance()->request( io, 0 );
+	return io;
+}
+
+
+
+MediaIO::~MediaIO()
+{
+	MediaIOPool::getGlobalInstance()->cancel( this );
+
+	if ( avio ) {
+		av_freep( &avio->buffer );
+		av_free( avio );
+	}
+	if ( map )
+		munmap( map, size );
+	if ( fd >= 0 )
+		::close( fd );
+}
+
+
+
+int MediaIO::readPacket( void *opaque, uint8_t *buf, int bufSize )
+{
+	MediaIO *io = (MediaIO*)opaque;
+	MediaIOPool *pool = MediaIOPool::getGlobalInstance();
+	// only this thread writes pos
+	qint64 pos = io->pos;
+
+	if ( pos >= io->size )
+		return AVERROR_EOF;
+
+	int n = qMin( (qint64)bufSize, io->size - pos );
+	if ( io->truncated( pos + n ) )
+		return AVERROR_EOF;
+	qint64 stall = 0;
+
+	pool->mutex.lock();
+	bool ready = pos >= io->prefetchStart && pos + n <= io->prefetchEnd;
+	pool->mutex.unlock();
+
+	if ( ready ) {
+		memcpy( buf, io->map + pos, n );
+	}
+	else {
+		// page faults hit the disk on this thread
+		QElapsedTimer timer;
+		timer.start();
+		memcpy( buf, io->map + pos, n );
+		stall = timer.nsecsElapsed() / 1000;
+	}
+
+	pool->request( io, pos + n );
+	pool->addStats( io->source, n, stall );
+
+	return n;
+}
+
+
+
+int64_t MediaIO::seekPacket( void *opaque, int64_t offset, int whence )
+{
+	MediaIO *io = (MediaIO*)opaque;
+
+	switch ( whence & ~AVSEEK_FORCE ) {
+		case AVSEEK_SIZE:
+			return io->size;
+		case SEEK_SET:
+			break;
+		case SEEK_CUR:
+			offset += io->pos;
+			break;
+		case SEEK_END:
+			offset += io->size;
+			break;
+		default:
+			return -1;
+	}
+
+	if ( offset < 0 )
+		return -1;
+
+	offset = qMin( (qint64)offset, io->size );
+	MediaIOPool::getGlobalInstance()->request( io, offset );
+
+	return offset;
+}
+
+
+
+bool MediaIO::truncated( qint64 end )
+{
+	struct stat st;
+	return fstat( fd, &st ) != 0 || st.st_size < end;
+}
+
+
+
+static MediaIOPool globalMediaIOPool;
+
+
+
+MediaIOPool* MediaIOPool::getGlobalInstance()
+{
+	return &globalMediaIOPool;
+}
+
+
+
+MediaIOPool::MediaIOPool()
+	: running( true )
+{
+}
+
+
+
+MediaIOPool::~MediaIOPool()
+{
+	mutex.lock();
+	running = false;
+	wakeUp.wakeAll();
+	mutex.unlock();
+
+	for ( int i = 0; i < workers.count(); ++i ) {
+		workers[i]->wait();
+		delete workers[i];
+	}
+}
+
+
+
+void MediaIOPool::request( MediaIO *io, qint64 pos )
+{
+	QMutexLocker ml( &mutex );
+	io->pos = pos;
+
+	// restart read ahead after a seek
+	if ( io->pos < io->prefetchStart || io->pos > io->prefetchEnd ) {
+		io->prefetchStart = io->prefetchEnd = io->pos;
+		++io->prefetchGeneration;
+	}
+
+	if ( io->prefetchEnd >= io->size || io->prefetchEnd - io->pos > MEDIAIOREADAHEAD / 2 )
+		return;
+
+	if ( !queue.contains( io ) )
+		queue.append( io );
+
+	if ( workers.isEmpty() ) {
+		for ( int i = 0; i < MEDIAIOTHREADS; ++i ) {
+			workers.append( new MediaIOWorker( this ) );
+			workers.last()->start();
+		}
+	}
+	wakeUp.wakeOne();
+}
+
+
+
+void MediaIOPool::cancel( MediaIO *io )
+{
+	QMutexLocker ml( &mutex );
+
+	queue.removeAll( io );
+	while ( busy.contains( io ) )
+		done.wait( &mutex );
+}
+
+
+
+// called with mutex locked
+MediaIO* MediaIOPool::nextRequest( qint64 &from, qint64 &to )
+{
+	MediaIO *io = NULL;
+	int index = -1;
+
+	for ( int i = 0; i < queue.count(); ++i ) {
+		MediaIO *q = queue[i];
+		if ( busy.contains( q ) )
+			continue;
+		if ( !io || (q->prefetchEnd - q->pos) < (io->prefetchEnd - io->pos) ) {
+			io = q;
+			index = i;
+		}
+	}
+	if ( !io )
+		return NULL;
+
+	from = io->prefetchEnd;
+	to = qMin( qMin( from + MEDIAIOCHUNK, io->pos + MEDIAIOREADAHEAD ), io->size );
+	if ( to <= from ) {
+		queue.removeAt( index );
+		return nextRequest( from, to );
+	}
+
+	return io;
+}
+
+
+
+void MediaIOPool::work()
+{
+	long pageSize = sysconf( _SC_PAGESIZE );
+
+	mutex.lock();
+	while ( running ) {
+		qint64 from, to;
+		MediaIO *io = nextRequest( from, to );
+		if ( !io ) {
+			wakeUp.wait( &mutex );
+			continue;
+		}
+
+		busy.append( io );
+		int generation = io->prefetchGeneration;
+		mutex.unlock();
+
+		// read the pages in this thread, the demuxer will find them in the page cache
+		bool truncated = io->truncated( to );
+		if ( !truncated ) {
+			qint64 start = from - (from % pageSize);
+			madvise( io->map + start, to - start, MADV_WILLNEED );
+			volatile uint8_t sum = 0;
+			for ( qint64 i = from; i < to; i += pageSize )
+				sum += io->map[i];
+			sum += io->map[to - 1];
+		}
+
+		mutex.lock();
+		if ( truncated )
+			queue.removeAll( io );
+		else if ( io->prefetchGeneration == generation )
+			io->prefetchEnd = to;
+		busy.removeOne( io );
+		done.wakeAll();
+	}
+	mutex.unlock();
+}
+
+
+
+void MediaIOPool::addStats( QString source, qint64 bytes, qint64 stall )
+{
+	QMutexLocker ml( &statsMutex );
+	MediaIOStats &s = stats[source];
+	s.bytesRead += bytes;
+	s.stallTime += stall;
+}
+
+
+
+MediaIOStats MediaIOPool::getStats( QString source )
+{
+	QMutexLocker ml( &statsMutex );
+	return stats.value( source );
+}
@@ -0,0 +1,125 @@
+#ifndef MEDIAIO_H
+#define MEDIAIO_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "output/common_ff.h"
+
+// size of the libavformat read buffer
+#define MEDIAIOBUFFER 64 * 1024
+// data read ahead of the demuxer
+#define MEDIAIOREADAHEAD 16 * 1024 * 1024
+// read ahead granularity, the most urgent input is served between chunks
+#define MEDIAIOCHUNK 1024 * 1024
+#define MEDIAIOTHREADS 2
+// files modified more recently (s) may still be written, they are left to the default I/O
+#define MEDIAIOGROWING 10
+
+
+
+class MediaIOStats
+{
+public:
+	MediaIOStats() : bytesRead( 0 ), stallTime( 0 ) {}
+
+	qint64 bytesRead;
+	// time (µs) spent by the demuxer waiting for data not read ahead
+	qint64 stallTime;
+};
+
+
+
+// Custom AVIOContext for local files.
+// The file is mapped in memory and pages ahead of the demuxer are read
+// by the MediaIOPool threads, so the decoding thread rarely waits for the disk.
+// The size is checked before touching the map, a truncated file reads as EOF
+// instead of raising SIGBUS.
+class MediaIO
+{
+public:
+	// returns NULL if fn is not a file of a local filesystem that can be mapped
+	static MediaIO* open( QString fn );
+	~MediaIO();
+
+	AVIOContext* context() { return avio; }
+
+private:
+	friend class MediaIOPool;
+
+	MediaIO();
+	static int readPacket( void *opaque, uint8_t *buf, int size );
+	static int64_t seekPacket( void *opaque, int64_t offset, int whence );
+	bool truncated( qint64 end );
+
+	QString source;
+	int fd;
+	uint8_t *map;
+	qint64 size;
+	// written by the demuxer thread with the pool mutex locked
+	qint64 pos;
+
+	// [prefetchStart, prefetchEnd[ has been read ahead, protected by the pool mutex
+	qint64 prefetchStart;
+	qint64 prefetchEnd;
+	int prefetchGeneration;
+
+	AVIOContext *avio;
+};
+
+
+
+// Shared read ahead threads. Inputs with the fewest bytes ahead
+// of their demuxer, i.e. nearest to stall, are served first.
+class MediaIOPool
+{
+public:
+	MediaIOPool();
+	~MediaIOPool();
+	static MediaIOPool* getGlobalInstance();
+
+	// moves io to pos and reads ahead of it
+	void request( MediaIO *io, qint64 pos );
+	// returns when no thread is reading for io anymore
+	void cancel( MediaIO *io );
+	void addStats( QString source, qint64 bytes, qint64 stall );
+	// since the start of the application
+	MediaIOStats getStats( QString source );
+
+private:
+	friend class MediaIO;
+	friend class MediaIOWorker;
+
+	void work();
+	MediaIO* nextRequest( qint64 &from, qint64 &to );
+
+	QList<MediaIO*> queue;
+	QList<MediaIO*> busy;
+	QList<QThread*> workers;
+	QHash<QString, MediaIOStats> stats;
+	bool running;
+	QMutex mutex;
+	QMutex statsMutex;
+	QWaitCondition wakeUp;
+	QWaitCondition done;
+};
+
+
+
+class MediaIOWorker : public QThread
+{
+public:
+	MediaIOWorker( MediaIOPool *p ) : pool( p ) {}
+
+protected:
+	void run() { pool->work(); }
+
+private:
+	MediaIOPool *pool;
+};
+
+#endif // MEDIAIO_H
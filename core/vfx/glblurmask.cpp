@@ -23,9 +23,8 @@ GLBlurmask::~GLBlurmask()
 bool GLBlurmask::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
 {
 	Q_UNUSED( pts );
-	Q_UNUSED( src );
 	Q_UNUSED( p );
-	return el.at(0)->set_float( "radius", radius );
+	return el.at(0)->set_float( "radius", radius * src->glScale );
 }
 
 
@@ -33,16 +32,20 @@ bool GLBlurmask::process( const QList<Effect*> &el, double pts, Frame *src, Prof
 QList<Effect*> GLBlurmask::getMovitEffects()
 {
 	QList<Effect*> list;
-	list.append( new BlurEffectMask() );
+	list.append( new BlurEffectMask( quality() == DRAFTQUALITY ) );
 	return list;
 }
 
 
 
-BlurEffectMask::BlurEffectMask()
+BlurEffectMask::BlurEffectMask( bool draft )
 	: blur(new BlurEffect),
 	  maskfx(new MaskEffect)
 {
+	if ( draft ) {
+		bool ok = blur->set_int( "num_taps", 8 );
+		Q_UNUSED( ok );
+	}
 }
 
 void BlurEffectMask::rewrite_graph(EffectChain *graph, Node *self)
@@ -58,7 +58,7 @@ private:
 
 class BlurEffectMask : public Effect {
 public:
-	BlurEffectMask();
+	BlurEffectMask( bool draft = false );
 	std::string effect_type_id() const { return "BlurEffectMask"; }
 
 	bool needs_srgb_primaries() const { return false; }
@@ -90,6 +90,7 @@ public:
 	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
 
 	QList<Effect*> getMovitEffects();
+	bool hasDraftQuality() { return true; }
 
 public slots:
 	//QStringList getProperties();
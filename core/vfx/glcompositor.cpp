@@ -0,0 +1,87 @@
+#include "vfx/glcompositor.h"
+
+
+
+GLCompositor::GLCompositor( QString id, QString name ) : GLFilter( id, name ),
+	inputs( 2 )
+{
+	setInputs( inputs );
+}
+
+
+
+QString GLCompositor::getDescriptor( double pts, Frame *src, Profile *p )
+{
+	Q_UNUSED( pts );
+	Q_UNUSED( src );
+	Q_UNUSED( p );
+	return getIdentifier() + QString( " %1" ).arg( inputs );
+}
+
+
+
+bool GLCompositor::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
+{
+	Q_UNUSED( pts );
+	Q_UNUSED( src );
+	int ow = p->getVideoWidth();
+	int oh = p->getVideoHeight();
+	Effect *e = el[0];
+	bool ok = e->set_int( "width", ow )
+		&& e->set_int( "height", oh );
+
+	for ( int i = 0; i < placements.count(); ++i ) {
+		const CompositorPlacement &cp = placements[i];
+		float place[4] = { 1, 0, 1, 0 };
+		float clip[4] = { 0, 0, 1, 1 };
+		if ( cp.width > 0 ) {
+			// output texture coordinates to input ones, y goes up in movit
+			double sw = cp.transform.scaleX * cp.width;
+			double sh = cp.transform.scaleY * cp.height;
+			place[0] = ow / sw;
+			place[1] = -cp.transform.offsetX / sw;
+			place[2] = oh / sh;
+			place[3] = 1.0 - (oh - cp.transform.offsetY) / sh;
+			clip[0] = cp.visible.left() / ow;
+			clip[1] = 1.0 - cp.visible.bottom() / oh;
+			clip[2] = cp.visible.right() / ow;
+			clip[3] = 1.0 - cp.visible.top() / oh;
+		}
+		ok = ok && e->set_vec4( QString( "place%1" ).arg( i + 1 ).toLatin1().data(), place )
+			&& e->set_vec4( QString( "clip%1" ).arg( i + 1 ).toLatin1().data(), clip )
+			&& e->set_float( QString( "opacity%1" ).arg( i + 1 ).toLatin1().data(), cp.opacity );
+	}
+
+	return ok;
+}
+
+
+
+void GLCompositor::setInputs( int n )
+{
+	inputs = n;
+	placements.clear();
+	for ( int i = 0; i < inputs; ++i )
+		placements.append( CompositorPlacement() );
+}
+
+
+
+void GLCompositor::setPlacement( int i, double w, double h, const AxisTransform &t, const QRectF &visible, double opacity )
+{
+	CompositorPlacement &cp = placements[i];
+	cp.width = w;
+	cp.height = h;
+	cp.transform = t;
+	cp.visible = visible;
+	cp.opacity = opacity;
+}
+
+
+
+QList<Effect*> GLCompositor::getMovitEffects()
+{
+	QList<Effect*> list;
+	list.append( new MyCompositorEffect( inputs ) );
+	return list;
+}
@@ -0,0 +1,106 @@
+#ifndef GLCOMPOSITOR_H
+#define GLCOMPOSITOR_H
+
+#include <movit/effect_util.h>
+
+#include "vfx/glfilter.h"
+
+// inputs of a single compositor effect, more layers chain several ones
+#define MAXCOMPOSITORINPUTS 8
+
+
+
+// INPUT1 is the bottom layer, each following input is laid over
+// the result, like a stack of OverlayEffect in one pass.
+// Input i is sampled at tc * place.xz + place.yw inside its clip rect
+// (x1, y1, x2, y2) and multiplied by its opacity, so that plain layers
+// need no resample nor padding of their own.
+class MyCompositorEffect : public Effect {
+public:
+	MyCompositorEffect( int n ) : ninputs( n ), owidth( 1 ), oheight( 1 ) {
+		register_int( "width", &owidth );
+		register_int( "height", &oheight );
+		for ( int i = 0; i < ninputs; ++i ) {
+			place[i][0] = place[i][2] = 1;
+			place[i][1] = place[i][3] = 0;
+			clip[i][0] = clip[i][1] = 0;
+			clip[i][2] = clip[i][3] = 1;
+			opacity[i] = 1;
+			register_vec4( QString( "place%1" ).arg( i + 1 ).toLatin1().data(), place[i] );
+			register_vec4( QString( "clip%1" ).arg( i + 1 ).toLatin1().data(), clip[i] );
+			register_float( QString( "opacity%1" ).arg( i + 1 ).toLatin1().data(), &opacity[i] );
+		}
+	}
+	std::string effect_type_id() const { return "MyCompositorEffect"; }
+	std::string output_fragment_shader() {
+		QString s = "vec4 FUNCNAME( vec2 tc ) {\n"
+					"	vec4 result = vec4( 0.0 );\n"
+					"	vec4 top, p, c;\n";
+		for ( int i = 1; i <= ninputs; ++i ) {
+			s += QString( "	c = PREFIX(clip%1);\n" ).arg( i );
+			s += "	if ( tc.x >= c.x && tc.y >= c.y && tc.x <= c.z && tc.y <= c.w ) {\n";
+			s += QString( "		p = PREFIX(place%1);\n" ).arg( i );
+			s += QString( "		top = INPUT%1( vec2( tc.x * p.x + p.y, tc.y * p.z + p.w ) ) * PREFIX(opacity%1);\n" ).arg( i );
+			s += "		result = top + (1.0 - top.a) * result;\n"
+				"	}\n";
+		}
+		s += "	return result;\n"
+			"}\n";
+		return s.toLatin1().data();
+	}
+
+	unsigned num_inputs() const { return ninputs; }
+	AlphaHandling alpha_handling() const { return INPUT_PREMULTIPLIED_ALPHA_KEEP_BLANK; }
+	bool needs_texture_bounce() const { return true; }
+	bool changes_output_size() const { return true; }
+
+	void get_output_size( unsigned *width, unsigned *height, unsigned *virtual_width, unsigned *virtual_height ) const {
+		*virtual_width = *width = owidth;
+		*virtual_height = *height = oheight;
+	}
+
+private:
+	int ninputs;
+	int owidth, oheight;
+	float place[MAXCOMPOSITORINPUTS][4];
+	float clip[MAXCOMPOSITORINPUTS][4];
+	float opacity[MAXCOMPOSITORINPUTS];
+};
+
+
+
+class CompositorPlacement
+{
+public:
+	CompositorPlacement() : width( 0 ), height( 0 ), opacity( 1 ) {}
+
+	// input size, 0 if the input is not placed
+	double width, height;
+	AxisTransform transform;
+	// in output pixels
+	QRectF visible;
+	double opacity;
+};
+
+
+
+class GLCompositor : public GLFilter
+{
+public:
+	GLCompositor( QString id = "CompositorAuto", QString name = "CompositorAuto" );
+
+	QString getDescriptor( double pts, Frame *src, Profile *p );
+	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
+	void setInputs( int n );
+	// Input i, of size w x h, is transformed by t, clipped to visible
+	// and multiplied by opacity. Inputs not placed are already at the
+	// output size, see GLGeometry::getPlacement.
+	void setPlacement( int i, double w, double h, const AxisTransform &t, const QRectF &visible, double opacity );
+	QList<Effect*> getMovitEffects();
+
+private:
+	int inputs;
+	QList<CompositorPlacement> placements;
+};
+
+#endif //GLCOMPOSITOR_H
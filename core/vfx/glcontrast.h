@@ -39,6 +39,7 @@ public:
 	GLContrast( QString id, QString name );
 	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
 	QList<Effect*> getMovitEffects();
+	bool keepsFrameOpaque( double ) { return true; }
 
 private:
 	Parameter *contrast, *brightness;
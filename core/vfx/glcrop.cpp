@@ -43,22 +43,43 @@ QString GLCrop::getDescriptor( double pts, Frame *src, Profile *p )
 
 
 
-bool GLCrop::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
+void GLCrop::getTransform( double pts, Frame *src, Profile *p, AxisTransform &t )
 {
 	double glw = src->glWidth;
 	double glh = src->glHeight;
 
 	preProcess( pts, src, p );
-	Effect *e = el[0];
 	
 	if ( src->glOVD ) {
 		src->glOVDTransformList.append( FilterTransform( FilterTransform::TRANSLATE, (glw - src->glWidth) / 2.0 - pleft, (glh - src->glHeight) / 2.0 - ptop ) );
 	}
 
+	t.offsetX = -pleft;
+	t.offsetY = -ptop;
+}
+
+
+
+bool GLCrop::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
+{
+	AxisTransform t;
+	getTransform( pts, src, p, t );
+	Effect *e = el[0];
+
 	return e->set_int( "width", src->glWidth )
 		&& e->set_int( "height", src->glHeight )
-		&& e->set_float( "top", -ptop )
-		&& e->set_float( "left", -pleft );
+		&& e->set_float( "top", t.offsetY )
+		&& e->set_float( "left", t.offsetX );
+}
+
+
+
+bool GLCrop::keepsFrameOpaque( double pts )
+{
+	return getParamValue( left, pts ).toDouble() == 0.0
+		&& getParamValue( right, pts ).toDouble() == 0.0
+		&& getParamValue( top, pts ).toDouble() == 0.0
+		&& getParamValue( bottom, pts ).toDouble() == 0.0;
 }
 
 
@@ -15,6 +15,9 @@ public:
 	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
 
 	QList<Effect*> getMovitEffects();
+	bool keepsFrameOpaque( double pts );
+	bool isAxisAligned() { return true; }
+	void getTransform( double pts, Frame *src, Profile *p, AxisTransform &t );
 	
 private:
 	void preProcess( double pts, Frame *src, Profile *p );
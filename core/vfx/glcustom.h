@@ -67,6 +67,7 @@ public:
 	virtual bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
 	virtual QString getDescriptor( double pts, Frame *src, Profile *p );
 	virtual QString getFilterName();
+	bool isAnimated( double ) { return true; }
 
 	virtual QList<Effect*> getMovitEffects();
 	
@@ -22,11 +22,10 @@ GLDeconvolutionSharpen::~GLDeconvolutionSharpen()
 
 bool GLDeconvolutionSharpen::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
 {
-	Q_UNUSED( src );
 	Q_UNUSED( p );
 	Effect *e = el[0];
-	return e->set_float( "circle_radius", getParamValue( circleRadius, pts ).toFloat() )
-		&& e->set_float( "gaussian_radius", getParamValue( gaussianRadius, pts ).toFloat() )
+	return e->set_float( "circle_radius", getParamValue( circleRadius, pts ).toFloat() * src->glScale )
+		&& e->set_float( "gaussian_radius", getParamValue( gaussianRadius, pts ).toFloat() * src->glScale )
 		&& e->set_float( "correlation", getParamValue( correlation, pts ).toFloat() )
 		&& e->set_float( "noise", getParamValue( noise, pts ).toFloat() );
 }
@@ -36,7 +35,7 @@ bool GLDeconvolutionSharpen::process( const QList<Effect*> &el, double pts, Fram
 QList<Effect*> GLDeconvolutionSharpen::getMovitEffects()
 {
 	Effect *e = new DeconvolutionSharpenEffect();
-	bool ok = e->set_int( "matrix_size", getParamValue( R ).toInt() );
+	bool ok = e->set_int( "matrix_size", matrixSize() );
 	Q_UNUSED( ok );
 	QList<Effect*> list;
 	list.append( e );
@@ -50,5 +49,16 @@ QString GLDeconvolutionSharpen::getDescriptor( double pts, Frame *src, Profile *
 	Q_UNUSED( pts );
 	Q_UNUSED( src );
 	Q_UNUSED( p );
-	return QString("%1 %2").arg( getIdentifier() ).arg( getParamValue( R ).toInt() );
+	return QString("%1 %2").arg( getIdentifier() ).arg( matrixSize() );
+}
+
+
+
+// a smaller matrix in draft
+int GLDeconvolutionSharpen::matrixSize()
+{
+	int r = getParamValue( R ).toInt();
+	if ( quality() == DRAFTQUALITY )
+		return qMin( r, 2 );
+	return r;
 }
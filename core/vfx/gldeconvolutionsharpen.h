@@ -15,8 +15,11 @@ public:
 
 	QList<Effect*> getMovitEffects();
 	QString getDescriptor( double pts, Frame *src, Profile *p  );
+	bool hasDraftQuality() { return true; }
 	
 private:
+	int matrixSize();
+
 	Parameter *R;
 	Parameter *circleRadius, *gaussianRadius, *correlation, *noise;
 };
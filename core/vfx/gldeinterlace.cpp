@@ -0,0 +1,56 @@
+#include "gldeinterlace.h"
+
+
+
+bool GLDeinterlace::enabled = true;
+
+
+
+GLDeinterlace::GLDeinterlace( QString id, QString name ) : GLFilter( id, name ),
+	temporal( false )
+{
+}
+
+
+
+GLDeinterlace::~GLDeinterlace()
+{
+}
+
+
+
+QString GLDeinterlace::getDescriptor( double pts, Frame *src, Profile *p )
+{
+	Q_UNUSED( pts );
+	Q_UNUSED( p );
+	temporal = src->previousBuffer() != NULL;
+
+	return getIdentifier() + (temporal ? "Temporal" : "Spatial");
+}
+
+
+
+bool GLDeinterlace::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
+{
+	Q_UNUSED( pts );
+	Q_UNUSED( p );
+	Effect *e = el[0];
+	return e->set_float( "top_first", src->profile.getVideoTopFieldFirst() )
+		&& e->set_float( "second", src->field() == Frame::SECONDFIELD );
+}
+
+
+
+void GLDeinterlace::setTemporal( bool b )
+{
+	temporal = b;
+}
+
+
+
+QList<Effect*> GLDeinterlace::getMovitEffects()
+{
+	QList<Effect*> list;
+	list.append( new MyDeinterlaceEffect( temporal ) );
+	return list;
+}
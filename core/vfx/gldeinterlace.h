@@ -0,0 +1,118 @@
+#ifndef GLDEINTERLACE_H
+#define GLDEINTERLACE_H
+
+#include <movit/effect_util.h>
+#include <movit/effect_chain.h>
+#include <movit/util.h>
+
+#include "vfx/glfilter.h"
+
+
+
+// Lines of the shown field are kept, the others are interpolated along
+// the direction of least difference (ELA). With TEMPORAL, the previous frame
+// is INPUT2 and the interpolation is clamped around the other field,
+// like yadif does, so still areas get full resolution.
+static const char *MyDeinterlaceEffect_shader=
+"uniform vec2 PREFIX(one_div_size);\n"
+"vec4 FUNCNAME( vec2 tc ) {\n"
+"	float xof = PREFIX(one_div_size).x;\n"
+"	float yof = PREFIX(one_div_size).y;\n"
+"	// line number from the top, top field lines are even\n"
+"	float line = floor( (1.0 - tc.y) / yof );\n"
+"	float parity = PREFIX(top_first) > 0.5 ? PREFIX(second) : 1.0 - PREFIX(second);\n"
+"	vec4 c = CURRENT( tc );\n"
+"	if ( abs( mod( line, 2.0 ) - parity ) < 0.5 )\n"
+"		return c;\n"
+"	vec4 a = CURRENT( vec2( tc.x, tc.y + yof ) );\n"
+"	vec4 b = CURRENT( vec2( tc.x, tc.y - yof ) );\n"
+"	vec4 a1 = CURRENT( vec2( tc.x - xof, tc.y + yof ) );\n"
+"	vec4 b1 = CURRENT( vec2( tc.x + xof, tc.y - yof ) );\n"
+"	vec4 a2 = CURRENT( vec2( tc.x + xof, tc.y + yof ) );\n"
+"	vec4 b2 = CURRENT( vec2( tc.x - xof, tc.y - yof ) );\n"
+"	vec3 w = vec3( 0.299, 0.587, 0.114 );\n"
+"	float d = abs( dot( a.rgb - b.rgb, w ) );\n"
+"	float d1 = abs( dot( a1.rgb - b1.rgb, w ) );\n"
+"	float d2 = abs( dot( a2.rgb - b2.rgb, w ) );\n"
+"	vec4 spatial = (a + b) * 0.5;\n"
+"	if ( d1 < d && d1 <= d2 )\n"
+"		spatial = (a1 + b1) * 0.5;\n"
+"	else if ( d2 < d )\n"
+"		spatial = (a2 + b2) * 0.5;\n"
+"#ifdef TEMPORAL\n"
+"	// c is in the other field, half a frame after the shown one for the first field\n"
+"	// and half a frame before for the second\n"
+"	vec4 p = INPUT2( tc );\n"
+"	vec4 temporal = PREFIX(second) > 0.5 ? c : (c + p) * 0.5;\n"
+"	vec4 diff = abs( c - p );\n"
+"	return clamp( spatial, temporal - diff, temporal + diff );\n"
+"#else\n"
+"	return spatial;\n"
+"#endif\n"
+"}\n";
+
+
+
+class MyDeinterlaceEffect : public Effect {
+public:
+	MyDeinterlaceEffect( bool useTemporal ) : iwidth(1), iheight(1), temporal(useTemporal), top_first(1), second(0) {
+		register_float( "top_first", &top_first );
+		register_float( "second", &second );
+	}
+
+	std::string effect_type_id() const { return "MyDeinterlaceEffect"; }
+
+	std::string output_fragment_shader() {
+		QString s = MyDeinterlaceEffect_shader;
+		if ( temporal )
+			return s.prepend( "#define TEMPORAL 1\n#define CURRENT INPUT1\n" ).toLatin1().data();
+		return s.prepend( "#define CURRENT INPUT\n" ).toLatin1().data();
+	}
+
+	unsigned num_inputs() const { return temporal ? 2 : 1; }
+	// fields are interpolated as stored
+	bool needs_linear_light() const { return false; }
+	bool needs_srgb_primaries() const { return false; }
+	AlphaHandling alpha_handling() const { return DONT_CARE_ALPHA_TYPE; }
+
+	void inform_input_size( unsigned, unsigned width, unsigned height ) {
+		iwidth = width;
+		iheight = height;
+	}
+
+	void set_gl_state( GLuint glsl_program_num, const std::string &prefix, unsigned *sampler_num ) {
+		Effect::set_gl_state( glsl_program_num, prefix, sampler_num );
+		float size[2] = { 1.0f / iwidth, 1.0f / iheight };
+		set_uniform_vec2( glsl_program_num, prefix, "one_div_size", size );
+	}
+
+private:
+	float iwidth, iheight;
+	bool temporal;
+	float top_first, second;
+};
+
+
+
+class GLDeinterlace : public GLFilter
+{
+public:
+	GLDeinterlace( QString id = "AutoDeinterlace", QString name = "AutoDeinterlace" );
+	~GLDeinterlace();
+
+	QString getDescriptor( double pts, Frame *src, Profile *p );
+	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
+
+	void setTemporal( bool b );
+	QList<Effect*> getMovitEffects();
+
+	// when disabled, inputs deinterlace on the CPU (yadif)
+	static void setEnabled( bool b ) { enabled = b; }
+	static bool isEnabled() { return enabled; }
+
+private:
+	bool temporal;
+	static bool enabled;
+};
+
+#endif //GLDEINTERLACE_H
@@ -16,7 +16,7 @@ bool GLDenoise::process( const QList<Effect*> &el, double pts, Frame *src, Profi
 	Q_UNUSED( p );
 	Effect *e = el[0];
 	return e->set_float( "radius", src->glWidth * getParamValue( blur ).toFloat() / 100.0 )
-		&& e->set_float( "eradius", getParamValue( eblur ).toFloat() )
+		&& e->set_float( "eradius", getParamValue( eblur ).toFloat() * src->glScale )
 		&& e->set_float( "amp", getParamValue( amp ).toFloat() );
 }
 
@@ -25,20 +25,20 @@ bool GLDenoise::process( const QList<Effect*> &el, double pts, Frame *src, Profi
 QList<Effect*> GLDenoise::getMovitEffects()
 {
 	QList<Effect*> list;
-	list.append( new MyDenoiseEffect() );
+	list.append( new MyDenoiseEffect( quality() == DRAFTQUALITY ) );
 	return list;
 }
 
 
 
-MyDenoiseEffect::MyDenoiseEffect()
+MyDenoiseEffect::MyDenoiseEffect( bool draft )
 	: blur( new BlurEffect ),
 	  eblur( new BlurEffect ),
 	  edge( new DenoiseEdgeEffect ),
 	  mask( new MyDenoiseMask )
 {
-	bool ok = eblur->set_int( "num_taps", 6 );
-	ok |= blur->set_int( "num_taps", 8 );
+	bool ok = eblur->set_int( "num_taps", draft ? 4 : 6 );
+	ok |= blur->set_int( "num_taps", draft ? 4 : 8 );
 }
 
 
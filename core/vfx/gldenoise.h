@@ -81,7 +81,7 @@ public:
 
 class MyDenoiseEffect : public Effect {
 public:
-	MyDenoiseEffect();
+	MyDenoiseEffect( bool draft = false );
 	std::string effect_type_id() const { return "MyDenoiseEffect"; }
 	void rewrite_graph(EffectChain *graph, Node *self);
 	bool set_float(const std::string &key, float value);
@@ -102,6 +102,7 @@ public:
 
 	bool process( const QList<Effect*>&, double pts, Frame *src, Profile *p );
 	QList<Effect*> getMovitEffects();
+	bool hasDraftQuality() { return true; }
 
 private:
 	Parameter *amp, *eblur, *blur;
@@ -42,18 +42,20 @@ bool GLDropShadow::process( const QList<Effect*> &el, double pts, Frame *src, Pr
 	// convert gamma and premultiply
 	sRgbColorToLinear( c );
 	RGBTriplet col = RGBTriplet( c.redF(), c.greenF(), c.blueF() );
+	double x = getParamValue( xOffset, pts ).toDouble() * src->glScale;
+	double y = getParamValue( yOffset, pts ).toDouble() * src->glScale;
 	
 	if ( ovdEnabled() ) {
 		src->glOVD = FilterTransform::TRANSLATE;
 		src->glOVDRect = QRectF( -(double)src->glWidth / 2.0, -(double)src->glHeight / 2.0, src->glWidth, src->glHeight );
-		src->glOVDTransformList.append( FilterTransform( FilterTransform::TRANSLATE, getParamValue( xOffset, pts ).toDouble(), getParamValue( yOffset, pts ).toDouble() ) );
+		src->glOVDTransformList.append( FilterTransform( FilterTransform::TRANSLATE, x, y ) );
 	}
 	
 	Effect *e = el[0];
-	return e->set_float( "xoffset", getParamValue( xOffset, pts ).toFloat() )
-		&& e->set_float( "yoffset", getParamValue( yOffset, pts ).toFloat() )
+	return e->set_float( "xoffset", x )
+		&& e->set_float( "yoffset", y )
 		&& e->set_float( "opacity", getParamValue( opacity, pts ).toFloat() )
-		&& e->set_float( "radius", getParamValue( radius, pts ).toFloat() )
+		&& e->set_float( "radius", getParamValue( radius, pts ).toFloat() * src->glScale )
 		&& e->set_vec3( "color", (float*)&col );
 }
 
@@ -22,10 +22,9 @@ GLEdge::~GLEdge()
 
 bool GLEdge::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
 {
-	Q_UNUSED( src );
 	Q_UNUSED( p );
 	Effect *e = el[1];
-	return el.at(0)->set_float( "radius", getParamValue( blur ).toFloat() )
+	return el.at(0)->set_float( "radius", getParamValue( blur ).toFloat() * src->glScale )
 		&& e->set_float( "amp", getParamValue( amp, pts ).toFloat() )
 		&& e->set_float( "depth", 1.0f - getParamValue( depth, pts ).toFloat() )
 		&& e->set_float( "opacity", getParamValue( opacity, pts ).toFloat() );
@@ -45,6 +45,7 @@ public:
 	GLFiber( QString id, QString name );
 
 	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
+	bool isAnimated( double ) { return true; }
 
 	QList<Effect*> getMovitEffects();
 	
@@ -12,10 +12,25 @@ using namespace movit;
 
 
 
+// x' = scaleX * x + offsetX, and the same for y.
+// In pixels, origin at top left.
+class AxisTransform
+{
+public:
+	AxisTransform() : scaleX( 1 ), scaleY( 1 ), offsetX( 0 ), offsetY( 0 ) {}
+
+	double scaleX, scaleY;
+	double offsetX, offsetY;
+};
+
+
+
 class GLFilter : public Filter
 {
 public:
-	GLFilter( QString id, QString name ) : Filter( id, name ) {}
+	enum Quality{ FULLQUALITY, DRAFTQUALITY };
+
+	GLFilter( QString id, QString name ) : Filter( id, name ), renderQuality( FULLQUALITY ) {}
 	virtual ~GLFilter() {}
 
 	// single input effects
@@ -30,6 +45,40 @@ public:
 	virtual QString getDescriptor( double, Frame*, Profile* ) { return getIdentifier(); }
 	virtual QString getDescriptorFirst( double, Frame*, Profile* ) { return ""; }
 	virtual QString getDescriptorSecond( double, Frame*, Profile* ) { return ""; }
+
+	// true if an opaque frame is still opaque and at the same place after this filter.
+	// Tracks below such frames are not rendered.
+	virtual bool keepsFrameOpaque( double /*pts*/ ) { return false; }
+	// Consecutive axis aligned filters (scale, translate, crop) are fused
+	// in a single resample by the composer, see GLGeometry.
+	// Both are valid after getDescriptor.
+	virtual bool isAxisAligned() { return false; }
+	virtual bool resamples() { return false; }
+	// Like process, but returns the transform instead of setting effects.
+	// src size, SAR and OVD are updated the same way.
+	virtual void getTransform( double /*pts*/, Frame*, Profile*, AxisTransform& ) {}
+	// Filters only multiplying the frame by a factor, like GLOpacity.
+	// The compositor applies them with the layer placement.
+	virtual bool isOpacity() { return false; }
+	virtual double getOpacity( double /*pts*/ ) { return 1.0; }
+	// Set by the composer before getDescriptor, draft is used during playback.
+	// Filters having cheaper effects in draft return them in getMovitEffects.
+	void setQuality( int q ) { renderQuality = q; }
+	int quality() { return renderQuality; }
+	virtual bool hasDraftQuality() { return false; }
+	// true if the output may change at pts while the input frame does not.
+	// Filters using time have to reimplement it.
+	virtual bool isAnimated( double /*pts*/ ) {
+		QList<Parameter*> params = getParameters();
+		for ( int i = 0; i < params.count(); ++i ) {
+			if ( params[i]->graph.keys.count() )
+				return true;
+		}
+		return false;
+	}
+
+protected:
+	int renderQuality;
 };
 
 #endif //GLFILTER_H
@@ -33,13 +33,13 @@ bool GLFrostedGlass::process( const QList<Effect*> &el, double pts, Frame *first
 QList<Effect*> GLFrostedGlass::getMovitEffects()
 {
 	QList<Effect*> list;
-	list.append( new MyFrostedGlassEffect() );
+	list.append( new MyFrostedGlassEffect( quality() == DRAFTQUALITY ) );
 	return list;
 }
 
 
 
-MyFrostedGlassEffect::MyFrostedGlassEffect()
+MyFrostedGlassEffect::MyFrostedGlassEffect( bool draft )
 	: blur1( new BlurEffect ),
 	  blur2( new BlurEffect ),
 	  cover1( new MySlidingWindow ),
@@ -51,6 +51,10 @@ MyFrostedGlassEffect::MyFrostedGlassEffect()
 	register_float("strength_first", &strength_first);
 	register_float("strength_second", &strength_second);
 	register_float( "position", &position );
+	if ( draft ) {
+		bool ok = blur1->set_int( "num_taps", 8 );
+		ok |= blur2->set_int( "num_taps", 8 );
+	}
 }
 
 
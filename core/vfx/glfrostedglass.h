@@ -54,7 +54,7 @@ static const char *MyMixWindow_shader=
 
 class MyFrostedGlassEffect : public Effect {
 public:
-	MyFrostedGlassEffect();
+	MyFrostedGlassEffect( bool draft = false );
 	virtual std::string effect_type_id() const { return "MyFrostedGlassEffect"; }
 	virtual unsigned num_inputs() const { return 2; }
 	virtual void rewrite_graph( EffectChain *graph, Node *self );
@@ -76,6 +76,7 @@ public:
 
 	bool process( const QList<Effect*>&, double pts, Frame *first, Frame *second, Profile *p );
 	QList<Effect*> getMovitEffects();
+	bool hasDraftQuality() { return true; }
 
 private:
 	Parameter *position, *mixAmount;
@@ -0,0 +1,119 @@
+#include <movit/resample_effect.h>
+#include <movit/padding_effect.h>
+
+#include "vfx/glgeometry.h"
+
+
+
+GLGeometry::GLGeometry( QString id, QString name ) : GLFilter( id, name )
+{
+}
+
+
+
+GLGeometry::~GLGeometry()
+{
+}
+
+
+
+void GLGeometry::setFilters( const QList< QSharedPointer<GLFilter> > &list )
+{
+	filters = list;
+}
+
+
+
+void GLGeometry::setFilter( int index, QSharedPointer<GLFilter> f )
+{
+	filters[index] = f;
+}
+
+
+
+QString GLGeometry::getDescriptor( double pts, Frame *src, Profile *p )
+{
+	Q_UNUSED( pts );
+	Q_UNUSED( src );
+	Q_UNUSED( p );
+	return getIdentifier() + QString( " %1" ).arg( filters.count() );
+}
+
+
+
+double GLGeometry::getPlacement( double pts, Frame *src, Profile *p, AxisTransform &total, QRectF &visible )
+{
+	double x1 = 0, y1 = 0, x2 = src->glWidth, y2 = src->glHeight;
+	double opacity = 1.0;
+
+	for ( int i = 0; i < filters.count(); ++i ) {
+		AxisTransform t;
+		filters[i]->getTransform( pts, src, p, t );
+		opacity *= filters[i]->getOpacity( pts );
+		total.scaleX *= t.scaleX;
+		total.scaleY *= t.scaleY;
+		total.offsetX = total.offsetX * t.scaleX + t.offsetX;
+		total.offsetY = total.offsetY * t.scaleY + t.offsetY;
+		// each filter output is clipped to its size
+		x1 = qMax( x1 * t.scaleX + t.offsetX, 0.0 );
+		y1 = qMax( y1 * t.scaleY + t.offsetY, 0.0 );
+		x2 = qMin( x2 * t.scaleX + t.offsetX, (double)src->glWidth );
+		y2 = qMin( y2 * t.scaleY + t.offsetY, (double)src->glHeight );
+	}
+
+	if ( x2 - x1 < 1.0 || y2 - y1 < 1.0 || total.scaleX < 1e-6 || total.scaleY < 1e-6 ) {
+		// nothing visible
+		x2 = x1 + 1.0;
+		y2 = y1 + 1.0;
+		total.scaleX = qMax( total.scaleX, 1e-6 );
+		total.scaleY = qMax( total.scaleY, 1e-6 );
+		opacity = 0.0;
+	}
+
+	visible = QRectF( QPointF( x1, y1 ), QPointF( x2, y2 ) );
+	return opacity;
+}
+
+
+
+bool GLGeometry::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
+{
+	double iw = src->glWidth;
+	double ih = src->glHeight;
+	// the whole transform, and the visible rect in output coordinates
+	AxisTransform total;
+	QRectF visible;
+	getPlacement( pts, src, p, total, visible );
+	double x1 = visible.left(), y1 = visible.top();
+	double x2 = visible.right(), y2 = visible.bottom();
+
+	// round to nearest integer
+	int w = x2 - x1 + 0.5;
+	int h = y2 - y1 + 0.5;
+
+	Effect *e = el[0];
+	bool ok = e->set_int( "width", w )
+		&& e->set_int( "height", h )
+		&& e->set_float( "zoom_x", total.scaleX * iw / w )
+		&& e->set_float( "zoom_y", total.scaleY * ih / h )
+		&& e->set_float( "left", (x1 - total.offsetX) / total.scaleX )
+		&& e->set_float( "top", (y1 - total.offsetY) / total.scaleY )
+		&& e->set_float( "zoom_center_x", 0 )
+		&& e->set_float( "zoom_center_y", 0 );
+
+	e = el[1];
+	return ok && e->set_int( "width", src->glWidth )
+		&& e->set_int( "height", src->glHeight )
+		&& e->set_float( "top", y1 )
+		&& e->set_float( "left", x1 );
+}
+
+
+
+QList<Effect*> GLGeometry::getMovitEffects()
+{
+	QList<Effect*> list;
+	list.append( new ResampleEffect() );
+	list.append( new PaddingEffect() );
+	return list;
+}
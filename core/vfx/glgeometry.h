@@ -0,0 +1,32 @@
+#ifndef GLGEOMETRY_H
+#define GLGEOMETRY_H
+
+#include "vfx/glfilter.h"
+
+
+
+// Consecutive axis aligned filters of a branch, applied
+// with a single resample followed by a padding,
+// or placed by the compositor, see GLCompositor.
+class GLGeometry : public GLFilter
+{
+public:
+	GLGeometry( QString id = "GeometryAuto", QString name = "GeometryAuto" );
+	~GLGeometry();
+
+	// fused filters, in order
+	void setFilters( const QList< QSharedPointer<GLFilter> > &list );
+	void setFilter( int index, QSharedPointer<GLFilter> f );
+	QString getDescriptor( double pts, Frame *src, Profile *p );
+	// the whole transform, the visible rect in output pixels
+	// and the product of opacities. src is updated like in process.
+	double getPlacement( double pts, Frame *src, Profile *p, AxisTransform &total, QRectF &visible );
+	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
+
+	QList<Effect*> getMovitEffects();
+
+private:
+	QList< QSharedPointer<GLFilter> > filters;
+};
+
+#endif //GLGEOMETRY_H
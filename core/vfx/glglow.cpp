@@ -21,9 +21,8 @@ GLGlow::~GLGlow()
 bool GLGlow::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
 {
 	Q_UNUSED( p );
-	Q_UNUSED( src );
 	Effect *e = el[0];
-	return e->set_float( "radius", getParamValue( radius, pts ).toFloat() )
+	return e->set_float( "radius", getParamValue( radius, pts ).toFloat() * src->glScale )
 		&& e->set_float( "blurred_mix_amount", getParamValue( glow, pts ).toFloat() )
 		&& e->set_float( "highlight_cutoff", getParamValue( highlight, pts ).toFloat() );
 }
@@ -29,6 +29,6 @@ bool GLHandDrawing::process( const QList<Effect*> &el, double pts, Frame *src, P
 QList<Effect*> GLHandDrawing::getMovitEffects()
 {
 	QList<Effect*> list;
-	list.append( new HandDrawingEffect() );
+	list.append( new HandDrawingEffect( quality() == DRAFTQUALITY ) );
 	return list;
 }
\ No newline at end of file
@@ -66,7 +66,7 @@ static const char *HandDrawingDrawEffect_shader=
 "}\n"
 "\n"
 "vec4 FUNCNAME(vec2 tc) {\n"
-"	float SampNum = 12.0;\n"
+"	float SampNum = SAMPNUM;\n"
 "	float stretch = 2.2;\n"
 "	vec2 iResolution = vec2(1920.0, 1080.0);\n"
 "\n"	
@@ -112,18 +112,25 @@ static const char *HandDrawingDrawEffect_shader=
 
 class HandDrawingDrawEffect : public Effect {
 public:
-	HandDrawingDrawEffect() {}
+	HandDrawingDrawEffect( bool useDraft ) : draft( useDraft ) {}
 	virtual std::string effect_type_id() const { return "HandDrawingDrawEffect"; }
-	std::string output_fragment_shader() { return HandDrawingDrawEffect_shader; }
+	std::string output_fragment_shader() {
+		// half the strokes samples in draft
+		QString s = HandDrawingDrawEffect_shader;
+		return s.prepend( draft ? "#define SAMPNUM 6.0\n" : "#define SAMPNUM 12.0\n" ).toLatin1().data();
+	}
 	virtual unsigned num_inputs() const { return 2; }	
 	bool needs_texture_bounce() const { return true; }
+
+private:
+	bool draft;
 };
 
 
 
 class HandDrawingEffect : public Effect {
 public:
-	HandDrawingEffect() : edge( new HandDrawingEdgeEffect ), draw( new HandDrawingDrawEffect ) {}
+	HandDrawingEffect( bool draft = false ) : edge( new HandDrawingEdgeEffect ), draw( new HandDrawingDrawEffect( draft ) ) {}
 	std::string effect_type_id() const { return "HandDrawingEffect"; }
 	std::string output_fragment_shader() { assert(false); }
 	void rewrite_graph(EffectChain *graph, Node *self) {
@@ -154,6 +161,8 @@ public:
 	~GLHandDrawing();
 
 	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
+	bool isAnimated( double ) { return true; }
+	bool hasDraftQuality() { return true; }
 
 	QList<Effect*> getMovitEffects();
 	
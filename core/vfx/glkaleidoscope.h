@@ -48,6 +48,7 @@ public:
 	~GLKaleidoscope();
 
 	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
+	bool isAnimated( double ) { return true; }
 
 	QList<Effect*> getMovitEffects();
 	
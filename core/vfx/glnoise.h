@@ -35,6 +35,7 @@ public:
 	GLNoise( QString id, QString name );
 
 	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
+	bool isAnimated( double ) { return true; }
 
 	QList<Effect*> getMovitEffects();
 };
@@ -27,6 +27,20 @@ bool GLOpacity::process( const QList<Effect*> &el, double pts, Frame *src, Profi
 
 
 
+double GLOpacity::getOpacity( double pts )
+{
+	return getParamValue( factor, pts ).toDouble();
+}
+
+
+
+bool GLOpacity::keepsFrameOpaque( double pts )
+{
+	return getParamValue( factor, pts ).toDouble() >= 1.0;
+}
+
+
+
 QList<Effect*> GLOpacity::getMovitEffects()
 {
 	QList<Effect*> list;
@@ -14,6 +14,9 @@ public:
 	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
 
 	QList<Effect*> getMovitEffects();
+	bool keepsFrameOpaque( double pts );
+	bool isOpacity() { return true; }
+	double getOpacity( double pts );
 	
 protected:
 	Parameter *factor;
@@ -37,6 +37,16 @@ QString GLPadding::getDescriptor( double pts, Frame *src, Profile *p )
 
 
 
+void GLPadding::getTransform( double pts, Frame *src, Profile *p, AxisTransform &t )
+{
+	Q_UNUSED( pts );
+	preProcess( src, p );
+	t.offsetX = left;
+	t.offsetY = top;
+}
+
+
+
 bool GLPadding::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
 {
 	Q_UNUSED( pts );
@@ -13,6 +13,8 @@ public:
 
 	QString getDescriptor( double pts, Frame *src, Profile *p );
 	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
+	bool isAxisAligned() { return true; }
+	void getTransform( double pts, Frame *src, Profile *p, AxisTransform &t );
 
 	QList<Effect*> getMovitEffects();
 	
@@ -17,9 +17,8 @@ GLPixelize::~GLPixelize()
 
 bool GLPixelize::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
 {
-	Q_UNUSED( src );
 	Q_UNUSED( p );
-	return el.at(0)->set_float( "pixelSize", getParamValue( pixelSize, pts ).toFloat() );
+	return el.at(0)->set_float( "pixelSize", getParamValue( pixelSize, pts ).toFloat() * src->glScale );
 }
 
 
@@ -0,0 +1,59 @@
+#include <movit/resample_effect.h>
+#include "vfx/glpreviewscale.h"
+
+
+
+GLPreviewScale::GLPreviewScale( QString id, QString name ) : GLFilter( id, name )
+{
+}
+
+
+
+GLPreviewScale::~GLPreviewScale()
+{
+}
+
+
+
+void GLPreviewScale::preProcess( Frame *src )
+{
+	src->glWidth = qMax( qRound( src->glWidth * src->glScale ), 1 );
+	src->glHeight = qMax( qRound( src->glHeight * src->glScale ), 1 );
+}
+
+
+
+QString GLPreviewScale::getDescriptor( double pts, Frame *src, Profile *p )
+{
+	Q_UNUSED( pts );
+	Q_UNUSED( p );
+	preProcess( src );
+	return getIdentifier();
+}
+
+
+
+bool GLPreviewScale::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
+{
+	Q_UNUSED( pts );
+	Q_UNUSED( p );
+	int glw = src->glWidth;
+	int glh = src->glHeight;
+
+	preProcess( src );
+
+	if ( src->glOVD )
+		src->glOVDTransformList.append( FilterTransform( FilterTransform::SCALE, (double)src->glWidth / glw, (double)src->glHeight / glh ) );
+
+	return el[0]->set_int( "width", src->glWidth )
+		&& el[0]->set_int( "height", src->glHeight );
+}
+
+
+
+QList<Effect*> GLPreviewScale::getMovitEffects()
+{
+	QList<Effect*> list;
+	list.append( new ResampleEffect() );
+	return list;
+}
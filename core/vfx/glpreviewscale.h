@@ -0,0 +1,25 @@
+#ifndef GLPREVIEWSCALE_H
+#define GLPREVIEWSCALE_H
+
+#include "vfx/glfilter.h"
+
+
+
+// Downscales the input by Frame::glScale, right after the input,
+// when the preview is composed below the project resolution.
+class GLPreviewScale : public GLFilter
+{
+public:
+	GLPreviewScale( QString id = "PreviewScaleAuto", QString name = "PreviewScaleAuto" );
+	~GLPreviewScale();
+
+	QString getDescriptor( double pts, Frame *src, Profile *p );
+	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
+
+	QList<Effect*> getMovitEffects();
+	
+private:
+	void preProcess( Frame *src );
+};
+
+#endif //GLPREVIEWSCALE_H
@@ -45,8 +45,9 @@ QString GLResize::getDescriptor( double pts, Frame *src, Profile *p )
 
 
 
-bool GLResize::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
+void GLResize::getTransform( double pts, Frame *src, Profile *p, AxisTransform &t )
 {
+	Q_UNUSED( pts );
 	int glw = src->glWidth;
 	int glh = src->glHeight;
 	
@@ -54,6 +55,17 @@ bool GLResize::process( const QList<Effect*> &el, double pts, Frame *src, Profil
 
 	if ( src->glOVD )
 		src->glOVDTransformList.append( FilterTransform( FilterTransform::SCALE, (double)src->glWidth / glw, (double)src->glHeight / glh ) );
+
+	t.scaleX = (double)src->glWidth / glw;
+	t.scaleY = (double)src->glHeight / glh;
+}
+
+
+
+bool GLResize::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
+{
+	AxisTransform t;
+	getTransform( pts, src, p, t );
 	
 	return el[0]->set_int( "width", src->glWidth )
 		&& el[0]->set_int( "height", src->glHeight );
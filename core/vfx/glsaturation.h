@@ -80,6 +80,7 @@ public:
 	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
 
 	QList<Effect*> getMovitEffects();
+	bool keepsFrameOpaque( double ) { return true; }
 
 private:
 	Parameter *saturation;
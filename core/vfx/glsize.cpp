@@ -92,8 +92,8 @@ bool GLSize::process( const QList<Effect*> &el, double pts, Frame *src, Profile
 
 	double rad = getParamValue( rotateAngle, pts ).toDouble() * M_PI / 180.0;
 	double zoom = getParamValue( sizePercent, pts ).toDouble() / 100.0;
-	double left = getParamValue( xOffset, pts ).toDouble();
-	double top = getParamValue( yOffset, pts ).toDouble();
+	double left = getParamValue( xOffset, pts ).toDouble() * src->glScale;
+	double top = getParamValue( yOffset, pts ).toDouble() * src->glScale;
 	// screen size (project)
 	double pw = p->getVideoWidth();
 	double ph = p->getVideoHeight();
@@ -105,17 +105,7 @@ bool GLSize::process( const QList<Effect*> &el, double pts, Frame *src, Profile
 	double imageWidth = resizeOutputWidth = src->glWidth;
 	double imageHeight = resizeOutputHeight = src->glHeight;
 	
-	if ( ovdEnabled() ) {
-		src->glOVD = FilterTransform::SCALE | FilterTransform::TRANSLATE;
-		src->glOVDRect = QRectF( -imageWidth / 2.0, -imageHeight / 2.0, imageWidth, imageHeight );
-	}
-	if ( src->glOVD ) {
-		if ( qAbs( src->glSAR - psar ) > 1e-3 )
-			src->glOVDTransformList.append( FilterTransform( FilterTransform::NERATIO, src->glSAR / psar, 1.0 ) );
-		src->glOVDTransformList.append( FilterTransform( FilterTransform::SCALE, qMax(1e-6, zoom), qMax(1e-6, zoom) ) );
-		src->glOVDTransformList.append( FilterTransform( FilterTransform::ROTATE, rad ) );
-		src->glOVDTransformList.append( FilterTransform( FilterTransform::TRANSLATE, left, top ) );
-	}
+	ovdTransforms( src, p, zoom, rad, left, top );
 	
 	if ( resizeActive ) {
 		// We translate and rotate the screen using Eigen3
@@ -234,6 +224,58 @@ bool GLSize::process( const QList<Effect*> &el, double pts, Frame *src, Profile
 
 
 
+void GLSize::ovdTransforms( Frame *src, Profile *p, double zoom, double rad, double left, double top )
+{
+	double psar = p->getVideoSAR();
+	if ( ovdEnabled() ) {
+		src->glOVD = FilterTransform::SCALE | FilterTransform::TRANSLATE;
+		src->glOVDRect = QRectF( -src->glWidth / 2.0, -src->glHeight / 2.0, src->glWidth, src->glHeight );
+	}
+	if ( src->glOVD ) {
+		if ( qAbs( src->glSAR - psar ) > 1e-3 )
+			src->glOVDTransformList.append( FilterTransform( FilterTransform::NERATIO, src->glSAR / psar, 1.0 ) );
+		src->glOVDTransformList.append( FilterTransform( FilterTransform::SCALE, qMax(1e-6, zoom), qMax(1e-6, zoom) ) );
+		src->glOVDTransformList.append( FilterTransform( FilterTransform::ROTATE, rad ) );
+		src->glOVDTransformList.append( FilterTransform( FilterTransform::TRANSLATE, left, top ) );
+	}
+}
+
+
+
+// the scaled image is centered on the screen, then moved by left and top
+void GLSize::getTransform( double pts, Frame *src, Profile *p, AxisTransform &t )
+{
+	double zoom = getParamValue( sizePercent, pts ).toDouble() / 100.0;
+	double left = getParamValue( xOffset, pts ).toDouble() * src->glScale;
+	double top = getParamValue( yOffset, pts ).toDouble() * src->glScale;
+	double pw = p->getVideoWidth();
+	double ph = p->getVideoHeight();
+
+	ovdTransforms( src, p, zoom, 0, left, top );
+
+	t.scaleX = src->glSAR / p->getVideoSAR() * zoom;
+	t.scaleY = zoom;
+	t.offsetX = pw / 2.0 + left - t.scaleX * src->glWidth / 2.0;
+	t.offsetY = ph / 2.0 + top - t.scaleY * src->glHeight / 2.0;
+
+	src->glWidth = pw;
+	src->glHeight = ph;
+	src->glSAR = p->getVideoSAR();
+}
+
+
+
+// not moved nor rotated, and at least as large as the frame
+bool GLSize::keepsFrameOpaque( double pts )
+{
+	return getParamValue( sizePercent, pts ).toDouble() >= 100.0
+		&& getParamValue( xOffset, pts ).toDouble() == 0.0
+		&& getParamValue( yOffset, pts ).toDouble() == 0.0
+		&& getParamValue( rotateAngle, pts ).toDouble() == 0.0;
+}
+
+
+
 QList<Effect*> GLSize::getMovitEffects()
 {
 	QList<Effect*> list;
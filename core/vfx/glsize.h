@@ -98,10 +98,16 @@ public:
 	virtual void ovdUpdate( QString type, QVariant val );
 
 	QList<Effect*> getMovitEffects();
+	bool keepsFrameOpaque( double pts );
+	// fused only when not rotated
+	bool isAxisAligned() { return !rotateActive; }
+	bool resamples() { return resizeActive; }
+	void getTransform( double pts, Frame *src, Profile *p, AxisTransform &t );
 
 		
 protected:
 	void findPoints( double &x1, double &x2, double first, double last );
+	void ovdTransforms( Frame *src, Profile *p, double zoom, double rad, double left, double top );
 	
 	Parameter *sizePercent;
 	bool resizeActive;
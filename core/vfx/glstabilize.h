@@ -84,6 +84,7 @@ public:
 	~GLStabilize();
  
 	virtual bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
+	bool isAnimated( double ) { return true; }
 	QList<Effect*> getMovitEffects();
 	
 	void setSource( Source *aSource );
@@ -3,10 +3,12 @@
 #include "engine/util.h"
 
 #include "gltext.h"
+#include "gltextatlas.h"
 
 
 
-GLText::GLText( QString id, QString name ) : GLFilter( id, name )
+GLText::GLText( QString id, QString name ) : GLFilter( id, name ),
+	atlas( false )
 {
 	editor = addParameter( "editor", tr("Editor:"), Parameter::PSTRING, "Arial,12,-1,5,50,0,0,0,0,0|30|0|0|#ffffff.255|#000000.0|1|0|#000000.255|0|50|50\nText", "", "", false );
 	opacity = addParameter( "opacity", tr("Opacity:"), Parameter::PDOUBLE, 1.0, 0.0, 1.0, true );
@@ -16,6 +18,14 @@ GLText::GLText( QString id, QString name ) : GLFilter( id, name )
 
 
 
+bool GLText::isAnimated( double pts )
+{
+	// timecodes
+	return getParamValue( editor ).toString().contains( "##" ) || GLFilter::isAnimated( pts );
+}
+
+
+
 void GLText::ovdUpdate( QString type, QVariant val )
 {
 	if ( type == "translate" ) {
@@ -29,13 +39,24 @@ void GLText::ovdUpdate( QString type, QVariant val )
 
 
 
-bool GLText::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
-{	
-	MyTextEffect *e = (MyTextEffect*)el[0];
-	bool ok = e->set_float( "left", getParamValue( xOffset, pts ).toDouble() )
-		&& e->set_float( "top", getParamValue( yOffset, pts ).toDouble() )
-		&& e->set_float( "opacity", getParamValue( opacity, pts ).toDouble() );
-		
+QString GLText::getDescriptor( double pts, Frame *src, Profile *p )
+{
+	Q_UNUSED( src );
+	TextStyle style;
+	QStringList sl = getText( pts, p ).split( "\n" );
+	style.parse( sl );
+	atlas = style.backgroundColor.alpha() == 0 && style.arrowType == 0;
+	// a full atlas falls back to the painted image
+	if ( atlas )
+		atlas = GlyphAtlasCache::globalInstance()->getAtlas( style )->fits( sl.join( "" ) );
+
+	return getIdentifier() + (atlas ? " Atlas" : "");
+}
+
+
+
+QString GLText::getText( double pts, Profile *p )
+{
 	QString text = getParamValue( editor ).toString();
 	if (text.contains("##")) {
 		double secs = pts / MICROSECOND;
@@ -52,13 +73,41 @@ bool GLText::process( const QList<Effect*> &el, double pts, Frame *src, Profile
 		text.replace("##i##", QString("%1").arg(img));
 		text.replace("##ii##", QString("%1").arg(img,2,10,QChar('0')));
 	}
-	e->setText(text, src->glWidth, src->glHeight);
+	return text;
+}
+
+
+
+bool GLText::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
+{	
+	Effect *e = el[0];
+	double x = getParamValue( xOffset, pts ).toDouble() * src->glScale;
+	double y = getParamValue( yOffset, pts ).toDouble() * src->glScale;
+	bool ok = e->set_float( "left", x )
+		&& e->set_float( "top", y )
+		&& e->set_float( "opacity", getParamValue( opacity, pts ).toDouble() );
+		
+	QString text = getText( pts, p );
+	double w, h;
+	if ( atlas ) {
+		MyTextAtlasEffect *te = (MyTextAtlasEffect*)e;
+		te->setText( text, src->glWidth, src->glHeight, src->glScale );
+		w = te->getImageWidth();
+		h = te->getImageHeight();
+	}
+	else {
+		MyTextEffect *te = (MyTextEffect*)e;
+		te->setText( text, src->glWidth, src->glHeight, src->glScale );
+		w = te->getImageWidth();
+		h = te->getImageHeight();
+	}
 		
 	if ( ovdEnabled() ) {
 		src->glOVD = FilterTransform::TRANSLATE;
-		double w = e->getImageWidth(), h = e->getImageHeight();
+		w *= src->glScale;
+		h *= src->glScale;
 		src->glOVDRect = QRectF( -w / 2.0, -h / 2.0, w, h );
-		src->glOVDTransformList.append( FilterTransform( FilterTransform::TRANSLATE, getParamValue( xOffset, pts ).toDouble(), getParamValue( yOffset, pts ).toDouble() ) );
+		src->glOVDTransformList.append( FilterTransform( FilterTransform::TRANSLATE, x, y ) );
 	}
 	
 	return ok;
@@ -69,25 +118,31 @@ bool GLText::process( const QList<Effect*> &el, double pts, Frame *src, Profile
 QList<Effect*> GLText::getMovitEffects()
 {
 	QList<Effect*> list;
-	list.append( new MyTextEffect() );
+	if ( atlas )
+		list.append( new MyTextAtlasEffect() );
+	else
+		list.append( new MyTextEffect() );
 	return list;
 }
 
 
 
-QImage* MyTextEffect::drawImage()
+TextStyle::TextStyle()
+	: brush( QColor(0,0,0,0) ),
+	backgroundColor( 0, 0, 0, 0 ),
+	outline( 0 ),
+	align( 1 ),
+	arrowType( 0 ),
+	arrowSize( 0 ),
+	arrowPos( 0 )
+{
+	pen.setJoinStyle( Qt::RoundJoin );
+}
+
+
+
+void TextStyle::parse( QStringList &sl )
 {
-	QFont myFont;
-	QPen myPen;
-	myPen.setJoinStyle( Qt::RoundJoin );
-	QBrush myBrush( QColor(0,0,0,0) );
-	QColor backgroundColor(0,0,0,0);
-	int outline = 0;
-	int align = 1;
-	
-	int arrowType = 0, arrowSize = 0, arrowPos = 0;
-		
-	QStringList sl = currentText.split("\n");
 	while ( !sl.isEmpty() ) {
 		if ( sl.last().trimmed().isEmpty() )
 			sl.takeLast();
@@ -95,20 +150,21 @@ QImage* MyTextEffect::drawImage()
 			break;
 	}
 	if ( sl.count() ) {
+		header = sl[0];
 		QStringList desc = sl[0].split("|");
 		if ( desc.count() >= 9 ) {
-			myFont.fromString( desc[0] );
-			myFont.setPointSize( desc[1].toInt() );
-			myFont.setBold( desc[2].toInt() );
-			myFont.setItalic( desc[3].toInt() );
+			font.fromString( desc[0] );
+			font.setPointSize( desc[1].toInt() );
+			font.setBold( desc[2].toInt() );
+			font.setItalic( desc[3].toInt() );
 
 			QStringList fc = desc[4].split( "." );
 			if ( fc.count() == 2 ) {
 				QColor col;
 				col.setNamedColor( fc[ 0 ] );
 				col.setAlpha( fc[ 1 ].toInt() );
-				myPen.setColor( col );
-				myBrush.setColor( col );
+				pen.setColor( col );
+				brush.setColor( col );
 			}
 			
 			QStringList bc = desc[5].split( "." );
@@ -124,12 +180,12 @@ QImage* MyTextEffect::drawImage()
 				QStringList oc = desc[8].split( "." );
 				if ( oc.count() == 2 ) {
 					outline = osize;
-					myPen.setWidth( osize );
-					myFont.setStyleStrategy( QFont::ForceOutline );
+					pen.setWidth( osize );
+					font.setStyleStrategy( QFont::ForceOutline );
 					QColor col;
 					col.setNamedColor( oc[ 0 ] );
 					col.setAlpha( oc[ 1 ].toInt() );
-					myPen.setColor( col );
+					pen.setColor( col );
 				}
 			}
 		}
@@ -139,11 +195,27 @@ QImage* MyTextEffect::drawImage()
 			arrowPos = desc[11].toInt();
 		}
 		sl.takeFirst();
-	}	
+	}
+}
+
+
+
+QImage MyTextEffect::drawImage()
+{
+	TextStyle style;
+	QStringList sl = currentText.split("\n");
+	style.parse( sl );
+	QFont myFont = style.font;
+	QPen myPen = style.pen;
+	QBrush myBrush = style.brush;
+	QColor backgroundColor = style.backgroundColor;
+	int outline = style.outline;
+	int align = style.align;
+	int arrowType = style.arrowType, arrowSize = style.arrowSize, arrowPos = style.arrowPos;
 	
-	QImage *image = new QImage( 10, 10, QImage::Format_ARGB32_Premultiplied );
+	QImage image( 10, 10, QImage::Format_ARGB32_Premultiplied );
 	QPainter painter;
-	painter.begin( image );
+	painter.begin( &image );
 	painter.setPen( myPen );
 	painter.setBrush( myBrush );
 	painter.setFont( myFont );
@@ -267,10 +339,9 @@ QImage* MyTextEffect::drawImage()
 		}		
 	}
 	
-	delete image;
-	image = new QImage( w + wMargin, h + hMargin, QImage::Format_ARGB32_Premultiplied );
-	image->fill( QColor(0,0,0,0) );
-	painter.begin( image );
+	image = QImage( w + wMargin, h + hMargin, QImage::Format_ARGB32_Premultiplied );
+	image.fill( QColor(0,0,0,0) );
+	painter.begin( &image );
 	painter.setRenderHints( QPainter::Antialiasing | QPainter::TextAntialiasing );
 	if ( backgroundColor.alpha() > 0 ) {
 		painter.setPen( QColor(0,0,0,0) );
@@ -315,3 +386,42 @@ QImage* MyTextEffect::drawImage()
 	
 	return image;
 }
+
+
+
+static TextRasterCache globalTextRasterCache;
+
+
+
+TextRasterCache* TextRasterCache::globalInstance()
+{
+	return &globalTextRasterCache;
+}
+
+
+
+QImage TextRasterCache::get( const QString &key )
+{
+	QMutexLocker ml( &mutex );
+	QImage image = images.value( key );
+	if ( !image.isNull() ) {
+		keys.removeOne( key );
+		keys.append( key );
+	}
+	return image;
+}
+
+
+
+void TextRasterCache::insert( const QString &key, const QImage &image )
+{
+	QMutexLocker ml( &mutex );
+	if ( images.contains( key ) )
+		return;
+	images.insert( key, image );
+	keys.append( key );
+	bytes += image.byteCount();
+	// drop the least recently used, but keep the last one
+	while ( bytes > TEXTCACHEBYTES && keys.count() > 1 )
+		bytes -= images.take( keys.takeFirst() ).byteCount();
+}
@@ -2,6 +2,11 @@
 #define GLTEXT_H
 
 #include <QImage>
+#include <QFont>
+#include <QPen>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
 
 #include <movit/effect_util.h>
 #include <movit/effect_chain.h>
@@ -9,6 +14,11 @@
 
 #include "glfilter.h"
 
+// memory used by the rasterized texts
+#define TEXTCACHEBYTES 64 * 1024 * 1024
+// textures kept by each effect
+#define TEXTCACHETEXTURES 16
+
 static const char *MyTextEffect_shader=
 "uniform sampler2D PREFIX(string_tex);\n"
 "uniform vec2 PREFIX(offset);\n"
@@ -23,23 +33,73 @@ static const char *MyTextEffect_shader=
 
 
 
+// Style header, the first line of the editor text
+class TextStyle
+{
+public:
+	TextStyle();
+	// removes the header and the trailing empty lines
+	void parse( QStringList &lines );
+
+	QFont font;
+	QPen pen;
+	QBrush brush;
+	QColor backgroundColor;
+	int outline, align;
+	int arrowType, arrowSize, arrowPos;
+	QString header;
+};
+
+
+
+// Rasterized texts, keyed by target size and text,
+// shared by all text effects and kept across chain rebuilds.
+class TextRasterCache
+{
+public:
+	TextRasterCache() : bytes( 0 ) {}
+	// null if not cached
+	QImage get( const QString &key );
+	void insert( const QString &key, const QImage &image );
+
+	static TextRasterCache* globalInstance();
+
+private:
+	QMutex mutex;
+	// least recently used first
+	QStringList keys;
+	QHash<QString, QImage> images;
+	qint64 bytes;
+};
+
+
+
+class TextTexture
+{
+public:
+	TextTexture( QString k, GLuint t, int w, int h ) : key( k ), tex( t ), width( w ), height( h ) {}
+
+	QString key;
+	GLuint tex;
+	int width, height;
+};
+
+
+
 class MyTextEffect : public Effect {
 public:
-	MyTextEffect() : iwidth(1), iheight(1), imgWidth(1), imgHeight(1),
-		top(0), left(0), opacity(1), reload(true), currentImage( NULL )
+	MyTextEffect() : iwidth(1), iheight(1), imgWidth(1), imgHeight(1), imgScale(1),
+		top(0), left(0), opacity(1)
 	{
 		register_float( "top", &top );
 		register_float( "left", &left );
 		register_float( "opacity", &opacity );
-		glGenTextures( 1, &texnum );
 		setText( ".", 1, 1 );
 	}
 	
 	~MyTextEffect() {
-		glDeleteTextures( 1, &texnum );
-		if (currentImage) {
-			delete currentImage;
-		}
+		for ( int i = 0; i < textures.count(); ++i )
+			glDeleteTextures( 1, &textures[i].tex );
 	}
 	
 	virtual std::string effect_type_id() const { return "MyTextEffect"; }
@@ -53,49 +113,73 @@ public:
 	virtual void set_gl_state( GLuint glsl_program_num, const std::string &prefix, unsigned *sampler_num ) {
 		Effect::set_gl_state( glsl_program_num, prefix, sampler_num );
 
-		if ( reload ) {
+		// upload, reusing the least recently used texture
+		if ( !pendingImage.isNull() ) {
+			GLuint tex;
+			if ( textures.count() >= TEXTCACHETEXTURES )
+				tex = textures.takeFirst().tex;
+			else
+				glGenTextures( 1, &tex );
 			glActiveTexture( GL_TEXTURE0 + *sampler_num );
-			glBindTexture( GL_TEXTURE_2D, texnum );
+			glBindTexture( GL_TEXTURE_2D, tex );
 			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
 			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
 			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-			glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, imgWidth, imgHeight, 0, GL_BGRA, GL_UNSIGNED_BYTE, currentImage->constBits() );
-			
-			delete currentImage;
-			currentImage = NULL;
-			reload = false;
+			glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, imgWidth, imgHeight, 0, GL_BGRA, GL_UNSIGNED_BYTE, pendingImage.constBits() );
+			textures.append( TextTexture( currentKey, tex, imgWidth, imgHeight ) );
+			pendingImage = QImage();
 		}
 		
-		float oleft = ((iwidth - imgWidth) / 2.0f) + left;
-		float otop = ((iheight - imgHeight) / 2.0f) + top;
+		// the image is drawn in project pixels
+		float w = imgWidth * imgScale;
+		float h = imgHeight * imgScale;
+		float oleft = ((iwidth - w) / 2.0f) + left;
+		float otop = ((iheight - h) / 2.0f) + top;
 
-		float offset[2] = { oleft / iwidth, ( iheight - imgHeight - otop ) / iheight };
+		float offset[2] = { oleft / iwidth, ( iheight - h - otop ) / iheight };
 		set_uniform_vec2( glsl_program_num, prefix, "offset", offset );
 
-		float scale[2] = { iwidth / imgWidth, iheight / imgHeight };
+		float scale[2] = { iwidth / w, iheight / h };
 		set_uniform_vec2( glsl_program_num, prefix, "scale", scale );
 		
 		glActiveTexture( GL_TEXTURE0 + *sampler_num );
-		glBindTexture( GL_TEXTURE_2D, texnum );
+		glBindTexture( GL_TEXTURE_2D, textures.last().tex );
 		set_uniform_int( glsl_program_num, prefix, "string_tex", *sampler_num );
 		++*sampler_num;
 	}
 	
-	QImage* drawImage();
-
-	void setText( const QString &text, int iw, int ih ) {
-		if ( text != currentText ) {
-			currentText = text;
-			iwidth = iw;
-			iheight = ih;
-			if ( currentImage )
-				delete currentImage;
-			currentImage = drawImage();
-			imgWidth = currentImage->width();
-			imgHeight = currentImage->height();
-			reload = true;
+	QImage drawImage();
+
+	// Only texts not seen recently are drawn
+	void setText( const QString &text, int iw, int ih, double scale = 1 ) {
+		imgScale = scale;
+		QString key = QString( "%1x%2|" ).arg( iw ).arg( ih ) + text;
+		if ( key == currentKey )
+			return;
+		currentKey = key;
+		currentText = text;
+		iwidth = iw;
+		iheight = ih;
+		pendingImage = QImage();
+
+		// already uploaded
+		for ( int i = 0; i < textures.count(); ++i ) {
+			if ( textures[i].key == key ) {
+				textures.move( i, textures.count() - 1 );
+				imgWidth = textures.last().width;
+				imgHeight = textures.last().height;
+				return;
+			}
 		}
+
+		pendingImage = TextRasterCache::globalInstance()->get( key );
+		if ( pendingImage.isNull() ) {
+			pendingImage = drawImage();
+			TextRasterCache::globalInstance()->insert( key, pendingImage );
+		}
+		imgWidth = pendingImage.width();
+		imgHeight = pendingImage.height();
 	}
 	
 	float getImageWidth() { return imgWidth; }
@@ -103,14 +187,15 @@ public:
 
 private:
 	float iwidth, iheight;
-	float imgWidth, imgHeight;
+	float imgWidth, imgHeight, imgScale;
 	float top, left;
 	float opacity;
 	
-	GLuint texnum;
-	QString currentText;
-	bool reload;
-	QImage *currentImage;
+	QString currentText, currentKey;
+	// not uploaded yet
+	QImage pendingImage;
+	// least recently used first, the last one is current
+	QList<TextTexture> textures;
 };
 
 
@@ -120,12 +205,18 @@ class GLText : public GLFilter
 public:
 	GLText( QString id, QString name );
 	
+	QString getDescriptor( double pts, Frame *src, Profile *p );
 	virtual bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
 	virtual void ovdUpdate( QString type, QVariant val );
+	bool isAnimated( double pts );
 	
 	QList<Effect*> getMovitEffects();
 	
 private:
+	QString getText( double pts, Profile *p );
+
+	// plain texts are drawn from a glyph atlas
+	bool atlas;
 	Parameter *editor;
 	Parameter *opacity;
 	Parameter *xOffset, *yOffset;
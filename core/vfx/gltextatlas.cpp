@@ -0,0 +1,335 @@
+#include <math.h>
+
+#include <QPainter>
+
+#include "gltextatlas.h"
+
+
+
+QAtomicInt GlyphAtlas::maxHeight( GLYPHATLASMAXHEIGHT );
+
+
+
+GlyphAtlas::GlyphAtlas( const TextStyle &s )
+	: style( s ),
+	metrics( s.font ),
+	penX( 0 ),
+	penY( 0 ),
+	version( 0 )
+{
+	QFontMetrics fm( style.font );
+	lineSpacing = fm.lineSpacing();
+	ascent = fm.ascent();
+	margin = qMax( fm.width( "M" ) / 3.0, 3.0 );
+	pad = style.outline + 2;
+	cellHeight = lineSpacing + 2 * pad;
+	image = QImage( GLYPHATLASWIDTH, cellHeight + 1, QImage::Format_ARGB32_Premultiplied );
+	image.fill( QColor(0,0,0,0) );
+}
+
+
+
+GlyphCell GlyphAtlas::cell( QChar c )
+{
+	QMutexLocker ml( &mutex );
+	QHash<QChar, GlyphCell>::const_iterator it = cells.constFind( c );
+	if ( it != cells.constEnd() )
+		return it.value();
+
+	GlyphCell gc;
+	gc.advance = metrics.width( c );
+	gc.width = qMin( (int)ceil( gc.advance ) + 2 * pad, GLYPHATLASWIDTH - 1 );
+	if ( !c.isSpace() && !draw( c, gc ) )
+		gc.y = -1;
+	cells.insert( c, gc );
+	return gc;
+}
+
+
+
+bool GlyphAtlas::fits( const QString &text )
+{
+	for ( int i = 0; i < text.length(); ++i ) {
+		if ( cell( text[i] ).y < 0 )
+			return false;
+	}
+	return true;
+}
+
+
+
+bool GlyphAtlas::draw( QChar c, GlyphCell &gc )
+{
+	// cells are separated by a transparent pixel
+	int x = penX, y = penY;
+	if ( x + gc.width + 1 > GLYPHATLASWIDTH ) {
+		x = 0;
+		y += cellHeight + 1;
+	}
+	if ( y + cellHeight + 1 > image.height() ) {
+		int h = qMin( qMax( y + cellHeight + 1, image.height() * 2 ), maxHeight.load() );
+		if ( y + cellHeight + 1 > h )
+			return false;
+		// filled with 0 out of the image
+		image = image.copy( 0, 0, GLYPHATLASWIDTH, h );
+	}
+	gc.x = x;
+	gc.y = y;
+	penX = x + gc.width + 1;
+	penY = y;
+
+	QPainter painter;
+	painter.begin( &image );
+	painter.setRenderHints( QPainter::Antialiasing | QPainter::TextAntialiasing );
+	painter.setClipRect( gc.x, gc.y, gc.width, cellHeight );
+	painter.setPen( style.pen );
+	painter.setBrush( style.brush );
+	painter.setFont( style.font );
+	QPointF point( gc.x + pad, gc.y + pad + ascent );
+	if ( style.outline ) {
+		QPainterPath myPath;
+		myPath.addText( point, style.font, QString( c ) );
+		painter.drawPath( myPath );
+	}
+	else
+		painter.drawText( point, QString( c ) );
+	painter.end();
+
+	glyphRows.append( gc.y );
+	++version;
+	return true;
+}
+
+
+
+QImage GlyphAtlas::getImage( int &v, int &top, int &bottom )
+{
+	QMutexLocker ml( &mutex );
+	top = ( v >= 0 && v < version ) ? glyphRows[v] : 0;
+	bottom = qMin( penY + cellHeight + 1, image.height() );
+	v = version;
+	return image;
+}
+
+
+
+int GlyphAtlas::getVersion()
+{
+	QMutexLocker ml( &mutex );
+	return version;
+}
+
+
+
+qreal GlyphAtlas::textWidth( const QString &text )
+{
+	qreal w = 0;
+	for ( int i = 0; i < text.length(); ++i )
+		w += cell( text[i] ).advance;
+	return w;
+}
+
+
+
+static GlyphAtlasCache globalGlyphAtlasCache;
+
+
+
+GlyphAtlasCache* GlyphAtlasCache::globalInstance()
+{
+	return &globalGlyphAtlasCache;
+}
+
+
+
+QSharedPointer<GlyphAtlas> GlyphAtlasCache::getAtlas( const TextStyle &style )
+{
+	QMutexLocker ml( &mutex );
+	for ( int i = 0; i < atlases.count(); ++i ) {
+		if ( atlases[i]->style.header == style.header ) {
+			atlases.move( i, atlases.count() - 1 );
+			return atlases.last();
+		}
+	}
+
+	// effects still using a dropped atlas keep it alive
+	atlases.append( QSharedPointer<GlyphAtlas>( new GlyphAtlas( style ) ) );
+	while ( atlases.count() > GLYPHATLASSTYLES )
+		atlases.takeFirst();
+	return atlases.last();
+}
+
+
+
+MyTextAtlasEffect::MyTextAtlasEffect()
+	: iwidth( 1 ),
+	iheight( 1 ),
+	blockWidth( 1 ),
+	blockHeight( 1 ),
+	imgScale( 1 ),
+	top( 0 ),
+	left( 0 ),
+	opacity( 1 ),
+	atlasTex( 0 ),
+	layoutTex( 0 ),
+	atlasVersion( -1 ),
+	layoutWidth( 1 ),
+	layoutHeight( 1 ),
+	layoutChanged( true )
+{
+	register_float( "top", &top );
+	register_float( "left", &left );
+	register_float( "opacity", &opacity );
+	setText( ".", 1, 1 );
+}
+
+
+
+MyTextAtlasEffect::~MyTextAtlasEffect()
+{
+	if ( atlasTex )
+		glDeleteTextures( 1, &atlasTex );
+	if ( layoutTex )
+		glDeleteTextures( 1, &layoutTex );
+}
+
+
+
+void MyTextAtlasEffect::setText( const QString &text, int iw, int ih, double scale )
+{
+	Q_UNUSED( iw );
+	Q_UNUSED( ih );
+	imgScale = scale;
+	if ( text == currentText )
+		return;
+	currentText = text;
+
+	TextStyle style;
+	QStringList sl = text.split( "\n" );
+	style.parse( sl );
+	if ( atlas.isNull() || atlas->style.header != style.header ) {
+		atlas = GlyphAtlasCache::globalInstance()->getAtlas( style );
+		atlasVersion = -1;
+		atlasSize = QSize();
+	}
+
+	// same block as MyTextEffect::drawImage, but not clipped to the frame
+	qreal w = 0;
+	int glyphs = 0;
+	for ( int i = 0; i < sl.count(); ++i ) {
+		w = qMax( w, atlas->textWidth( sl[i] ) );
+		glyphs = qMax( glyphs, sl[i].length() );
+	}
+	double x = ((double)style.outline + atlas->margin * 2) / 2.0;
+	blockWidth = w + 2 * x;
+	blockHeight = sl.count() * atlas->lineSpacing + 2 * x;
+
+	layoutWidth = qMin( glyphs, GLYPHATLASMAXGLYPHS - 1 ) + 1;
+	layoutHeight = qMax( sl.count(), 1 );
+	layout.fill( 0, layoutWidth * layoutHeight * 4 );
+	for ( int i = 0; i < sl.count(); ++i ) {
+		qreal pen;
+		switch ( style.align ) {
+			case 2: {
+				pen = blockWidth / 2.0 - atlas->textWidth( sl[i] ) / 2.0;
+				break;
+			}
+			case 3: {
+				pen = blockWidth - x - atlas->textWidth( sl[i] );
+				break;
+			}
+			default: {
+				pen = x;
+				break;
+			}
+		}
+		float *line = layout.data() + i * layoutWidth * 4;
+		int n = 0;
+		for ( int j = 0; j < sl[i].length() && n < layoutWidth - 1; ++j ) {
+			GlyphCell gc = atlas->cell( sl[i][j] );
+			if ( !sl[i][j].isSpace() && gc.y >= 0 ) {
+				float *texel = line + ++n * 4;
+				texel[0] = pen - atlas->pad;
+				texel[1] = gc.width;
+				texel[2] = gc.x;
+				texel[3] = gc.y;
+			}
+			pen += gc.advance;
+		}
+		line[0] = n;
+	}
+	layoutChanged = true;
+}
+
+
+
+void MyTextAtlasEffect::set_gl_state( GLuint glsl_program_num, const std::string &prefix, unsigned *sampler_num )
+{
+	Effect::set_gl_state( glsl_program_num, prefix, sampler_num );
+
+	if ( !atlasTex ) {
+		glGenTextures( 1, &atlasTex );
+		glGenTextures( 1, &layoutTex );
+		GLint max;
+		glGetIntegerv( GL_MAX_TEXTURE_SIZE, &max );
+		GlyphAtlas::maxHeight.store( qMin( (int)max, GLYPHATLASMAXHEIGHT ) );
+	}
+
+	glActiveTexture( GL_TEXTURE0 + *sampler_num );
+	glBindTexture( GL_TEXTURE_2D, atlasTex );
+	if ( atlas->getVersion() != atlasVersion ) {
+		int top, bottom;
+		QImage img = atlas->getImage( atlasVersion, top, bottom );
+		if ( img.size() != atlasSize ) {
+			// new or grown atlas
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+			glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+			glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, img.width(), img.height(), 0, GL_BGRA, GL_UNSIGNED_BYTE, img.constBits() );
+			atlasSize = img.size();
+		}
+		else if ( bottom > top ) {
+			// only the rows of the new glyphs
+			glTexSubImage2D( GL_TEXTURE_2D, 0, 0, top, img.width(), bottom - top, GL_BGRA, GL_UNSIGNED_BYTE, img.constScanLine( top ) );
+		}
+	}
+	set_uniform_int( glsl_program_num, prefix, "atlas_tex", *sampler_num );
+	++*sampler_num;
+
+	glActiveTexture( GL_TEXTURE0 + *sampler_num );
+	glBindTexture( GL_TEXTURE_2D, layoutTex );
+	if ( layoutChanged ) {
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA32F, layoutWidth, layoutHeight, 0, GL_RGBA, GL_FLOAT, layout.constData() );
+		layoutChanged = false;
+	}
+	set_uniform_int( glsl_program_num, prefix, "layout_tex", *sampler_num );
+	++*sampler_num;
+
+	// the block is laid out in project pixels
+	float w = blockWidth * imgScale;
+	float h = blockHeight * imgScale;
+	float oleft = ((iwidth - w) / 2.0f) + left;
+	float otop = ((iheight - h) / 2.0f) + top;
+
+	float offset[2] = { oleft / iwidth, ( iheight - h - otop ) / iheight };
+	set_uniform_vec2( glsl_program_num, prefix, "offset", offset );
+	float scale[2] = { iwidth / w, iheight / h };
+	set_uniform_vec2( glsl_program_num, prefix, "scale", scale );
+
+	float bsize[2] = { blockWidth, blockHeight };
+	set_uniform_vec2( glsl_program_num, prefix, "block_size", bsize );
+	float asize[2] = { (float)atlasSize.width(), (float)atlasSize.height() };
+	set_uniform_vec2( glsl_program_num, prefix, "atlas_size", asize );
+	float lsize[2] = { (float)layoutWidth, (float)layoutHeight };
+	set_uniform_vec2( glsl_program_num, prefix, "layout_size", lsize );
+	double x = ((double)atlas->style.outline + atlas->margin * 2) / 2.0;
+	set_uniform_float( glsl_program_num, prefix, "line_spacing", atlas->lineSpacing );
+	set_uniform_float( glsl_program_num, prefix, "top_margin", x );
+	set_uniform_float( glsl_program_num, prefix, "cell_pad", atlas->pad );
+	set_uniform_float( glsl_program_num, prefix, "cell_height", atlas->cellHeight );
+}
@@ -0,0 +1,192 @@
+#ifndef GLTEXTATLAS_H
+#define GLTEXTATLAS_H
+
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QVector>
+#include <QFontMetricsF>
+
+#include "vfx/gltext.h"
+
+// width of the atlas images
+#define GLYPHATLASWIDTH 1024
+// atlases don't grow higher, nor above GL_MAX_TEXTURE_SIZE
+#define GLYPHATLASMAXHEIGHT 8192
+// atlases kept, one per text style
+#define GLYPHATLASSTYLES 8
+// glyphs searched per line, 2^12
+#define GLYPHATLASMAXGLYPHS 4096
+
+
+
+// Text laid out from a glyph atlas. Each layout_tex row is a line,
+// texel 0 holds the glyph count and texel i (cell left, cell width,
+// atlas x, atlas y) of glyph i, in block pixels.
+// Cells overlap their neighbours by the pad, so 2 glyphs of 2 lines are blended.
+static const char *MyTextAtlasEffect_shader=
+"uniform sampler2D PREFIX(atlas_tex);\n"
+"uniform sampler2D PREFIX(layout_tex);\n"
+"uniform vec2 PREFIX(offset);\n"
+"uniform vec2 PREFIX(scale);\n"
+"uniform vec2 PREFIX(block_size);\n"
+"uniform vec2 PREFIX(atlas_size);\n"
+"uniform vec2 PREFIX(layout_size);\n"
+"uniform float PREFIX(line_spacing);\n"
+"uniform float PREFIX(top_margin);\n"
+"uniform float PREFIX(cell_pad);\n"
+"uniform float PREFIX(cell_height);\n"
+"vec4 PREFIX(layout_at)( float i, float line ) {\n"
+"	return tex2D( PREFIX(layout_tex), vec2( (i + 0.5) / PREFIX(layout_size).x, (line + 0.5) / PREFIX(layout_size).y ) );\n"
+"}\n"
+"vec4 PREFIX(glyph_at)( vec2 p, float g, float line, float count ) {\n"
+"	if ( g < 1.0 || g > count )\n"
+"		return vec4( 0.0 );\n"
+"	vec4 l = PREFIX(layout_at)( g, line );\n"
+"	vec2 d = vec2( p.x - l.x, p.y - PREFIX(top_margin) - line * PREFIX(line_spacing) + PREFIX(cell_pad) );\n"
+"	if ( d.x < 0.0 || d.x >= l.y || d.y < 0.0 || d.y >= PREFIX(cell_height) )\n"
+"		return vec4( 0.0 );\n"
+"	return tex2D( PREFIX(atlas_tex), (l.zw + d) / PREFIX(atlas_size) );\n"
+"}\n"
+"vec4 PREFIX(line_at)( vec2 p, float line ) {\n"
+"	if ( line < 0.0 || line >= PREFIX(layout_size).y )\n"
+"		return vec4( 0.0 );\n"
+"	float count = PREFIX(layout_at)( 0.0, line ).x;\n"
+"	// last glyph starting before p\n"
+"	float lo = 1.0, hi = count;\n"
+"	for ( int i = 0; i < 12; ++i ) {\n"
+"		if ( lo >= hi )\n"
+"			break;\n"
+"		float mid = ceil( (lo + hi) / 2.0 );\n"
+"		if ( PREFIX(layout_at)( mid, line ).x <= p.x )\n"
+"			lo = mid;\n"
+"		else\n"
+"			hi = mid - 1.0;\n"
+"	}\n"
+"	vec4 a = PREFIX(glyph_at)( p, lo, line, count );\n"
+"	vec4 b = PREFIX(glyph_at)( p, lo - 1.0, line, count );\n"
+"	return a + (1.0 - a.a) * b;\n"
+"}\n"
+"vec4 FUNCNAME( vec2 tc ) {\n"
+"	vec4 background = INPUT( tc );\n"
+"	tc -= PREFIX(offset);\n"
+"	tc *= PREFIX(scale);\n"
+"	if ( tc.x < 0.0 || tc.x > 1.0 || tc.y < 0.0 || tc.y > 1.0 )\n"
+"		return background;\n"
+"	vec2 p = vec2( tc.x, 1.0 - tc.y ) * PREFIX(block_size);\n"
+"	float line = floor( (p.y - PREFIX(top_margin) + PREFIX(cell_pad)) / PREFIX(line_spacing) );\n"
+"	vec4 a = PREFIX(line_at)( p, line );\n"
+"	vec4 b = PREFIX(line_at)( p, line - 1.0 );\n"
+"	vec4 text = (a + (1.0 - a.a) * b) * PREFIX(opacity);\n"
+"	return text + (1.0 - text.a) * background;\n"
+"}\n";
+
+
+
+class GlyphCell
+{
+public:
+	GlyphCell() : x( 0 ), y( 0 ), width( 0 ), advance( 0 ) {}
+
+	// position in the atlas, the pen is at (x + pad, y + pad + ascent).
+	// y is -1 if the atlas was full.
+	int x, y, width;
+	qreal advance;
+};
+
+
+
+// Glyphs of a text style, rasterized once with QPainter
+// in cells padded by the outline.
+class GlyphAtlas
+{
+public:
+	GlyphAtlas( const TextStyle &s );
+
+	// rasterized on first use
+	GlyphCell cell( QChar c );
+	// false if some glyphs didn't fit in the atlas
+	bool fits( const QString &text );
+	// the image and its version, incremented by each new glyph.
+	// [top, bottom[ are the rows drawn since version v.
+	QImage getImage( int &v, int &top, int &bottom );
+	int getVersion();
+	qreal textWidth( const QString &text );
+
+	// set from GL_MAX_TEXTURE_SIZE
+	static QAtomicInt maxHeight;
+
+	const TextStyle style;
+	int lineSpacing, ascent, pad, cellHeight;
+	qreal margin;
+
+private:
+	bool draw( QChar c, GlyphCell &gc );
+
+	QMutex mutex;
+	QFontMetricsF metrics;
+	QImage image;
+	QHash<QChar, GlyphCell> cells;
+	// y of each drawn glyph, by version
+	QVector<int> glyphRows;
+	int penX, penY;
+	int version;
+};
+
+
+
+// Atlases shared by all text effects, keyed by the style header.
+class GlyphAtlasCache
+{
+public:
+	QSharedPointer<GlyphAtlas> getAtlas( const TextStyle &style );
+
+	static GlyphAtlasCache* globalInstance();
+
+private:
+	QMutex mutex;
+	// least recently used first
+	QList< QSharedPointer<GlyphAtlas> > atlases;
+};
+
+
+
+// Plain texts (no background, no arrow) drawn from a glyph atlas.
+// Only the layout and the rows of new glyphs are uploaded when the text changes.
+class MyTextAtlasEffect : public Effect {
+public:
+	MyTextAtlasEffect();
+	~MyTextAtlasEffect();
+
+	virtual std::string effect_type_id() const { return "MyTextAtlasEffect"; }
+	std::string output_fragment_shader() { return MyTextAtlasEffect_shader; }
+
+	virtual void inform_input_size(unsigned, unsigned width, unsigned height) {
+		iwidth = width;
+		iheight = height;
+	}
+
+	virtual void set_gl_state( GLuint glsl_program_num, const std::string &prefix, unsigned *sampler_num );
+
+	void setText( const QString &text, int iw, int ih, double scale = 1 );
+
+	float getImageWidth() { return blockWidth; }
+	float getImageHeight() { return blockHeight; }
+
+private:
+	float iwidth, iheight;
+	float blockWidth, blockHeight, imgScale;
+	float top, left;
+	float opacity;
+
+	QString currentText;
+	QSharedPointer<GlyphAtlas> atlas;
+	GLuint atlasTex, layoutTex;
+	int atlasVersion;
+	QSize atlasSize;
+	// RGBA per glyph, layoutWidth texels per line
+	QVector<float> layout;
+	int layoutWidth, layoutHeight;
+	bool layoutChanged;
+};
+
+#endif // GLTEXTATLAS_H
@@ -35,12 +35,14 @@ void GLVignette::ovdUpdate( QString type, QVariant val )
 bool GLVignette::process( const QList<Effect*> &el, double pts, Frame *src, Profile *p )
 {
 	Q_UNUSED( p );
-	float center[2] = { (getParamValue( xOffset, pts ).toFloat() / src->glWidth) + 0.5f, (getParamValue( yOffset, pts ).toFloat() / src->glHeight) + 0.5f };
+	double x = getParamValue( xOffset, pts ).toDouble() * src->glScale;
+	double y = getParamValue( yOffset, pts ).toDouble() * src->glScale;
+	float center[2] = { (float)(x / src->glWidth) + 0.5f, (float)(y / src->glHeight) + 0.5f };
 	
 	if ( ovdEnabled() ) {
 		src->glOVD = FilterTransform::TRANSLATE;
 		src->glOVDRect = QRectF( -(double)src->glWidth / 2.0, -(double)src->glHeight / 2.0, src->glWidth, src->glHeight );
-		src->glOVDTransformList.append( FilterTransform( FilterTransform::TRANSLATE, getParamValue( xOffset, pts ).toDouble(), getParamValue( yOffset, pts ).toDouble() ) );
+		src->glOVDTransformList.append( FilterTransform( FilterTransform::TRANSLATE, x, y ) );
 	}
 	
 	Effect *e = el[0];
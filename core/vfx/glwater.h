@@ -107,6 +107,7 @@ public:
 	~GLWater();
 
 	bool process( const QList<Effect*> &el, double pts, Frame *src, Profile *p );
+	bool isAnimated( double ) { return true; }
 
 	QList<Effect*> getMovitEffects();
 	
@@ -0,0 +1,155 @@
+#include <math.h>
+
+#include <QPainter>
+#include <QBoxLayout>
+
+#include "videoout/scopeswidget.h"
+
+
+
+ScopesWidget::ScopesWidget( QWidget *parent ) : QWidget( parent )
+{
+	modeCombo = new QComboBox();
+	modeCombo->addItem( tr("Histogram") );
+	modeCombo->addItem( tr("Waveform") );
+	modeCombo->addItem( tr("Vectorscope") );
+	connect( modeCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(modeChanged(int)) );
+
+	QBoxLayout *box = new QBoxLayout( QBoxLayout::TopToBottom );
+	box->setContentsMargins( 2, 2, 2, 2 );
+	box->addWidget( modeCombo );
+	box->addStretch( 1 );
+	setLayout( box );
+
+	setMinimumSize( 200, 180 );
+}
+
+
+
+void ScopesWidget::modeChanged( int m )
+{
+	result = ScopesResult();
+	image = QImage();
+	update();
+	emit modeSelected( m );
+}
+
+
+
+// counts are shown on a square root scale, expected is the count of an even spread
+static int level( float count, double expected )
+{
+	return qMin( 255, (int)( 255.0 * sqrt( count / expected ) ) );
+}
+
+
+
+void ScopesWidget::setResult( const ScopesResult &r )
+{
+	if ( r.mode != modeCombo->currentIndex() )
+		return;
+	result = r;
+
+	if ( r.mode != VideoScopes::HISTOGRAM ) {
+		image = QImage( r.width, r.height, QImage::Format_RGB32 );
+		double expected = r.mode == VideoScopes::WAVEFORM
+			? (double)r.samples / r.width / 16.0
+			: (double)r.samples / ( r.width * r.height ) * 4.0;
+		for ( int y = 0; y < r.height; ++y ) {
+			// bins are bottom row first
+			const float *bins = r.bins.constData() + ( r.height - 1 - y ) * r.width * 4;
+			QRgb *line = (QRgb*)image.scanLine( y );
+			for ( int x = 0; x < r.width; ++x ) {
+				if ( r.mode == VideoScopes::WAVEFORM )
+					line[x] = qRgb( level( bins[x * 4], expected ), level( bins[x * 4 + 1], expected ), level( bins[x * 4 + 2], expected ) );
+				else {
+					int l = level( bins[x * 4], expected );
+					line[x] = qRgb( l, l, l );
+				}
+			}
+		}
+	}
+
+	update();
+}
+
+
+
+void ScopesWidget::paintEvent( QPaintEvent *event )
+{
+	Q_UNUSED( event );
+	QPainter p( this );
+	int top = modeCombo->geometry().bottom() + 4;
+	QRect r( 2, top, width() - 4, height() - top - 2 );
+	p.fillRect( r, Qt::black );
+	if ( result.bins.isEmpty() )
+		return;
+
+	if ( result.mode == VideoScopes::HISTOGRAM )
+		drawHistogram( &p, r );
+	else
+		drawImage( &p, r );
+}
+
+
+
+void ScopesWidget::drawHistogram( QPainter *p, QRect r )
+{
+	float max = 1;
+	for ( int i = 0; i < result.bins.count(); ++i )
+		max = qMax( max, result.bins[i] );
+
+	QColor colors[4] = { QColor( 255, 0, 0, 128 ), QColor( 0, 255, 0, 128 ), QColor( 0, 0, 255, 128 ), QColor( 255, 255, 255, 200 ) };
+	p->setRenderHint( QPainter::Antialiasing );
+	for ( int c = 0; c < 4; ++c ) {
+		QPolygonF poly;
+		poly << QPointF( r.left(), r.bottom() );
+		for ( int i = 0; i < result.width; ++i ) {
+			double x = r.left() + ( i + 0.5 ) * r.width() / result.width;
+			double y = r.bottom() - result.bins[i * 4 + c] / max * r.height();
+			poly << QPointF( x, y );
+		}
+		poly << QPointF( r.right(), r.bottom() );
+		if ( c < 3 ) {
+			p->setPen( Qt::NoPen );
+			p->setBrush( colors[c] );
+		}
+		else {
+			p->setPen( colors[c] );
+			p->setBrush( Qt::NoBrush );
+		}
+		p->drawPolygon( poly );
+	}
+}
+
+
+
+void ScopesWidget::drawImage( QPainter *p, QRect r )
+{
+	if ( image.isNull() )
+		return;
+
+	QRect dest = r;
+	if ( result.mode == VideoScopes::VECTORSCOPE ) {
+		int s = qMin( r.width(), r.height() );
+		dest = QRect( r.left() + ( r.width() - s ) / 2, r.top() + ( r.height() - s ) / 2, s, s );
+	}
+	p->setRenderHint( QPainter::SmoothPixmapTransform );
+	p->drawImage( dest, image );
+
+	// graticule
+	p->setPen( QColor( 255, 200, 0, 96 ) );
+	p->setRenderHint( QPainter::Antialiasing );
+	if ( result.mode == VideoScopes::WAVEFORM ) {
+		for ( int i = 0; i <= 4; ++i ) {
+			int y = dest.bottom() - i * dest.height() / 4;
+			p->drawLine( dest.left(), y, dest.right(), y );
+		}
+	}
+	else {
+		QPointF c = QRectF( dest ).center();
+		p->drawLine( QPointF( dest.left(), c.y() ), QPointF( dest.right(), c.y() ) );
+		p->drawLine( QPointF( c.x(), dest.top() ), QPointF( c.x(), dest.bottom() ) );
+		p->drawEllipse( c, dest.width() / 2.0, dest.height() / 2.0 );
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef SCOPESWIDGET_H
+#define SCOPESWIDGET_H
+
+#include <QWidget>
+#include <QComboBox>
+#include <QImage>
+
+#include "videoout/videoscopes.h"
+
+
+
+// Shows the last ScopesResult, the scope type is selected here.
+class ScopesWidget : public QWidget
+{
+	Q_OBJECT
+public:
+	ScopesWidget( QWidget *parent = 0 );
+
+public slots:
+	void setResult( const ScopesResult &r );
+
+protected:
+	void paintEvent( QPaintEvent *event );
+
+private slots:
+	void modeChanged( int m );
+
+private:
+	void drawHistogram( QPainter *p, QRect r );
+	void drawImage( QPainter *p, QRect r );
+
+	QComboBox *modeCombo;
+	ScopesResult result;
+	// waveform and vectorscope
+	QImage image;
+
+signals:
+	void modeSelected( int );
+};
+
+#endif // SCOPESWIDGET_H
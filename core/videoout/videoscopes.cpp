@@ -0,0 +1,202 @@
+#include <string.h>
+
+#include <QDebug>
+
+#include "engine/shadercache.h"
+#include "videoout/videoscopes.h"
+
+
+
+VideoScopes::VideoScopes( QGLWidget *glContext )
+	: context( glContext ),
+	enabled( false ),
+	initialized( false ),
+	mode( HISTOGRAM ),
+	serial( 0 ),
+	lastSerial( 0 ),
+	program( 0 )
+{
+	timer.setSingleShot( true );
+	connect( &timer, SIGNAL(timeout()), this, SLOT(readResults()) );
+}
+
+
+
+VideoScopes::~VideoScopes()
+{
+	if ( !initialized )
+		return;
+	context->makeCurrent();
+	clearSlots();
+	glDeleteProgram( program );
+}
+
+
+
+bool VideoScopes::init()
+{
+	initialized = true;
+
+	QString log;
+	program = ShaderCache::globalInstance()->getProgram( ScopesScatter_vertex, ScopesScatter_fragment, &log );
+	if ( !program )
+		qDebug() << "scopes shader error:" << log;
+
+	for ( int i = 0; i < SCOPESLOTS; ++i ) {
+		glGenBuffers( 1, &scopeSlots[i].pbo );
+		glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, scopeSlots[i].pbo );
+		glBufferData( GL_PIXEL_PACK_BUFFER_ARB, SCOPESIZE * SCOPESIZE * 4 * sizeof(float), NULL, GL_STREAM_READ );
+	}
+	glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, 0 );
+
+	return program != 0;
+}
+
+
+
+void VideoScopes::clearSlots()
+{
+	for ( int i = 0; i < SCOPESLOTS; ++i ) {
+		ScopeSlot *s = &scopeSlots[i];
+		if ( s->fence ) {
+			glDeleteSync( s->fence );
+			s->fence = 0;
+		}
+		if ( s->fbo ) {
+			delete s->fbo;
+			s->fbo = NULL;
+		}
+		if ( s->pbo ) {
+			glDeleteBuffers( 1, &s->pbo );
+			s->pbo = 0;
+		}
+	}
+}
+
+
+
+void VideoScopes::setEnabled( bool b )
+{
+	enabled = b;
+}
+
+
+
+void VideoScopes::setMode( int m )
+{
+	mode = m;
+}
+
+
+
+void VideoScopes::compute( FBO *frame )
+{
+	if ( !enabled )
+		return;
+	if ( !initialized )
+		init();
+	if ( !program )
+		return;
+
+	// skip this frame if the previous results are not read yet
+	ScopeSlot *s = NULL;
+	for ( int i = 0; i < SCOPESLOTS; ++i ) {
+		if ( !scopeSlots[i].fence ) {
+			s = &scopeSlots[i];
+			break;
+		}
+	}
+	if ( !s )
+		return;
+
+	int w = SCOPESIZE;
+	int h = mode == HISTOGRAM ? 1 : SCOPESIZE;
+	if ( s->fbo && ( s->fbo->width() != w || s->fbo->height() != h ) ) {
+		delete s->fbo;
+		s->fbo = NULL;
+	}
+	if ( !s->fbo ) {
+		s->fbo = new FBO( w, h, GL_RGBA32F );
+		if ( !s->fbo->isValid() ) {
+			delete s->fbo;
+			s->fbo = NULL;
+			return;
+		}
+	}
+	s->mode = mode;
+	s->serial = ++serial;
+
+	// scatter
+	GLint viewport[4];
+	glGetIntegerv( GL_VIEWPORT, viewport );
+	glBindFramebuffer( GL_FRAMEBUFFER, s->fbo->fbo() );
+	glViewport( 0, 0, w, h );
+	glClearColor( 0, 0, 0, 0 );
+	glClear( GL_COLOR_BUFFER_BIT );
+	glEnable( GL_BLEND );
+	glBlendFunc( GL_ONE, GL_ONE );
+	glUseProgram( program );
+	glActiveTexture( GL_TEXTURE0 );
+	glBindTexture( GL_TEXTURE_2D, frame->texture() );
+	glUniform1i( glGetUniformLocation( program, "tex" ), 0 );
+	glUniform2i( glGetUniformLocation( program, "grid" ), SCOPEGRIDWIDTH, SCOPEGRIDHEIGHT );
+	glUniform1i( glGetUniformLocation( program, "mode" ), mode );
+	glUniform2f( glGetUniformLocation( program, "size" ), w, h );
+	int channels = mode == HISTOGRAM ? 4 : ( mode == WAVEFORM ? 3 : 1 );
+	glDrawArrays( GL_POINTS, 0, SCOPEGRIDWIDTH * SCOPEGRIDHEIGHT * channels );
+	glUseProgram( 0 );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+	glDisable( GL_BLEND );
+
+	// asynchronous read back
+	glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, s->pbo );
+	glReadPixels( 0, 0, w, h, GL_RGBA, GL_FLOAT, NULL );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, 0 );
+	s->fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	glViewport( viewport[0], viewport[1], viewport[2], viewport[3] );
+	glFlush();
+
+	if ( !timer.isActive() )
+		timer.start( 5 );
+}
+
+
+
+void VideoScopes::readResults()
+{
+	context->makeCurrent();
+	bool pending = false;
+	for ( int i = 0; i < SCOPESLOTS; ++i ) {
+		ScopeSlot *s = &scopeSlots[i];
+		if ( !s->fence )
+			continue;
+		if ( glClientWaitSync( s->fence, 0, 0 ) == GL_TIMEOUT_EXPIRED ) {
+			pending = true;
+			continue;
+		}
+		glDeleteSync( s->fence );
+		s->fence = 0;
+
+		ScopesResult r;
+		r.mode = s->mode;
+		r.width = s->fbo->width();
+		r.height = s->fbo->height();
+		r.samples = SCOPEGRIDWIDTH * SCOPEGRIDHEIGHT;
+		r.bins.resize( r.width * r.height * 4 );
+		glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, s->pbo );
+		float *data = (float*)glMapBuffer( GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY );
+		if ( data ) {
+			memcpy( r.bins.data(), data, r.bins.size() * sizeof(float) );
+			glUnmapBuffer( GL_PIXEL_PACK_BUFFER_ARB );
+		}
+		glBindBuffer( GL_PIXEL_PACK_BUFFER_ARB, 0 );
+		if ( data && enabled && s->serial > lastSerial ) {
+			lastSerial = s->serial;
+			emit newResult( r );
+		}
+	}
+	if ( pending )
+		timer.start( 5 );
+}
@@ -0,0 +1,130 @@
+#ifndef VIDEOSCOPES_H
+#define VIDEOSCOPES_H
+
+#define GL_GLEXT_PROTOTYPES
+
+#include <QGLWidget>
+#include <QTimer>
+#include <QVector>
+
+#include "engine/glresource.h"
+
+// bins of the histogram, and size of the waveform and vectorscope
+#define SCOPESIZE 256
+// pixels of the frame are sampled on this grid
+#define SCOPEGRIDWIDTH 320
+#define SCOPEGRIDHEIGHT 180
+// results being computed or read back
+#define SCOPESLOTS 2
+
+
+
+static const char *ScopesScatter_vertex=
+"#version 130\n"
+"uniform sampler2D tex;\n"
+"uniform ivec2 grid;\n"
+"uniform int mode;\n"
+"uniform vec2 size;\n"
+"out vec4 weight;\n"
+"void main() {\n"
+"	int samples = grid.x * grid.y;\n"
+"	int channel = gl_VertexID / samples;\n"
+"	int i = gl_VertexID - channel * samples;\n"
+"	vec2 tc = ( vec2( i % grid.x, i / grid.x ) + 0.5 ) / vec2( grid );\n"
+"	vec3 c = textureLod( tex, tc, 0.0 ).rgb;\n"
+"	float luma = dot( c, vec3( 0.2126, 0.7152, 0.0722 ) );\n"
+"	vec4 v = vec4( c, luma );\n"
+"	vec2 pos;\n"
+"	weight = vec4( equal( ivec4( 0, 1, 2, 3 ), ivec4( channel ) ) );\n"
+"	if ( mode == 0 )\n"
+"		pos = vec2( v[channel], 0.5 );\n"
+"	else if ( mode == 1 )\n"
+"		pos = vec2( tc.x, v[channel] );\n"
+"	else {\n"
+"		// BT.709 Cb Cr\n"
+"		pos = vec2( ( c.b - luma ) / 1.8556, ( c.r - luma ) / 1.5748 ) + 0.5;\n"
+"		weight = vec4( 1.0 );\n"
+"	}\n"
+"	// each sample hits the center of a bin\n"
+"	pos = ( floor( clamp( pos, 0.0, 1.0 ) * ( size - 1.0 ) + 0.5 ) + 0.5 ) / size;\n"
+"	gl_Position = vec4( pos * 2.0 - 1.0, 0.0, 1.0 );\n"
+"}\n";
+
+static const char *ScopesScatter_fragment=
+"#version 130\n"
+"in vec4 weight;\n"
+"void main() {\n"
+"	gl_FragColor = weight;\n"
+"}\n";
+
+
+
+class ScopesResult
+{
+public:
+	ScopesResult() : mode( 0 ), width( 0 ), height( 0 ), samples( 0 ) {}
+
+	int mode;
+	int width, height;
+	int samples;
+	// RGBA counts per bin, bottom row first
+	QVector<float> bins;
+};
+
+
+
+class ScopeSlot
+{
+public:
+	ScopeSlot() : fbo( NULL ), pbo( 0 ), fence( 0 ), mode( 0 ), serial( 0 ) {}
+
+	FBO *fbo;
+	GLuint pbo;
+	GLsync fence;
+	int mode;
+	// results are emitted in the frames order
+	int serial;
+};
+
+
+
+// Scopes of the shown frames, computed on the GPU by scattering
+// samples of the frame texture into bins with additive blending.
+// Only the bins are read back, through a PBO when a fence says they are
+// ready, so results come a frame or two late but never stall.
+// Used in the GL context of the VideoWidget.
+class VideoScopes : public QObject
+{
+	Q_OBJECT
+public:
+	enum Mode{ HISTOGRAM, WAVEFORM, VECTORSCOPE };
+
+	VideoScopes( QGLWidget *glContext );
+	~VideoScopes();
+
+	bool isEnabled() { return enabled; }
+	void setEnabled( bool b );
+	void setMode( int m );
+	// the context has to be current
+	void compute( FBO *frame );
+
+private slots:
+	void readResults();
+
+private:
+	bool init();
+	void clearSlots();
+
+	QGLWidget *context;
+	bool enabled, initialized;
+	int mode;
+	int serial, lastSerial;
+	GLuint program;
+	ScopeSlot scopeSlots[SCOPESLOTS];
+	QTimer timer;
+
+signals:
+	void newResult( const ScopesResult& );
+};
+
+#endif // VIDEOSCOPES_H
@@ -23,7 +23,9 @@ VideoWidget::VideoWidget( QWidget *parent ) : QGLWidget( QGLFormat(QGL::SampleBu
 	lastFrame( NULL ),
 	leftButtonPressed( false ),
 	ovdTarget( 0 ),
-	playing( false )
+	playing( false ),
+	scopes( this ),
+	scopesPending( false )
 {
 	setAttribute( Qt::WA_OpaquePaintEvent );
 	setAutoFillBackground( false );
@@ -75,6 +77,11 @@ void VideoWidget::initializeGL()
 
 void VideoWidget::resizeGL( int width, int height )
 {
+#if QT_VERSION >= 0x050000
+	emit sizeChanged( QSize( width, height ) * devicePixelRatio() );
+#else
+	emit sizeChanged( QSize( width, height ) );
+#endif
 	glViewport( 0, 0, width, height );
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
@@ -149,6 +156,9 @@ void VideoWidget::paintEvent( QPaintEvent *event )
 	makeCurrent();
 
 	openglDraw();
+	if ( scopesPending && lastFrame && lastFrame->fbo() )
+		scopes.compute( lastFrame->fbo() );
+	scopesPending = false;
 	
 	QPainter painter( this );
 	painter.setRenderHint( QPainter::Antialiasing );
@@ -168,12 +178,31 @@ void VideoWidget::showFrame( Frame *frame )
 	lastFrameRatio = frame->glSAR * (double)frame->glWidth / (double)frame->glHeight;
 	lastFrame = frame;
 	osdTimer.disable();
+	scopesPending = scopes.isEnabled();
 	update();
 	emit frameShown( frame );
 }
 
 
 
+void VideoWidget::showScopes( bool b )
+{
+	scopes.setEnabled( b );
+	scopesPending = b;
+	update();
+}
+
+
+
+void VideoWidget::setScopesMode( int m )
+{
+	scopes.setMode( m );
+	scopesPending = scopes.isEnabled();
+	update();
+}
+
+
+
 void VideoWidget::clear()
 {
 	lastFrame = NULL;
@@ -4,6 +4,7 @@
 #define GL_GLEXT_PROTOTYPES
 
 #include "engine/frame.h"
+#include "videoout/videoscopes.h"
 
 #include <QGLFramebufferObject>
 
@@ -163,6 +164,7 @@ public:
 	~VideoWidget();
 	
 	void controlKeyPressed( bool down );
+	VideoScopes* getScopes() { return &scopes; }
 
 public slots:
 	void showFrame( Frame *frame );
@@ -171,6 +173,8 @@ public slots:
 	
 	void showOSDMessage( const QString &text, int duration );
 	void showOSDTimer( bool b );
+	void showScopes( bool b );
+	void setScopesMode( int m );
 
 protected :
 	void initializeGL();
@@ -204,6 +208,10 @@ private:
 	OSDTimer osdTimer;
 	bool playing;
 
+	VideoScopes scopes;
+	// scopes of the last frame not computed yet
+	bool scopesPending;
+
 signals:
 	void playPause();
 	void wheelSeek( int );
@@ -211,6 +219,8 @@ signals:
 	void newSharedContext(QGLWidget*);
 	void newThumbContext(QGLWidget*);
 	void newFencesContext(QGLWidget*);
+	// physical pixels
+	void sizeChanged( QSize );
 	void frameShown( Frame* );
 
 	void toggleFullscreen();
@@ -0,0 +1,167 @@
+#include <unistd.h>
+
+#include <QtConcurrentRun>
+
+#include "input/input_ff.h"
+
+#include "testaudiosamplering.h"
+
+// stereo float
+#define CHANNELS 2
+
+
+
+static void fill( float *buf, int nSamples, int first )
+{
+	for ( int i = 0; i < nSamples; ++i ) {
+		for ( int j = 0; j < CHANNELS; ++j )
+			buf[i * CHANNELS + j] = first + i;
+	}
+}
+
+
+
+static bool check( float *buf, int nSamples, int first )
+{
+	for ( int i = 0; i < nSamples; ++i ) {
+		for ( int j = 0; j < CHANNELS; ++j ) {
+			if ( buf[i * CHANNELS + j] != first + i ) {
+				qDebug() << "sample" << i << "is" << buf[i * CHANNELS + j] << "expected" << first + i;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+
+static void produce( AudioSampleRing *ring, int total )
+{
+	float buf[256 * CHANNELS];
+	int done = 0;
+	while ( done < total ) {
+		int n = qMin( 256, total - done );
+		fill( buf, n, done );
+		int w = ring->write( (uint8_t*)buf, n, 0 );
+		if ( w < n ) {
+			// retry the remaining samples
+			n = w;
+			if ( !w )
+				usleep( 100 );
+		}
+		done += n;
+	}
+}
+
+
+
+void TestAudioSampleRing::readWhatWasWritten()
+{
+	Profile prof;
+	AudioSampleRing ring;
+	ring.reset( prof );
+	float in[1000 * CHANNELS], out[1000 * CHANNELS];
+	fill( in, 1000, 0 );
+	int w = ring.write( (uint8_t*)in, 1000, 40000 );
+	QVERIFY( w == 1000 && ring.readable( 1000 ) && !ring.readable( 1001 ) );
+	QVERIFY( ring.readPts() == 40000 );
+	int r = ring.read( (uint8_t*)out, 1000 );
+	QVERIFY( r == 1000 && check( out, 1000, 0 ) && !ring.readable( 1 ) );
+}
+
+
+
+void TestAudioSampleRing::wrapAround()
+{
+	Profile prof;
+	AudioSampleRing ring;
+	ring.reset( prof );
+	float in[7001 * CHANNELS], out[7001 * CHANNELS];
+	bool ok = true;
+	for ( int k = 0; k < 20 && ok; ++k ) {
+		fill( in, 7001, k * 7001 );
+		ok = ring.write( (uint8_t*)in, 7001, 0 ) == 7001;
+		ok = ok && ring.read( (uint8_t*)out, 7001 ) == 7001;
+		ok = ok && check( out, 7001, k * 7001 );
+	}
+	QVERIFY( ok );
+}
+
+
+
+void TestAudioSampleRing::partialWriteWhenFull()
+{
+	Profile prof;
+	AudioSampleRing ring;
+	ring.reset( prof );
+	int size = prof.getAudioSampleRate() * 4;
+	float *in = new float[size * CHANNELS];
+	fill( in, size, 0 );
+	int w = ring.write( (uint8_t*)in, size, 0 );
+	bool full = !ring.writable() && ring.write( (uint8_t*)in, 1, 0 ) == 0;
+	int r = ring.read( (uint8_t*)in, 100 );
+	int more = ring.write( (uint8_t*)in, 200, 0 );
+	delete [] in;
+	QVERIFY( w > 0 && w < size && full && r == 100 && more == 100 );
+}
+
+
+
+void TestAudioSampleRing::reversedWrite()
+{
+	Profile prof;
+	AudioSampleRing ring;
+	ring.reset( prof );
+	float in[10 * CHANNELS], out[10 * CHANNELS];
+	fill( in, 10, 0 );
+	ring.write( (uint8_t*)in, 10, 0, true );
+	ring.read( (uint8_t*)out, 10 );
+	bool ok = true;
+	for ( int i = 0; i < 10; ++i )
+		ok = ok && out[i * CHANNELS] == 9 - i;
+	QVERIFY( ok );
+}
+
+
+
+void TestAudioSampleRing::ptsFollowsSegments()
+{
+	Profile prof;
+	prof.setAudioSampleRate( 48000 );
+	AudioSampleRing ring;
+	ring.reset( prof );
+	float buf[480 * CHANNELS];
+	fill( buf, 480, 0 );
+	ring.write( (uint8_t*)buf, 480, 0 );
+	ring.write( (uint8_t*)buf, 480, 100000 );
+	ring.read( (uint8_t*)buf, 240 );
+	double pts1 = ring.readPts();
+	ring.read( (uint8_t*)buf, 240 );
+	double pts2 = ring.readPts();
+	ring.read( (uint8_t*)buf, 240 );
+	double pts3 = ring.readPts();
+	QVERIFY( pts1 == 5000 && pts2 == 100000 && pts3 == 105000 );
+}
+
+
+
+void TestAudioSampleRing::concurrentReadWrite()
+{
+	Profile prof;
+	AudioSampleRing ring;
+	ring.reset( prof );
+	int total = prof.getAudioSampleRate() * 20;
+	QFuture<void> producer = QtConcurrent::run( produce, &ring, total );
+
+	float out[1000 * CHANNELS];
+	int done = 0;
+	bool ok = true;
+	while ( done < total && ok ) {
+		int n = ring.read( (uint8_t*)out, qMin( 1000, total - done ) );
+		ok = check( out, n, done );
+		done += n;
+	}
+	producer.waitForFinished();
+	QVERIFY( ok && done == total );
+}
@@ -0,0 +1,23 @@
+#ifndef TESTAUDIOSAMPLERING_H
+#define TESTAUDIOSAMPLERING_H
+
+#include "AutoTest.h"
+
+
+
+class TestAudioSampleRing : public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void readWhatWasWritten();
+	void wrapAround();
+	void partialWriteWhenFull();
+	void reversedWrite();
+	void ptsFollowsSegments();
+	void concurrentReadWrite();
+};
+
+DECLARE_TEST(TestAudioSampleRing)
+
+#endif // TESTAUDIOSAMPLERING_H
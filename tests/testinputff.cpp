@@ -1,3 +1,5 @@
+#include <QElapsedTimer>
+
 #include "input/input_ff.h"
 
 #include "testinputff.h"
@@ -140,6 +142,34 @@ void TestInputFF::seekStart()
 
 
 
+// A fast seek gives a frame at or before the target (keyframe or cached),
+// the following exact seek gives the target.
+void TestInputFF::fastSeekThenExactSeek()
+{
+	InputFF *in = new InputFF();
+	Profile prof;
+	in->probe( VIDEOTEST, &prof );
+	in->setProfile( prof, prof );
+	double target = prof.getStreamStartTime() + prof.getVideoFrameDuration() * 7;
+	in->setSeekMode( InputBase::SeekFast );
+	in->openSeekPlay( VIDEOTEST, target );
+	Frame *f = in->getVideoFrame();
+	double fastPts = f->pts();
+	delete f;
+	in->setSeekMode( InputBase::SeekCancelable );
+	in->openSeekPlay( VIDEOTEST, target );
+	f = in->getVideoFrame();
+	double pts = f->pts();
+	int color = f->data()[0] + 2 * f->data()[prof.getVideoWidth() * prof.getVideoHeight() * 5 / 4];
+	delete f;
+	in->play( false );
+	delete in;
+	QVERIFY( fastPts >= prof.getStreamStartTime() && fastPts <= target
+			&& pts == target && color == frameColors[7] );
+}
+
+
+
 void TestInputFF::resampleDoubleFrameRate()
 {
 	InputFF *in = new InputFF();
@@ -240,6 +270,71 @@ void TestInputFF::resampleHalfFrameRate()
 
 
 
+void TestInputFF::decodeSkippingBenchmark_data()
+{
+	QTest::addColumn<double>( "speed" );
+	QTest::addColumn<bool>( "skip" );
+
+	QTest::newRow( "2x all frames" ) << 2.0 << false;
+	QTest::newRow( "2x skipping" ) << 2.0 << true;
+	QTest::newRow( "4x all frames" ) << 4.0 << false;
+	QTest::newRow( "4x skipping" ) << 4.0 << true;
+	QTest::newRow( "8x all frames" ) << 8.0 << false;
+	QTest::newRow( "8x skipping" ) << 8.0 << true;
+}
+
+
+
+// Time spent per output frame of a speed changed clip.
+// Set MACHINTRUC_BENCH_VIDEO to a longer file for meaningful numbers.
+void TestInputFF::decodeSkippingBenchmark()
+{
+	QFETCH( double, speed );
+	QFETCH( bool, skip );
+
+	QString path = qgetenv( "MACHINTRUC_BENCH_VIDEO" );
+	if ( path.isEmpty() )
+		path = VIDEOTEST;
+
+	InputFF *in = new InputFF();
+	Profile prof, outProf;
+	QVERIFY( in->probe( path, &prof ) );
+	outProf = prof;
+	outProf.setVideoFrameRate( prof.getVideoFrameRate() / speed );
+	outProf.setVideoFrameDuration( MICROSECOND / outProf.getVideoFrameRate() );
+	outProf.setAudioSampleRate( prof.getAudioSampleRate() / speed );
+	in->setSpeed( speed );
+	in->setPreviewSpeed( skip ? 1 : 0 );
+	in->setProfile( prof, outProf );
+
+	QElapsedTimer timer;
+	Frame *f;
+	int i = 0;
+	int nframes = prof.getStreamDuration() / outProf.getVideoFrameDuration();
+	timer.start();
+	in->openSeekPlay( path, prof.getStreamStartTime() );
+	while ( i < nframes && (f = in->getVideoFrame()) ) {
+		delete f;
+		++i;
+	}
+	qint64 elapsed = timer.nsecsElapsed();
+	in->play( false );
+	// includes the frames decoded ahead
+	int decoded = in->decodedVideoFrames();
+	int skipped = in->skippedVideoPackets();
+	delete in;
+
+	if ( i > 0 ) {
+		double ms = (double)elapsed / 1000000.0 / i;
+		qDebug() << QTest::currentDataTag() << ":" << ms << "ms per output frame," << 1000.0 / ms << "output fps";
+		qDebug() << QTest::currentDataTag() << ":" << decoded << "source frames decoded," << skipped << "packets skipped,"
+				 << (double)decoded * 1000000000.0 / elapsed << "decoded fps";
+	}
+	QVERIFY( i == nframes );
+}
+
+
+
 void TestInputFF::memLeakTest()
 {
 	/*int numInputs = 10;
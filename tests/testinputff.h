@@ -16,9 +16,12 @@ private slots:
 	void allFramesDecoded();
 	void seekBackOneFrameFromEnd();
 	void seekStart();
+	void fastSeekThenExactSeek();
 	void resampleDoubleFrameRate();
 	void resampleTripleFrameRate();
 	void resampleHalfFrameRate();
+	void decodeSkippingBenchmark_data();
+	void decodeSkippingBenchmark();
 	void memLeakTest();
 };
 
@@ -1,5 +1,6 @@
 QT += testlib
 QT += opengl
+QT += concurrent
 
 TARGET = tests
 
@@ -7,11 +8,13 @@ TEMPLATE = app
 
 SOURCES += main.cpp \
 	testinputff.cpp \
-	testoutputff.cpp
+	testoutputff.cpp \
+	testaudiosamplering.cpp
 
 HEADERS += AutoTest.h \
 	testinputff.h \
-	testoutputff.h
+	testoutputff.h \
+	testaudiosamplering.h
 
 LIBS += ../build/core/libcore.a
 INCLUDEPATH += ../core